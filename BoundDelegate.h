@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Delegate.h"
+
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace delly {
+
+template <typename Signature, typename... Bound> class BoundDelegate;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// BoundDelegate<RetType(Args...), Bound...> calls a Delegate<RetType(Bound...,
+// Args...)> with leading arguments stored inline, next to the delegate:
+//
+//     struct Server { void OnData(ConnectionId id, const Packet& p); };
+//     BoundDelegate<void(const Packet&), ConnectionId> d =
+//         BindFront(MakeDelegate<&Server::OnData>(server), id);
+//     d(packet);   // server.OnData(id, packet)
+//
+// Bound values are copied, they must be trivially copyable; reference
+// parameters bind a copy of the value.  Invoking passes them straight to
+// the target delegate, one call with nothing allocated.  Bound delegates
+// compare equal when their targets and bound values are equal, so they can
+// be found and removed by value.
+//
+
+template <typename RetType, typename... Args, typename... Bound>
+class BoundDelegate<RetType(Args...), Bound...> {
+public:
+    using TargetType = Delegate<RetType(Bound..., Args...)>;
+    using BoundValues = std::tuple<typename std::decay<Bound>::type...>;
+
+    static_assert(std::conjunction<std::is_trivially_copyable<typename std::decay<Bound>::type>...>::value,
+                  "Bound arguments must be trivially copyable");
+
+    BoundDelegate() = default;
+    BoundDelegate(const std::nullptr_t) noexcept : BoundDelegate() {}
+
+    BoundDelegate(const TargetType& target, const typename std::decay<Bound>::type&... values)
+        : m_target(target), m_bound(values...)
+    {}
+
+    inline const TargetType& target() const { return m_target; }
+    inline const BoundValues& bound() const { return m_bound; }
+
+    void reset() { *this = BoundDelegate(); }
+
+    inline bool empty() const { return m_target.empty(); }
+    inline explicit operator bool() const { return !empty(); }
+    inline bool operator!() const { return empty(); }
+
+    // Arguments are passed as by Delegate::operator()
+    template <typename... Params, typename = typename std::enable_if<
+                  std::conjunction<std::is_convertible<Params&&, Args>...>::value>::type>
+    inline RetType operator() (Params&& ... params) const {
+        return call<details::ParamType<Args>...>(std::index_sequence_for<Bound...>(),
+                                                 std::forward<Params>(params)...);
+    }
+
+    inline RetType operator() (details::BracedParamType<Args> ... args) const {
+        return call<details::ParamType<Args>...>(std::index_sequence_for<Bound...>(),
+                                                 std::forward<details::BracedParamType<Args>>(args)...);
+    }
+
+    bool operator==(const BoundDelegate& o) const {
+        return m_target == o.m_target && m_bound == o.m_bound;
+    }
+    bool operator!=(const BoundDelegate& o) const { return !operator==(o); }
+
+    size_t hash() const {
+        uint64_t h = m_target.storage().hash();
+        std::apply([&h](const auto&... values) {
+            ((h = h * 0x9e3779b97f4a7c15ULL + std::hash<std::decay_t<decltype(values)>>()(values)), ...);
+        }, m_bound);
+        return size_t(details::MixHash(h));
+    }
+
+private:
+    template <typename... Params, size_t... I>
+    inline RetType call(std::index_sequence<I...>, Params... args) const {
+        return m_target(std::get<I>(m_bound)..., std::forward<Params>(args)...);
+    }
+
+    TargetType m_target;
+    BoundValues m_bound;
+};
+
+namespace details {
+
+// The BoundDelegate binding the leading sizeof...(B) parameters of a target
+template <typename RetType, typename Params, typename BoundIndices, typename RestIndices>
+struct BindFrontTraits;
+
+template <typename RetType, typename Params, size_t... B, size_t... R>
+struct BindFrontTraits<RetType, Params, std::index_sequence<B...>, std::index_sequence<R...>> {
+    using Type = BoundDelegate<RetType(typename std::tuple_element<sizeof...(B) + R, Params>::type...),
+                               typename std::tuple_element<B, Params>::type...>;
+};
+
+} // end details namespace
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Helper function binds the leading parameters of a delegate to values
+//
+
+template <typename RetType, typename... Args, typename... Values>
+typename details::BindFrontTraits<RetType, std::tuple<Args...>,
+                                  std::make_index_sequence<sizeof...(Values)>,
+                                  std::make_index_sequence<sizeof...(Args) - sizeof...(Values)>>::Type
+BindFront(const Delegate<RetType(Args...)>& target, const Values&... values) {
+    static_assert(sizeof...(Values) <= sizeof...(Args), "Too many bound arguments");
+    return { target, values... };
+}
+
+} // end delly namespace
+
+namespace std {
+
+template <typename Signature, typename... Bound>
+struct hash<delly::BoundDelegate<Signature, Bound...>> {
+    size_t operator()(const delly::BoundDelegate<Signature, Bound...>& d) const noexcept {
+        return d.hash();
+    }
+};
+
+} // end std namespace
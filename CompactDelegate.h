@@ -0,0 +1,226 @@
+#pragma once
+
+#include "Delegate.h"
+#include "DelegateFlatSet.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+
+namespace delly {
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// CompactDelegateArena is the memory holding the objects bound to compact
+// delegates, addressed by 32 bit offsets from its base: objects must lie
+// within 4 GiB above it.  The base is registered once, before the first
+// compact delegate to an object is made, eg. the start of a reserved block
+// of timers.  Delegates of static functions need no arena.  Registering
+// another base throws std::logic_error, as it would move the objects of the
+// delegates already encoded.
+//
+
+class CompactDelegateArena {
+public:
+    static constexpr uint64_t MaxSize = uint64_t(1) << 32;
+
+    static void Register(const void* base) {
+        assert(base);
+        if (s_base && s_base != base)
+            throw std::logic_error("CompactDelegateArena: the arena base cannot change");
+        s_base = static_cast<const char*>(base);
+    }
+
+    static inline const void* Base() { return s_base; }
+
+    static inline bool Contains(const void* p) {
+        const char* c = static_cast<const char*>(p);
+        return s_base && c >= s_base && uint64_t(c - s_base) < MaxSize;
+    }
+
+private:
+    static inline const char* s_base = nullptr;
+};
+
+namespace details {
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Methods and functions of the compact delegates of one signature, in the
+// order they were first encoded.  Entries are delegate storage without the
+// object: static functions as is, methods with the arena base in place of
+// the object, so that decoding adds the offset of the object to the entry.
+// Index 0 is the empty delegate.
+//
+// Entries are never removed.  They are stored in fixed chunks which never
+// move, so decoding reads them with no lock while others are added.  Adding
+// more than MaxChunks * ChunkSize entries throws std::length_error.
+//
+
+template <typename Signature>
+class CompactMethodTable {
+public:
+    static constexpr uint32_t ChunkBits = 10;
+    static constexpr uint32_t ChunkSize = 1 << ChunkBits;
+    static constexpr uint32_t MaxChunks = 1024;
+
+    static inline const DelegateStorage& Get(uint32_t index) {
+        return s_chunks[index >> ChunkBits].load(std::memory_order_acquire)[index & (ChunkSize - 1)];
+    }
+
+    // Index of an entry, added on first use
+    static uint32_t Intern(const DelegateStorage& entry) {
+        if (entry.empty())
+            return 0;
+
+        // Recently encoded entries of this thread, to encode arrays without
+        // taking the lock
+        struct CacheLine { DelegateStorage entry; uint32_t index = 0; };
+        static thread_local CacheLine cache[CacheSize];
+        CacheLine& line = cache[entry.hash() & (CacheSize - 1)];
+        if (line.index && line.entry == entry)
+            return line.index;
+
+        State& state = GetState();
+        std::lock_guard<std::mutex> lock(state.lock);
+        const Delegate<void()> key(entry);
+        uint32_t* found = state.indices.find(key);
+        uint32_t index;
+        if (found) {
+            index = *found;
+        } else {
+            if (state.size == MaxChunks * ChunkSize)
+                throw std::length_error("CompactDelegate: too many methods of one signature");
+            index = state.size++;
+            DelegateStorage* chunk = s_chunks[index >> ChunkBits].load(std::memory_order_relaxed);
+            if (!chunk || chunk == s_emptyChunk) {
+                chunk = new DelegateStorage[ChunkSize]();
+                s_chunks[index >> ChunkBits].store(chunk, std::memory_order_release);
+            }
+            chunk[index & (ChunkSize - 1)] = entry;
+            state.indices.insert(key, index);
+        }
+        line.entry = entry;
+        line.index = index;
+        return index;
+    }
+
+private:
+    static constexpr size_t CacheSize = 16;
+
+    struct State {
+        std::mutex lock;
+        DelegateFlatMap<uint32_t> indices;
+        uint32_t size = 1;
+    };
+
+    static State& GetState() {
+        static State state;
+        return state;
+    }
+
+    // Chunk 0 starts as an empty chunk, so index 0 decodes to an empty
+    // delegate before anything was encoded
+    static inline constinit DelegateStorage s_emptyChunk[1] = {};
+
+    // Constant initialized, decoding works during static initialization
+    static inline constinit std::atomic<DelegateStorage*> s_chunks[MaxChunks] = { s_emptyChunk };
+};
+
+} // end details namespace
+
+template <typename Signature> class CompactDelegate;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// CompactDelegate is an 8 byte encoding of a Delegate, for large arrays of
+// callbacks: the object as a 32 bit offset into the CompactDelegateArena,
+// and the method as a 32 bit index into a table of the methods used with
+// the signature.  Encoding looks the method up in the table, decoding reads
+// the table entry back, and invoking calls the decoded delegate, with the
+// same semantics as the Delegate.
+//
+//     CompactDelegateArena::Register(timers.data());
+//     CompactDelegate<void(Time)> c(MakeDelegate<&Timer::OnExpired>(timers[i]));
+//     c(now);
+//     Delegate<void(Time)> d = c;
+//
+// Encoding is thread safe and usually takes no lock.  Objects must be in
+// the arena, see CanEncode: encoding others throws std::invalid_argument.
+//
+
+template <typename RetType, typename... Args>
+class CompactDelegate<RetType(Args...)> {
+
+    using Table = details::CompactMethodTable<RetType(Args...)>;
+    using DelegateStorage = details::DelegateStorage;
+
+public:
+    using DelegateType = Delegate<RetType(Args...)>;
+
+    constexpr CompactDelegate() = default;
+    constexpr CompactDelegate(const std::nullptr_t) noexcept : CompactDelegate() {}
+
+    explicit CompactDelegate(const DelegateType& d) {
+        // The offset of an object outside would be truncated
+        if (!CanEncode(d))
+            throw std::invalid_argument("CompactDelegate: the object is not in the arena");
+        const DelegateStorage& s = d.storage();
+        if (s.hasMethod()) {
+            const char* base = static_cast<const char*>(CompactDelegateArena::Base());
+            m_offset = uint32_t(reinterpret_cast<const char*>(s.getThis()) - base);
+            m_method = Table::Intern(DelegateStorage::FromParts(
+                reinterpret_cast<details::DummyClass*>(const_cast<char*>(base)), s.getFuncStorage()));
+        } else {
+            m_method = Table::Intern(s);
+        }
+    }
+
+    // Empty delegates, static functions and methods of objects in the arena
+    static bool CanEncode(const DelegateType& d) {
+        return !d.storage().hasMethod() || CompactDelegateArena::Contains(d.storage().getThis());
+    }
+
+    inline DelegateType delegate() const {
+        const DelegateStorage& entry = Table::Get(m_method);
+        auto* obj = reinterpret_cast<details::DummyClass*>(
+            reinterpret_cast<uintptr_t>(entry.getThis()) + m_offset);
+        return DelegateType(DelegateStorage::FromParts(obj, entry.getFuncStorage()));
+    }
+
+    inline operator DelegateType() const { return delegate(); }
+
+    // Arguments are passed as by Delegate::operator()
+    template <typename... Params, typename = typename std::enable_if<
+                  std::conjunction<std::is_convertible<Params&&, Args>...>::value>::type>
+    inline RetType operator() (Params&& ... params) const {
+        return delegate()(std::forward<Params>(params)...);
+    }
+
+    inline RetType operator() (details::BracedParamType<Args> ... args) const {
+        return delegate()(std::forward<details::BracedParamType<Args>>(args)...);
+    }
+
+    void reset() { *this = CompactDelegate(); }
+
+    inline bool empty() const { return m_method == 0; }
+    inline explicit operator bool() const { return !empty(); }
+    inline bool operator!() const { return empty(); }
+
+    // Equal delegates have equal encodings, methods are interned
+    inline bool operator==(const CompactDelegate& o) const {
+        return m_offset == o.m_offset && m_method == o.m_method;
+    }
+    inline bool operator!=(const CompactDelegate& o) const { return !operator==(o); }
+
+    inline uint32_t offset() const { return m_offset; }
+    inline uint32_t method() const { return m_method; }
+
+private:
+    uint32_t m_offset = 0;
+    uint32_t m_method = 0;
+};
+
+} // end delly namespace
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "Delegate.h"
+
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace delly {
+
+namespace details {
+
+// Shared by CompletionSource<T> and CompletionSource<void>: the awaiting
+// coroutine and whether it suspended or the completion came first.
+//
+// Suspension and completion race through an atomic exchange each, so the
+// producer may complete from another thread, or synchronously from the call
+// starting the operation.  Whichever comes second resumes the coroutine.
+// Completing an already suspended coroutine needs no exchange.
+class CompletionState {
+public:
+    CompletionState() = default;
+
+    // The delegate handed out binds the address
+    CompletionState(const CompletionState&) = delete;
+    CompletionState& operator=(const CompletionState&) = delete;
+
+    inline bool ready() const { return m_state.load(std::memory_order_acquire) == Completed; }
+
+    // Awaitable
+    inline bool await_ready() const noexcept { return ready(); }
+
+    bool await_suspend(std::coroutine_handle<> h) noexcept {
+        m_handle = h;
+        uint32_t expected = Pending;
+        // Completed meanwhile: do not suspend
+        return m_state.compare_exchange_strong(expected, Suspended, std::memory_order_acq_rel,
+                                               std::memory_order_acquire);
+    }
+
+protected:
+    // Call once the result is stored
+    void signal() {
+        // Usual case, the coroutine is suspended and nothing else races
+        if (m_state.load(std::memory_order_acquire) == Suspended) {
+            m_state.store(Completed, std::memory_order_relaxed);
+            m_handle.resume();
+            return;
+        }
+        const uint32_t previous = m_state.exchange(Completed, std::memory_order_acq_rel);
+        assert(previous != Completed && "completed twice");
+        if (previous == Suspended)
+            m_handle.resume();
+    }
+
+    void rearm() {
+        assert(m_state.load(std::memory_order_relaxed) != Suspended);
+        m_state.store(Pending, std::memory_order_relaxed);
+        m_handle = nullptr;
+    }
+
+private:
+    static constexpr uint32_t Pending = 0;
+    static constexpr uint32_t Suspended = 1;
+    static constexpr uint32_t Completed = 2;
+
+    std::atomic<uint32_t> m_state{Pending};
+    std::coroutine_handle<> m_handle;
+};
+
+} // end details namespace
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// CompletionSource connects a callback based producer to a coroutine.  The
+// producer receives delegate(), a Delegate<void(T)> bound at compile time to
+// complete(); the coroutine awaits the source and gets the value:
+//
+//     CompletionSource<size_t> read;
+//     socket.asyncRead(buffer, read.delegate());
+//     size_t n = co_await read;
+//
+// Completing stores the value in the source and resumes the coroutine from
+// the producer's call, so nothing is allocated and the producer pays one
+// delegate call.  The source must stay in place until completed, usually in
+// the coroutine frame.  A source completes once, reset() allows reuse.
+//
+
+template <typename T>
+class CompletionSource : public details::CompletionState {
+public:
+    using Callback = Delegate<void(T)>;
+
+    CompletionSource() = default;
+
+    Callback delegate() { return MakeDelegate<&CompletionSource::complete>(this); }
+
+    void complete(T value) {
+        m_value.emplace(std::move(value));
+        signal();
+    }
+
+    // Allow completing and awaiting again, once the value was taken
+    void reset() {
+        rearm();
+        m_value.reset();
+    }
+
+    T await_resume() {
+        assert(m_value);
+        return std::move(*m_value);
+    }
+
+private:
+    std::optional<T> m_value;
+};
+
+template <>
+class CompletionSource<void> : public details::CompletionState {
+public:
+    using Callback = Delegate<void()>;
+
+    CompletionSource() = default;
+
+    Callback delegate() { return MakeDelegate<&CompletionSource::complete>(this); }
+
+    void complete() { signal(); }
+
+    void reset() { rearm(); }
+
+    void await_resume() {}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// DelegateAwaiter starts an operation when awaited, passing it the callback
+// which resumes the coroutine.  The initiating function receives the
+// Delegate<void(T)>, and may call it before returning:
+//
+//     size_t n = co_await AwaitDelegate<size_t>([&](Delegate<void(size_t)> done) {
+//         socket.asyncRead(buffer, done);
+//     });
+//
+
+template <typename T, class Initiate>
+class DelegateAwaiter : public CompletionSource<T> {
+public:
+    explicit DelegateAwaiter(Initiate initiate)
+        : m_initiate(std::move(initiate))
+    {}
+
+    // Completing during m_initiate only stores the result, the coroutine is
+    // not suspended yet and simply continues
+    bool await_suspend(std::coroutine_handle<> h) {
+        m_initiate(this->delegate());
+        return CompletionSource<T>::await_suspend(h);
+    }
+
+private:
+    Initiate m_initiate;
+};
+
+template <typename T, class Initiate>
+DelegateAwaiter<T, typename std::decay<Initiate>::type> AwaitDelegate(Initiate&& initiate) {
+    return DelegateAwaiter<T, typename std::decay<Initiate>::type>(std::forward<Initiate>(initiate));
+}
+
+} // end delly namespace
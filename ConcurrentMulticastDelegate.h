@@ -0,0 +1,305 @@
+#pragma once
+
+#include "Delegate.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace delly {
+
+namespace details {
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Epoch based reclamation shared by all concurrent delegates.
+//
+// A reader announces the current epoch in its own cache line while it reads
+// shared data, and clears it when done.  Entering and leaving only store to
+// that line, there is no read-modify-write on the read path.  A writer which
+// unlinks data bumps the epoch and may free the data once no reader announced
+// an epoch at or before the bump.
+//
+
+class EpochDomain {
+public:
+    static const size_t MaxReaders = 256;
+
+    static EpochDomain& Instance() {
+        static EpochDomain domain;
+        return domain;
+    }
+
+    // Enter a read section, sections nest within a thread
+    inline void enter() {
+        ReaderThread& reader = ThisReader();
+        if (reader.depth++ == 0) {
+            if (!reader.slot)
+                reader.slot = acquireSlot();
+            reader.slot->epoch.store(m_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+            // Order the announcement before any read of shared data
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    inline void exit() {
+        ReaderThread& reader = ThisReader();
+        if (--reader.depth == 0)
+            reader.slot->epoch.store(0, std::memory_order_release);
+    }
+
+    // Called by writers after unlinking data, returns the epoch the data was retired in
+    uint64_t retire() {
+        uint64_t epoch = m_epoch.fetch_add(1, std::memory_order_acq_rel);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return epoch;
+    }
+
+    // Oldest epoch announced by a reader, data retired before it can be freed
+    uint64_t oldestReader() const {
+        uint64_t oldest = ~uint64_t(0);
+        for (const ReaderSlot& slot : m_slots) {
+            uint64_t e = slot.epoch.load(std::memory_order_acquire);
+            if (e != 0 && e < oldest)
+                oldest = e;
+        }
+        return oldest;
+    }
+
+    // True when no reader can still see data retired in 'epoch'
+    bool isSafe(uint64_t epoch) const { return epoch < oldestReader(); }
+
+    // Wait until data retired in 'epoch' can be freed
+    void synchronize(uint64_t epoch) const {
+        while (!isSafe(epoch))
+            std::this_thread::yield();
+    }
+
+private:
+    struct alignas(CacheLineSize) ReaderSlot {
+        std::atomic<uint64_t> epoch{0};
+        std::atomic<bool> used{false};
+    };
+
+    struct ReaderThread {
+        ReaderSlot* slot = nullptr;
+        unsigned depth = 0;
+
+        ~ReaderThread() {
+            if (slot)
+                slot->used.store(false, std::memory_order_release);
+        }
+    };
+
+    static ReaderThread& ThisReader() {
+        static thread_local ReaderThread reader;
+        return reader;
+    }
+
+    // Once per thread: claim a free reader slot
+    ReaderSlot* acquireSlot() {
+        for (;;) {
+            for (ReaderSlot& slot : m_slots) {
+                bool expected = false;
+                if (!slot.used.load(std::memory_order_relaxed)
+                    && slot.used.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                    return &slot;
+            }
+            // More live reader threads than slots, wait for one to exit
+            std::this_thread::yield();
+        }
+    }
+
+    std::atomic<uint64_t> m_epoch{1};
+    ReaderSlot m_slots[MaxReaders];
+};
+
+// Scoped read section
+class EpochGuard {
+public:
+    EpochGuard() { EpochDomain::Instance().enter(); }
+    ~EpochGuard() { EpochDomain::Instance().exit(); }
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+} // end details namespace
+
+template <typename Signature> class ConcurrentMulticastDelegate;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// ConcurrentMulticastDelegate invokes any number of delegates and can be
+// invoked, added to and removed from on any thread at the same time.
+//
+// Invocation reads an immutable snapshot of the subscribers without locks.
+// Adding or removing copies the snapshot, publishes the copy and frees the
+// old snapshot once no invocation can still use it.  Writers are serialized
+// by a mutex and cost O(n), they are meant to be rare compared to invocation.
+//
+// A subscriber may still be invoked by a concurrent invocation which started
+// before it was removed.  Call synchronize() after removal before destroying
+// the subscriber.  synchronize() and the destructor wait for invocations in
+// progress, so they must not be called from a subscriber.
+//
+
+template <typename... Args>
+class ConcurrentMulticastDelegate<void(Args...)> {
+
+    using DummyClass = details::DummyClass;
+    using DelegateStorage = details::DelegateStorage;
+    using DelegateFuncStorage = details::DelegateFuncStorage;
+
+public:
+    using DelegateType = Delegate<void(Args...)>;
+    using Handle = uint64_t;
+
+    ConcurrentMulticastDelegate() = default;
+    ConcurrentMulticastDelegate(const ConcurrentMulticastDelegate&) = delete;
+    ConcurrentMulticastDelegate& operator=(const ConcurrentMulticastDelegate&) = delete;
+
+    ~ConcurrentMulticastDelegate() {
+        // Invocations must be complete, wait for any reader still leaving
+        std::lock_guard<std::mutex> lock(m_writeLock);
+        publish(nullptr);
+        synchronizeLocked();
+    }
+
+    // Add a subscriber, returns the handle used to remove it
+    Handle add(const DelegateType& d) {
+        std::lock_guard<std::mutex> lock(m_writeLock);
+        const Snapshot* current = m_head.load(std::memory_order_relaxed);
+        Snapshot* next = current ? new Snapshot(*current) : new Snapshot();
+        const DelegateStorage& s = d.storage();
+        const Handle h = ++m_lastHandle;
+        next->objects.push_back(s.getThis());
+        next->funcs.push_back(s.getFuncStorage());
+        next->handles.push_back(h);
+        publish(next);
+        return h;
+    }
+
+    // Remove a subscriber, returns false if it was already removed
+    bool remove(Handle h) {
+        std::lock_guard<std::mutex> lock(m_writeLock);
+        const Snapshot* current = m_head.load(std::memory_order_relaxed);
+        if (!current)
+            return false;
+        for (size_t i = 0; i < current->handles.size(); ++i) {
+            if (current->handles[i] == h) {
+                publish(current->without(i));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Remove the first subscriber equal to the delegate
+    bool remove(const DelegateType& d) {
+        std::lock_guard<std::mutex> lock(m_writeLock);
+        const Snapshot* current = m_head.load(std::memory_order_relaxed);
+        if (!current)
+            return false;
+        const DelegateStorage& s = d.storage();
+        for (size_t i = 0; i < current->objects.size(); ++i) {
+            if (DelegateStorage::FromParts(current->objects[i], current->funcs[i]) == s) {
+                publish(current->without(i));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(m_writeLock);
+        publish(nullptr);
+    }
+
+    // Wait until no invocation can still call a removed subscriber
+    void synchronize() {
+        std::lock_guard<std::mutex> lock(m_writeLock);
+        synchronizeLocked();
+    }
+
+    size_t size() const {
+        details::EpochGuard guard;
+        const Snapshot* current = m_head.load(std::memory_order_acquire);
+        return current ? current->objects.size() : 0;
+    }
+
+    inline bool empty() const { return size() == 0; }
+
+    // Invoke every subscriber of the current snapshot
+    void operator() (Args ... args) const {
+        details::EpochGuard guard;
+        const Snapshot* current = m_head.load(std::memory_order_acquire);
+        if (!current)
+            return;
+
+        DummyClass* const* objects = current->objects.data();
+        const DelegateFuncStorage* funcs = current->funcs.data();
+        const size_t n = current->objects.size();
+        for (size_t i = 0; i < n; ++i)
+            DelegateType(DelegateStorage::FromParts(objects[i], funcs[i]))(args...);
+    }
+
+private:
+    struct Snapshot {
+        std::vector<DummyClass*> objects;
+        std::vector<DelegateFuncStorage> funcs;
+        std::vector<Handle> handles;
+
+        // Copy of the snapshot without entry i, or null when empty
+        Snapshot* without(size_t i) const {
+            if (objects.size() == 1)
+                return nullptr;
+            Snapshot* s = new Snapshot(*this);
+            s->objects.erase(s->objects.begin() + i);
+            s->funcs.erase(s->funcs.begin() + i);
+            s->handles.erase(s->handles.begin() + i);
+            return s;
+        }
+    };
+
+    // Swap in the next snapshot and retire the current one
+    void publish(const Snapshot* next) {
+        const Snapshot* previous = m_head.exchange(next, std::memory_order_acq_rel);
+        if (previous)
+            m_retired.emplace_back(previous, details::EpochDomain::Instance().retire());
+        reclaim();
+    }
+
+    // Free retired snapshots no reader can see
+    void reclaim() {
+        if (m_retired.empty())
+            return;
+        const uint64_t oldest = details::EpochDomain::Instance().oldestReader();
+        size_t kept = 0;
+        for (auto& retired : m_retired) {
+            if (retired.second < oldest)
+                delete retired.first;
+            else
+                m_retired[kept++] = retired;
+        }
+        m_retired.resize(kept);
+    }
+
+    void synchronizeLocked() {
+        uint64_t epoch = details::EpochDomain::Instance().retire();
+        details::EpochDomain::Instance().synchronize(epoch);
+        reclaim();
+    }
+
+    std::atomic<const Snapshot*> m_head{nullptr};
+
+    // Writer state
+    std::mutex m_writeLock;
+    std::vector<std::pair<const Snapshot*, uint64_t>> m_retired;
+    Handle m_lastHandle = 0;
+};
+
+} // end delly namespace
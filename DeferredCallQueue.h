@@ -0,0 +1,196 @@
+#pragma once
+
+#include "Delegate.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace delly {
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// DeferredCallQueue passes delegate calls from any number of threads to one
+// consumer thread, eg. an event loop.
+//
+// Each call is one record in a ring buffer of bytes: a header word, the
+// function unpacking the record, the delegate storage and the arguments,
+// which must be trivially copyable.  Nothing is allocated after
+// construction.  Producers reserve a record by a compare and swap on the
+// tail, fill it and publish it by storing its header.  The consumer invokes
+// records in order of reservation, stopping at the first one not yet
+// published, and zeroes the records it consumed before handing the space
+// back, so a zero header always means "not published".
+//
+// tryPush returns false when the ring is full, push waits for the consumer.
+// drain must only be called from one thread at a time, and not from a call
+// it makes.
+//
+
+class DeferredCallQueue {
+
+    using DelegateStorage = details::DelegateStorage;
+    using Invoker = void (*)(const void* record);
+
+public:
+    // Records are aligned on 8 bytes, the header word
+    static constexpr size_t RecordAlignment = sizeof(uint64_t);
+
+    // Capacity in bytes, rounded up to a power of two
+    explicit DeferredCallQueue(size_t capacity = 1 << 16) {
+        m_capacity = 64;
+        while (m_capacity < capacity)
+            m_capacity *= 2;
+        m_buffer.reset(new uint64_t[m_capacity / sizeof(uint64_t)]());
+    }
+
+    DeferredCallQueue(const DeferredCallQueue&) = delete;
+    DeferredCallQueue& operator=(const DeferredCallQueue&) = delete;
+
+    inline size_t capacity() const { return m_capacity; }
+
+    // Queue a call of d with the arguments, returns false if the ring is full
+    template <typename... Args, typename... Values>
+    bool tryPush(const Delegate<void(Args...)>& d, Values&&... values) {
+        using Record = CallRecord<Args...>;
+        static_assert(sizeof...(Args) == sizeof...(Values), "Wrong number of arguments");
+        static_assert(alignof(Record) <= RecordAlignment, "Arguments must not be over-aligned");
+        assert(!d.empty());
+
+        constexpr size_t size = RoundUp(sizeof(uint64_t) + sizeof(Record));
+        assert(size <= m_capacity / 4);
+
+        uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t offset, padding;
+        for (;;) {
+            offset = size_t(tail & (m_capacity - 1));
+            // Records do not wrap, pad to the start of the ring instead
+            padding = (offset + size > m_capacity) ? m_capacity - offset : 0;
+            const uint64_t head = m_head.load(std::memory_order_acquire);
+            // The tail was read before the head: if other producers and the
+            // consumer moved past it since, it is stale, not the ring full
+            if (head > tail) {
+                tail = m_tail.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (tail + padding + size - head > m_capacity)
+                return false;
+            if (m_tail.compare_exchange_weak(tail, tail + padding + size,
+                                             std::memory_order_relaxed, std::memory_order_relaxed))
+                break;
+        }
+
+        if (padding) {
+            publish(offset, padding | PaddingFlag);
+            offset = 0;
+        }
+        void* record = recordAt(offset);
+        new (record) Record{ &Record::Invoke, d.storage(),
+                             typename Record::Arguments(std::forward<Values>(values)...) };
+        publish(offset, size);
+        return true;
+    }
+
+    // Queue a call, waiting while the ring is full
+    template <typename... Args, typename... Values>
+    void push(const Delegate<void(Args...)>& d, Values&&... values) {
+        while (!tryPush(d, values...))
+            std::this_thread::yield();
+    }
+
+    // Invoke queued calls in order, at most maxCalls, from the consumer
+    // thread.  Returns the number of calls made.
+    size_t drain(size_t maxCalls = ~size_t(0)) {
+        const uint64_t head = m_head.load(std::memory_order_relaxed);
+        uint64_t position = head;
+        size_t calls = 0;
+        // Consumed headers are only zeroed at the end, so stop after one lap
+        while (calls < maxCalls && position - head < m_capacity) {
+            const size_t offset = size_t(position & (m_capacity - 1));
+            const uint64_t header = __atomic_load_n(headerAt(offset), __ATOMIC_ACQUIRE);
+            if (header == 0)
+                break;
+            if (!(header & PaddingFlag)) {
+                const void* record = recordAt(offset);
+                (*static_cast<const Invoker*>(record))(record);
+                ++calls;
+            }
+            position += header & ~PaddingFlag;
+        }
+        release(head, position);
+        return calls;
+    }
+
+    // True if no call is queued or being queued
+    bool empty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    // Flag in the header of padding records, sizes are multiples of 8
+    static constexpr uint64_t PaddingFlag = 1;
+
+    // Arguments are stored by value, also for reference parameters
+    template <typename... Args>
+    struct CallRecord {
+        using Arguments = std::tuple<typename std::decay<Args>::type...>;
+        static_assert(std::conjunction<std::is_trivially_copyable<typename std::decay<Args>::type>...>::value,
+                      "Queued arguments must be trivially copyable");
+        static_assert(std::is_trivially_destructible<Arguments>::value);
+
+        Invoker invoke;
+        DelegateStorage storage;
+        Arguments args;
+
+        static void Invoke(const void* p) {
+            const CallRecord& r = *static_cast<const CallRecord*>(p);
+            std::apply(Delegate<void(Args...)>(r.storage), r.args);
+        }
+    };
+
+    static constexpr size_t RoundUp(size_t size) {
+        return (size + RecordAlignment - 1) & ~(RecordAlignment - 1);
+    }
+
+    inline uint64_t* headerAt(size_t offset) const {
+        return m_buffer.get() + offset / sizeof(uint64_t);
+    }
+
+    // The record follows its header
+    inline void* recordAt(size_t offset) const { return headerAt(offset) + 1; }
+
+    void publish(size_t offset, uint64_t header) {
+        __atomic_store_n(headerAt(offset), header, __ATOMIC_RELEASE);
+    }
+
+    // Zero the consumed bytes, then hand them back to producers
+    void release(uint64_t head, uint64_t position) {
+        if (position == head)
+            return;
+        const size_t begin = size_t(head & (m_capacity - 1));
+        const size_t bytes = size_t(position - head);
+        if (begin + bytes <= m_capacity) {
+            memset(headerAt(begin), 0, bytes);
+        } else {
+            memset(headerAt(begin), 0, m_capacity - begin);
+            memset(headerAt(0), 0, bytes - (m_capacity - begin));
+        }
+        m_head.store(position, std::memory_order_release);
+    }
+
+    // Byte positions, increasing forever; the offset is position & (capacity - 1)
+    alignas(details::CacheLineSize) std::atomic<uint64_t> m_tail{0};
+    alignas(details::CacheLineSize) std::atomic<uint64_t> m_head{0};
+
+    alignas(details::CacheLineSize) std::unique_ptr<uint64_t[]> m_buffer;
+    size_t m_capacity;
+};
+
+} // end delly namespace
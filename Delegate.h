@@ -1,7 +1,12 @@
 #pragma once
 // Derived from: FastDelegate by Don Clugston, Mar 2004.
 
+#include <cstdint>
 #include <cstring>
+#include <functional>
+#include <new>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 
 #include <cassert>
@@ -14,6 +19,27 @@
 #define DEBUG_ASSERT(x)
 #endif
 
+// Set to 1 to count the calls of every delegate and their cycles by target,
+// see DelegateProfiler.h.  Every translation unit must use the same setting.
+#ifndef DELEGATE_PROFILING
+#define DELEGATE_PROFILING 0
+#endif
+
+#if DELEGATE_PROFILING
+#include "DelegateProfiler.h"
+#endif
+
+// Set to 1 to record the calls of selected delegates to a trace file per
+// thread, see DelegateTracer.h.  Every translation unit must use the same
+// setting.
+#ifndef DELEGATE_TRACING
+#define DELEGATE_TRACING 0
+#endif
+
+#if DELEGATE_TRACING
+#include "DelegateTracer.h"
+#endif
+
 namespace delly {
 
 static_assert(sizeof((int*)nullptr) == sizeof(void(*)()),
@@ -21,6 +47,16 @@ static_assert(sizeof((int*)nullptr) == sizeof(void(*)()),
 
 namespace details {
 
+// Finalizer of MurmurHash3, spreads every input bit over the result
+inline uint64_t MixHash(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
 template <class OutputClass, class InputClass>
 inline OutputClass horrible_cast(const InputClass input){
 
@@ -36,6 +72,81 @@ inline OutputClass horrible_cast(const InputClass input){
     return u.out;
 }
 
+// Holds an argument converted to T for the duration of a call
+template <typename T>
+class ArgumentHolder {
+public:
+    ArgumentHolder() = default;
+    ArgumentHolder(const ArgumentHolder&) = delete;
+    ArgumentHolder& operator=(const ArgumentHolder&) = delete;
+
+    ~ArgumentHolder() {
+        if (m_constructed)
+            reinterpret_cast<T*>(&m_storage)->~T();
+    }
+
+    template <typename U>
+    T* construct(U&& u) {
+        T* p = new (&m_storage) T(std::forward<U>(u));
+        m_constructed = true;
+        return p;
+    }
+
+private:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type m_storage;
+    bool m_constructed = false;
+};
+
+// Passes a by-value argument through the delegate by reference.  The target
+// parameter is constructed once, from the caller's argument, when the target
+// is called.  Other types convertible to T are converted once, when the
+// delegate is called, and then moved.
+template <typename T>
+class ForwardArg {
+public:
+    // Move only types cannot be passed as lvalues, like in a direct call
+    template <typename U = T, typename = typename std::enable_if<
+                  std::is_copy_constructible<U>::value>::type>
+    ForwardArg(const T& value) : m_value(&value), m_move(false) {}
+
+    ForwardArg(T&& value) : m_value(&value), m_move(true) {}
+
+    template <typename U, typename = typename std::enable_if<
+                  std::is_convertible<U&&, T>::value
+                  && !std::is_same<typename std::decay<U>::type, T>::value
+                  && !std::is_same<typename std::decay<U>::type, ForwardArg>::value>::type>
+    ForwardArg(U&& value, ArgumentHolder<T>&& holder = ArgumentHolder<T>())
+        : m_value(holder.construct(std::forward<U>(value))), m_move(true) {}
+
+    operator T() const {
+        if constexpr (std::is_copy_constructible<T>::value) {
+            if (!m_move)
+                return T(*m_value);
+        }
+        return T(std::move(*const_cast<T*>(m_value)));
+    }
+
+private:
+    const T* m_value;
+    bool m_move;
+};
+
+// How the delegate receives an argument of type T.  References, and by-value
+// arguments which are cheap to copy, are passed as is.  Other by-value
+// arguments are passed as ForwardArg, so they are copied or moved as many
+// times as in a direct call rather than once more per call through the
+// delegate.
+template <typename T>
+using ParamType = typename std::conditional<
+    std::is_reference<T>::value
+    || (std::is_trivially_copyable<T>::value && sizeof(T) <= 2 * sizeof(void*)),
+    T, ForwardArg<T>>::type;
+
+// How the delegate receives braced initializer lists for an argument of type
+// T, which needs no complete type: by-value arguments as const references.
+template <typename T>
+using BracedParamType = typename std::conditional<std::is_reference<T>::value, T, const T&>::type;
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Delegate optimization and sizing across architectures and compilers
@@ -109,6 +220,7 @@ class DummyClass;
 #endif
 
 static const size_t SingleMemberFuncSize = sizeof(void (DummyClass::*)());
+static const size_t CacheLineSize = 64;
 using StaticFunc = void (*) ();
 using DummyMemFunc = void (DummyClass::*) ();
 
@@ -116,6 +228,41 @@ using DummyMemFunc = void (DummyClass::*) ();
 template <size_t MethodSize>
 struct BindHelper;
 
+// Adjusts the this pointer and resolves virtual methods to the final
+// overrider of the bound object.  Representations which cannot be resolved
+// fall back to a regular bind.
+template <size_t MethodSize>
+struct ResolveHelper : BindHelper<MethodSize> {};
+
+// Decodes a bound method once into a target which can be called repeatedly
+// without decoding it again.  Representations which cannot be decoded keep
+// calling through the method pointer.
+template <size_t MethodSize>
+struct DirectCallHelper
+{
+    template <typename RetType, typename... Args>
+    struct Target {
+        DummyClass* obj;
+        RetType (DummyClass::*func)(Args...);
+
+        inline RetType operator()(ParamType<Args>... args) const {
+            return (obj->*func)(std::forward<ParamType<Args>>(args)...);
+        }
+
+        // Identifies the method, for grouping calls by target
+        inline uintptr_t address() const {
+            uintptr_t a;
+            memcpy(&a, &func, sizeof(a));
+            return a;
+        }
+    };
+
+    template <typename RetType, typename... Args>
+    static Target<RetType, Args...> Decode(DummyClass* pthis, RetType (DummyClass::*func)(Args...)) {
+        return { pthis, func };
+    }
+};
+
 #if defined(_MSC_VER)
 #pragma warning(push)
 #pragma warning( disable : 4820 )
@@ -263,6 +410,7 @@ struct BindHelper<SingleMemberFuncSize + 3*sizeof(int)>
 };
 
 using DelegateFuncStorage = DummyMemFunc;
+using DelegateFuncRepr = DummyMemFunc;
 
 #pragma warning(pop)
 #else // End _MSC
@@ -274,6 +422,39 @@ struct ItaniumMemberFuncRepr {
     std::ptrdiff_t  delta; // byte adjustment to this
 };
 
+// Virtual methods are flagged by the low bit of 'func', which then holds
+// 1 + the byte offset into the vtable.  ARM and MIPS cannot spare the low bit
+// of a code pointer, so the flag is the low bit of 'delta' and the
+// adjustment is stored shifted left by one.
+#if defined(__arm__) || defined(__aarch64__) || defined(__mips__)
+#define ITANIUM_VIRTUAL_BIT_IN_DELTA 1
+#else
+#define ITANIUM_VIRTUAL_BIT_IN_DELTA 0
+#endif
+
+// Applies the this adjustment of a method and looks up virtual methods in the
+// vtable of the object.  Returns the adjusted object and the code to call.
+inline std::pair<DummyClass*, StaticFunc> ResolveMethod(void* pthis, ItaniumMemberFuncRepr repr) {
+    auto ptr = reinterpret_cast<std::ptrdiff_t>(repr.func);
+#if ITANIUM_VIRTUAL_BIT_IN_DELTA
+    const bool isVirtual = (repr.delta & 1) != 0;
+    const std::ptrdiff_t delta = repr.delta >> 1;
+    const std::ptrdiff_t vtableOffset = ptr;
+#else
+    const bool isVirtual = (ptr & 1) != 0;
+    const std::ptrdiff_t delta = repr.delta;
+    const std::ptrdiff_t vtableOffset = ptr - 1;
+#endif
+    char* obj = reinterpret_cast<char*>(pthis) + delta;
+    StaticFunc code = repr.func;
+    if (isVirtual) {
+        // The vtable pointer is at the start of the adjusted object
+        const char* vtable = *reinterpret_cast<const char* const*>(obj);
+        code = *reinterpret_cast<const StaticFunc*>(vtable + vtableOffset);
+    }
+    return { reinterpret_cast<DummyClass*>(obj), code };
+}
+
 #if ITANIUM_DELEGATE_SPACE_SAVER
 
 template <>
@@ -306,7 +487,7 @@ public:
 
     DelegateFuncStorage() = default;
 
-    DelegateFuncStorage(const std::nullptr_t)
+    constexpr DelegateFuncStorage(const std::nullptr_t)
         : DelegateFuncStorage() {}
 
     DelegateFuncStorage(DummyMemFunc f)
@@ -343,6 +524,9 @@ private:
     StaticFunc m_func = nullptr;
 };
 
+// Representation of DelegateFuncStorage, trivially constructible
+using DelegateFuncRepr = StaticFunc;
+
 #else // Non-space saver, just storing the object and method pointer
 
 template <>
@@ -358,20 +542,116 @@ struct BindHelper<SingleMemberFuncSize>
 };
 
 using DelegateFuncStorage = DummyMemFunc;
+using DelegateFuncRepr = DummyMemFunc;
 
 #endif // !ITANIUM_DELEGATE_SPACE_SAVER
 
+template <>
+struct ResolveHelper<SingleMemberFuncSize>
+{
+    // Looks up the vtable of the bound object once, so the stored method is
+    // the final code pointer with no adjustment left to apply on invocation.
+    // The dynamic type of the object must not change while bound.
+    template <class X, class XFuncType>
+    static std::pair<DummyClass*, DummyMemFunc> Convert(X* pthis, XFuncType func) {
+
+        // Union used to retrieve function pointer
+        union {
+            XFuncType func;
+            ItaniumMemberFuncRepr repr;
+        } u;
+        static_assert(sizeof(ItaniumMemberFuncRepr) == sizeof(XFuncType));
+        u.func = func;
+        auto resolved = ResolveMethod(pthis, u.repr);
+
+#if !ITANIUM_VIRTUAL_BIT_IN_DELTA
+        // Code at an odd address, such as an unaligned this adjusting thunk,
+        // would read as a vtable offset.  Keep the regular binding instead.
+        if (reinterpret_cast<std::uintptr_t>(resolved.second) & 1)
+            return BindHelper<SingleMemberFuncSize>::Convert(pthis, func);
+#endif
+
+        // Union used to build a non-virtual method with no adjustment
+        union {
+            DummyMemFunc func;
+            ItaniumMemberFuncRepr repr;
+        } r;
+        r.repr.func = resolved.second;
+        r.repr.delta = 0;
+        return { resolved.first, r.func };
+    }
+};
+
+template <>
+struct DirectCallHelper<SingleMemberFuncSize>
+{
+    // The code of a resolved method is called as a function taking the
+    // object as its first argument, which is how the ABI passes 'this'.
+    template <typename RetType, typename... Args>
+    struct Target {
+        DummyClass* obj;
+        RetType (*code)(DummyClass*, Args...);
+
+        inline RetType operator()(ParamType<Args>... args) const {
+            return code(obj, std::forward<ParamType<Args>>(args)...);
+        }
+
+        inline uintptr_t address() const { return reinterpret_cast<uintptr_t>(code); }
+    };
+
+    template <typename RetType, typename... Args>
+    static Target<RetType, Args...> Decode(DummyClass* pthis, RetType (DummyClass::*func)(Args...)) {
+        union {
+            RetType (DummyClass::*func)(Args...);
+            ItaniumMemberFuncRepr repr;
+        } u;
+        static_assert(sizeof(ItaniumMemberFuncRepr) == sizeof(func));
+        u.func = func;
+        auto resolved = ResolveMethod(pthis, u.repr);
+        return { resolved.first, reinterpret_cast<RetType (*)(DummyClass*, Args...)>(resolved.second) };
+    }
+};
+
 #endif // !_MSC_VER
 
+// Decomposes a member function pointer type known at compile time
+template <class MemFunc>
+struct MethodTraits;
+
+template <class X, typename RetType, typename... Args>
+struct MethodTraits<RetType (X::*)(Args...)> {
+    using Class = X;
+    using Object = X;
+    using Signature = RetType(Args...);
+};
+
+template <class X, typename RetType, typename... Args>
+struct MethodTraits<RetType (X::*)(Args...) const> {
+    using Class = X;
+    using Object = const X;
+    using Signature = RetType(Args...);
+};
+
+template <class X, typename RetType, typename... Args>
+struct MethodTraits<RetType (X::*)(Args...) noexcept>
+    : MethodTraits<RetType (X::*)(Args...)> {};
+
+template <class X, typename RetType, typename... Args>
+struct MethodTraits<RetType (X::*)(Args...) const noexcept>
+    : MethodTraits<RetType (X::*)(Args...) const> {};
+
 // Type-erased storage class for a delegate.  It can be cleared, but not directly
 // invoked.  It must be converted to be properly invoked.
 // All callables are stored as a pointer to an undefined class and an instance method.
 //
-// For function pointer storage, the function pointer is stored in m_this using
-// horrible_cast. In this case the DelegateStorage implementation is simple:
+// For function pointer storage, the function pointer is stored in m_this, with
+// no method.  Invoking it is then a single indirect call.  Delegate writes
+// function pointers and compile time methods through typed views of the same
+// layout, which also works in constant expressions.
 // +--m_this--+-- p_func -+-- Meaning---------------------+
 // |    0     |  0        | Empty                         |
-// |  !=0     |  !=0*     | Static function or method call|
+// |  !=0     |  0        | Static function               |
+// |  !=0     |  !=0      | Method call                   |
 // +----------+-----------+-------------------------------+
 struct DelegateStorage {
 
@@ -382,6 +662,15 @@ struct DelegateStorage {
 
     inline DummyClass *getThis() const { return m_this; }
     inline DummyMemFunc getMemFunc() const { return DummyMemFunc(m_func); }
+    inline const DelegateFuncStorage& getFuncStorage() const { return m_func; }
+
+    // Rebuild storage from the parts returned by getThis and getFuncStorage
+    static inline DelegateStorage FromParts(DummyClass* p, const DelegateFuncStorage& f) {
+        DelegateStorage s;
+        s.m_this = p;
+        s.m_func = f;
+        return s;
+    }
 
     void reset() { m_this = nullptr; m_func = nullptr; }
 
@@ -389,6 +678,9 @@ struct DelegateStorage {
     inline explicit operator bool() const { return !empty(); }
     inline bool operator! () const { return empty(); }
 
+    // False for static functions and empty storage
+    inline bool hasMethod() const { return !(m_func == nullptr); }
+
     inline bool operator==(const DelegateStorage& o) const {
         return m_this == o.m_this && m_func == o.m_func;
     }
@@ -405,6 +697,16 @@ struct DelegateStorage {
         return o.operator<(*this);
     }
 
+    // Hash of the object and method, consistent with operator==
+    inline size_t hash() const {
+        uint64_t words[(sizeof(m_func) + sizeof(uint64_t) - 1) / sizeof(uint64_t)] = {};
+        memcpy(words, &m_func, sizeof(m_func));
+        uint64_t h = uint64_t(reinterpret_cast<uintptr_t>(m_this));
+        for (uint64_t w : words)
+            h = h * 0x9e3779b97f4a7c15ULL + w;
+        return size_t(MixHash(h));
+    }
+
 private:
     DummyClass* m_this = nullptr;
     DelegateFuncStorage m_func = nullptr;
@@ -429,10 +731,15 @@ class Delegate<RetType(Args...)> {
 public:
     using StaticFunc = RetType (*) (Args...);
 
-    Delegate() = default;
-    Delegate(const Delegate& o) = default;
-    Delegate(Delegate&& o) = default;
-    Delegate(const std::nullptr_t) noexcept : Delegate() {}
+    constexpr Delegate() = default;
+    constexpr Delegate(const Delegate& o) = default;
+    constexpr Delegate(Delegate&& o) = default;
+    constexpr Delegate(const std::nullptr_t) noexcept : Delegate() {}
+
+    // From type-erased storage, as returned by storage()
+    explicit Delegate(const DelegateStorage& storage) noexcept
+        : m_storage(storage)
+    {}
 
     // Non-const pointer and method
     template <class X, class Y>
@@ -465,32 +772,87 @@ public:
     {}
 
     // Static method or function
-    Delegate(StaticFunc func)
-        : m_storage(MakeStorage(&Delegate::InvokeStaticFunction, func))
+    constexpr Delegate(StaticFunc func)
+        : m_function{ func, nullptr }
     {}
 
-    // Invoke the delegate
-    RetType operator() (Args ... args) const {
-        DummyClass* obj = m_storage.getThis();
-        DummyMemFunc func = getMemFunc();
-        return (obj->*func)(std::forward<Args>(args)...);
+    // Invoke the delegate.  Arguments are passed to the target with no more
+    // copies or moves than a direct call, see details::ParamType.  How they
+    // are passed is decided at the call, so the parameter types may still be
+    // incomplete where the delegate is declared.
+    template <typename... Params, typename = typename std::enable_if<
+                  std::conjunction<std::is_convertible<Params&&, Args>...>::value>::type>
+    inline RetType operator() (Params&& ... params) const {
+        return invokeTarget<details::ParamType<Args>...>(std::forward<Params>(params)...);
+    }
+
+    // Braced initializer lists, which cannot be forwarded, and const
+    // arguments, which the overload above takes no better than this one
+    inline RetType operator() (details::BracedParamType<Args> ... args) const {
+        return invokeTarget<details::ParamType<Args>...>(std::forward<details::BracedParamType<Args>>(args)...);
+    }
+
+    // Invoke the delegate once for each element of a range, which is the
+    // argument of the call, eg. d.invokeEach(messages).  The bound target is
+    // decoded once, including any virtual lookup, and then called directly
+    // in a tight loop.  Return values are discarded.  The bound object must
+    // keep its dynamic type during the loop.
+    template <class Range>
+    void invokeEach(Range&& range) const {
+        static_assert(sizeof...(Args) == 1, "invokeEach requires a single argument, use invokeBatch");
+        DEBUG_ASSERT(!empty());
+        withDirectTarget([&](const auto& target) {
+            for (auto&& arg : range)
+                callTarget(target, std::forward<decltype(arg)>(arg));
+        });
+    }
+
+    // Invoke the delegate once for each tuple of arguments of a range,
+    // see invokeEach
+    template <class Range>
+    void invokeBatch(Range&& tuples) const {
+        DEBUG_ASSERT(!empty());
+        withDirectTarget([&](const auto& target) {
+            for (auto&& t : tuples) {
+                std::apply([&](auto&&... args) {
+                    callTarget(target, std::forward<decltype(args)>(args)...);
+                }, std::forward<decltype(t)>(t));
+            }
+        });
+    }
+
+    template <class Tuple>
+    void invokeBatch(const Tuple* tuples, size_t count) const {
+        DEBUG_ASSERT(!empty());
+        withDirectTarget([&](const auto& target) {
+            for (size_t i = 0; i < count; ++i) {
+                std::apply([&](const auto&... args) {
+                    callTarget(target, args...);
+                }, tuples[i]);
+            }
+        });
     }
 
     void reset() { m_storage.reset(); }
 
+    // Type-erased storage, for containers of delegates
+    inline const DelegateStorage& storage() const { return m_storage; }
+
     inline bool empty() const { return m_storage.empty(); }
     inline explicit operator bool() const { return !empty(); }
     inline bool operator!() const { return empty(); }
 
-    Delegate& operator=(Delegate&& o) = default;
-    Delegate& operator=(const Delegate& o) = default;
+    constexpr Delegate& operator=(Delegate&& o) = default;
+    constexpr Delegate& operator=(const Delegate& o) = default;
 
     bool operator==(const Delegate& o) const { return m_storage == o.m_storage; }
     bool operator!=(const Delegate& o) const { return m_storage != o.m_storage; }
     bool operator<(const Delegate& o) const { return m_storage < o.m_storage; }
     bool operator>(const Delegate& o) const { return m_storage > o.m_storage; }
 
-    inline bool operator==(StaticFunc func) const { return (!func) ? empty() : (func == getStaticFunc()); }
+    inline bool operator==(StaticFunc func) const {
+        return (!func) ? empty() : (!m_storage.hasMethod() && func == getStaticFunc());
+    }
     inline bool operator!=(StaticFunc func) const { return !operator==(func); }
 
     template <class X, class Y>
@@ -513,16 +875,67 @@ public:
         m_storage = MakeStorage(static_cast<X*>(&p), func);
     }
 
-    inline void bind(StaticFunc func) {
-        m_storage = MakeStorage(&Delegate::InvokeStaticFunction, func);
+    constexpr void bind(StaticFunc func) {
+        m_function = FunctionForm{ func, nullptr };
+    }
+
+    // Bind a method known at compile time, eg. d.bind<&X::method>(obj).
+    // The delegate stores a thunk generated for the method which calls it
+    // directly, so the method can be inlined into the thunk.  These
+    // delegates only compare equal to delegates bound the same way.
+    // Binding objects of static storage duration is a constant expression,
+    // so tables of such delegates need no dynamic initialization.
+    template <auto Method, class Y>
+    constexpr void bind(Y* pthis) {
+        bindMethod<Method>(pthis);
+    }
+
+    template <auto Method, class Y>
+    constexpr void bind(Y& p) {
+        bindMethod<Method>(&p);
+    }
+
+    // Bind a method, resolving virtual methods against the object once.
+    // Invocation then calls the final overrider directly, with no vtable
+    // lookup.  The object must be fully constructed and keep its dynamic
+    // type while bound.  Resolved delegates do not compare equal to
+    // delegates bound to the same method with bind().
+    template <class X, class Y>
+    inline void bindResolved(Y* pthis, RetType (X::* func)(Args...)) {
+        m_storage = MakeResolvedStorage(static_cast<X*>(pthis), func);
+    }
+
+    template <class X, class Y>
+    inline void bindResolved(Y* pthis, RetType (X::* func)(Args...) const) {
+        m_storage = MakeResolvedStorage(static_cast<X*>(pthis), func);
+    }
+
+    template <class X, class Y>
+    inline void bindResolved(const Y* pthis, RetType (X::* func)(Args...) const) {
+        m_storage = MakeResolvedStorage(static_cast<X*>(const_cast<Y*>(pthis)), func);
+    }
+
+    template <class X, class Y>
+    inline void bindResolved(Y& p, RetType (X::* func)(Args...)) {
+        m_storage = MakeResolvedStorage(static_cast<X*>(&p), func);
+    }
+
+    template <class X, class Y>
+    inline void bindResolved(Y& p, RetType (X::* func)(Args...) const) {
+        m_storage = MakeResolvedStorage(static_cast<X*>(&p), func);
     }
 
-    inline Delegate& operator=(StaticFunc func) {
+    constexpr Delegate& operator=(StaticFunc func) {
         bind(func);
         return *this;
     }
 
 private:
+#if DELEGATE_TRACING
+    // Selects targets by targetAddress
+    friend class DelegateTracer;
+#endif
+
     // Store pointer to member
     template <class X, class XMemFunc>
     static DelegateStorage MakeStorage(X *pthis, XMemFunc func)
@@ -531,15 +944,47 @@ private:
         return { p.first, p.second };
     }
 
-    // Store static methods and functions
-    template <class ParentInvokerSig>
-    static DelegateStorage MakeStorage(ParentInvokerSig staticFuncInvoker, StaticFunc func)
+    // Store pointer to member, resolved to the final overrider
+    template <class X, class XMemFunc>
+    static DelegateStorage MakeResolvedStorage(X *pthis, XMemFunc func)
     {
-        /* 'Evil': store function pointer in 'this' pointer */
-        auto f = (func == nullptr) ? nullptr : staticFuncInvoker;
-        auto* dObj = details::horrible_cast<DummyClass*>(func);
-        auto dFunc = reinterpret_cast<details::DummyMemFunc>(f);
-        return DelegateStorage(dObj, dFunc);
+        auto p = details::ResolveHelper<sizeof(func)>::Convert(pthis, func);
+        return { p.first, p.second };
+    }
+
+    // Store a compile time method as its thunk and the object
+    template <auto Method, class Y>
+    constexpr void bindMethod(Y* pthis)
+    {
+        using Traits = details::MethodTraits<decltype(Method)>;
+        static_assert(std::is_same<typename Traits::Signature, RetType(Args...)>::value,
+                      "Method signature must match the delegate");
+        using X = typename Traits::Class;
+        using Object = typename Traits::Object;
+        X* obj = const_cast<X*>(static_cast<Object*>(pthis));
+#if defined(_MSC_VER)
+        m_storage = MakeStorage(obj, &Delegate::template InvokeMethod<Method>);
+#else
+        m_method = MethodForm{ obj, &Delegate::template InvokeMethod<Method> };
+#endif
+    }
+
+    // Calls the target, each argument passed as its details::ParamType
+    template <typename... Params>
+    inline RetType invokeTarget(Params ... args) const {
+#if DELEGATE_PROFILING
+        details::ProfiledCall profiled(targetAddress());
+#endif
+#if DELEGATE_TRACING
+        details::TracedCall traced;
+        if (DelegateTracer::Started())
+            traced.begin<Args...>(targetAddress(), m_storage.hasMethod() ? m_storage.getThis() : nullptr, args...);
+#endif
+        DummyClass* obj = m_storage.getThis();
+        if (!m_storage.hasMethod())
+            return getStaticFunc()(std::forward<Params>(args)...);
+        DummyMemFunc func = getMemFunc();
+        return (obj->*func)(std::forward<Params>(args)...);
     }
 
     inline DummyMemFunc getMemFunc() const {
@@ -548,18 +993,94 @@ private:
     }
 
     inline StaticFunc getStaticFunc() const {
-        // 'Evil' cast from this pointer back to a static function pointer
-        return details::horrible_cast<StaticFunc>(this);
+        // 'Evil' read of the this pointer as a static function pointer
+        return m_function.func;
+    }
+
+    // Calls body once with the decoded target: the function itself for
+    // static functions, the resolved method and object otherwise
+    template <class Body>
+    inline void withDirectTarget(Body&& body) const {
+        if (!m_storage.hasMethod())
+            body(getStaticFunc());
+        else
+            body(details::DirectCallHelper<sizeof(DummyMemFunc)>::Decode(m_storage.getThis(), getMemFunc()));
+    }
+
+    // Calls a target decoded by withDirectTarget, profiled and traced like
+    // a call of the delegate
+    template <class Target, typename... Params>
+    inline void callTarget(const Target& target, Params&& ... params) const {
+#if DELEGATE_PROFILING
+        details::ProfiledCall profiled(CodeOf(target));
+#endif
+#if DELEGATE_TRACING
+        details::TracedCall traced;
+        if (DelegateTracer::Started())
+            traced.begin<Args...>(CodeOf(target), m_storage.hasMethod() ? m_storage.getThis() : nullptr, params...);
+#endif
+        target(std::forward<Params>(params)...);
     }
 
-    RetType InvokeStaticFunction(Args ... args) const {
-        // 'Evil' invoke: this pointer is invalid within the context of this call.
-        // It's actually our static function!
-        auto* func = getStaticFunc();
-        return (*func)(std::forward<Args>(args)...);
+    static inline uintptr_t CodeOf(StaticFunc func) { return reinterpret_cast<uintptr_t>(func); }
+
+    template <class Target>
+    static inline uintptr_t CodeOf(const Target& target) { return target.address(); }
+
+    // Code address of the target, the final overrider of virtual methods
+    inline uintptr_t targetAddress() const {
+        if (!m_storage.hasMethod())
+            return reinterpret_cast<uintptr_t>(getStaticFunc());
+        return details::DirectCallHelper<sizeof(DummyMemFunc)>::Decode(m_storage.getThis(), getMemFunc()).address();
     }
 
-    DelegateStorage m_storage;
+#if defined(_MSC_VER)
+    template <auto Method>
+    RetType InvokeMethod(Args ... args) const {
+        // 'Evil' invoke: this pointer is the object bound to the method
+        using Object = typename details::MethodTraits<decltype(Method)>::Object;
+        auto* obj = reinterpret_cast<Object*>(const_cast<Delegate*>(this));
+        return (obj->*Method)(std::forward<Args>(args)...);
+    }
+#else
+    // 'Evil' invoke: a function called through a method pointer, the ABI
+    // passes 'this' as the first argument.  The low bit of the address must
+    // be clear, or it would read as a virtual method.
+    template <auto Method>
+    [[gnu::aligned(2)]] static RetType InvokeMethod(DummyClass* pthis, Args ... args) {
+        using Object = typename details::MethodTraits<decltype(Method)>::Object;
+        auto* obj = reinterpret_cast<Object*>(pthis);
+        return (obj->*Method)(std::forward<Args>(args)...);
+    }
+#endif
+
+    // Typed views of the storage for function pointers and compile time
+    // methods.  Constant expressions cannot cast them to the type-erased
+    // storage, so they are written through these and read as m_storage.
+    struct FunctionForm {
+        StaticFunc func;
+        details::DelegateFuncRepr none;
+    };
+
+#if !defined(_MSC_VER)
+    struct MethodForm {
+        const void* obj;
+        RetType (*thunk)(DummyClass*, Args...);
+#if !ITANIUM_DELEGATE_SPACE_SAVER
+        std::ptrdiff_t delta = 0;
+#endif
+    };
+    static_assert(sizeof(MethodForm) == sizeof(DelegateStorage));
+#endif
+    static_assert(sizeof(FunctionForm) == sizeof(DelegateStorage));
+
+    union {
+        DelegateStorage m_storage{};
+        FunctionForm m_function;
+#if !defined(_MSC_VER)
+        MethodForm m_method;
+#endif
+    };
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -592,17 +1113,82 @@ Delegate<RetType(Args...)> MakeDelegate(Y& x, RetType (X::*func)(Args...) const)
     return Delegate<RetType(Args...)>(x, func);
 }
 
+// Compile time methods, MakeDelegate<&X::method>(obj)
+
+template <auto Method, class Y>
+constexpr Delegate<typename details::MethodTraits<decltype(Method)>::Signature> MakeDelegate(Y* x) {
+    Delegate<typename details::MethodTraits<decltype(Method)>::Signature> d;
+    d.template bind<Method>(x);
+    return d;
+}
+
+template <auto Method, class Y>
+constexpr Delegate<typename details::MethodTraits<decltype(Method)>::Signature> MakeDelegate(Y& x) {
+    Delegate<typename details::MethodTraits<decltype(Method)>::Signature> d;
+    d.template bind<Method>(x);
+    return d;
+}
+
+// Resolved variants look up virtual methods once, see Delegate::bindResolved
+
+template <class X, class Y, typename RetType, typename... Args>
+Delegate<RetType(Args...)> MakeResolvedDelegate(Y* x, RetType (X::*func)(Args...)) {
+    Delegate<RetType(Args...)> d;
+    d.bindResolved(x, func);
+    return d;
+}
+
+template <class X, class Y, typename RetType, typename... Args>
+Delegate<RetType(Args...)> MakeResolvedDelegate(Y* x, RetType (X::*func)(Args...) const) {
+    Delegate<RetType(Args...)> d;
+    d.bindResolved(x, func);
+    return d;
+}
+
+template <class X, class Y, typename RetType, typename... Args>
+Delegate<RetType(Args...)> MakeResolvedDelegate(const Y* x, RetType (X::*func)(Args...) const) {
+    Delegate<RetType(Args...)> d;
+    d.bindResolved(x, func);
+    return d;
+}
+
+template <class X, class Y, typename RetType, typename... Args>
+Delegate<RetType(Args...)> MakeResolvedDelegate(Y& x, RetType (X::*func)(Args...)) {
+    Delegate<RetType(Args...)> d;
+    d.bindResolved(x, func);
+    return d;
+}
+
+template <class X, class Y, typename RetType, typename... Args>
+Delegate<RetType(Args...)> MakeResolvedDelegate(Y& x, RetType (X::*func)(Args...) const) {
+    Delegate<RetType(Args...)> d;
+    d.bindResolved(x, func);
+    return d;
+}
+
 // For lambda expressions, use a leading '+' operator, MakeDelegate(+[](...) { /*...*/ })
 // Does not work for lambda instances, because type deduction fails
 // Use bind instead:
 //    auto lambda = [](...) { /* ... */ )
 //    Delegate<void(...)> d;
 //    d.bind(lambda)
+// Lambdas with captures cannot be converted, use InplaceDelegate instead.
 template <typename RetType, typename... Args>
-Delegate<RetType(Args...)> MakeDelegate(RetType (* func)(Args...)) {
+constexpr Delegate<RetType(Args...)> MakeDelegate(RetType (* func)(Args...)) {
     return Delegate<RetType(Args...)>(func);
 }
 
 } // end delly namespace
 
+namespace std {
+
+template <typename Signature>
+struct hash<delly::Delegate<Signature>> {
+    size_t operator()(const delly::Delegate<Signature>& d) const noexcept {
+        return d.storage().hash();
+    }
+};
+
+} // end std namespace
+
 #undef DEBUG_ASSERT
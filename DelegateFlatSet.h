@@ -0,0 +1,219 @@
+#pragma once
+
+#include "Delegate.h"
+
+#include <cassert>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace delly {
+
+namespace details {
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Open addressing hash table keyed by delegate storage.
+//
+// Keys are stored inline in one array with linear probing, so a lookup
+// usually reads a single cache line of keys.  An empty delegate marks a free
+// slot, so empty delegates cannot be inserted.  Erase shifts the following
+// entries back instead of leaving tombstones.  Values, if any, are kept in a
+// parallel array and must be default constructible.
+//
+
+template <class Value>
+class DelegateHashTable {
+
+    struct NoValues {};
+    using ValueArray = typename std::conditional<std::is_void<Value>::value,
+                                                 NoValues, std::vector<Value>>::type;
+    static constexpr bool HasValues = !std::is_void<Value>::value;
+
+public:
+    static constexpr size_t NotFound = ~size_t(0);
+
+    inline size_t size() const { return m_size; }
+    inline bool empty() const { return m_size == 0; }
+
+    void clear() {
+        for (auto& k : m_keys)
+            k.reset();
+        if constexpr (HasValues) {
+            for (auto& v : m_values)
+                v = Value();
+        }
+        m_size = 0;
+    }
+
+    // Make room for n entries without rehashing
+    void reserve(size_t n) {
+        size_t capacity = MinCapacity;
+        while (capacity * MaxLoadNum < n * MaxLoadDen)
+            capacity *= 2;
+        if (capacity > m_keys.size())
+            rehash(capacity);
+    }
+
+protected:
+    size_t find(const DelegateStorage& key) const {
+        if (m_keys.empty() || key.empty())
+            return NotFound;
+        const size_t mask = m_keys.size() - 1;
+        for (size_t i = key.hash() & mask;; i = (i + 1) & mask) {
+            if (m_keys[i] == key)
+                return i;
+            if (m_keys[i].empty())
+                return NotFound;
+        }
+    }
+
+    // Returns the slot of the key and whether it was inserted
+    std::pair<size_t, bool> insertKey(const DelegateStorage& key) {
+        assert(!key.empty());
+        if ((m_size + 1) * MaxLoadDen > m_keys.size() * MaxLoadNum)
+            rehash(m_keys.empty() ? MinCapacity : 2 * m_keys.size());
+
+        const size_t mask = m_keys.size() - 1;
+        for (size_t i = key.hash() & mask;; i = (i + 1) & mask) {
+            if (m_keys[i] == key)
+                return { i, false };
+            if (m_keys[i].empty()) {
+                m_keys[i] = key;
+                ++m_size;
+                return { i, true };
+            }
+        }
+    }
+
+    bool eraseKey(const DelegateStorage& key) {
+        size_t i = find(key);
+        if (i == NotFound)
+            return false;
+
+        // Shift back following entries which would no longer be reachable
+        const size_t mask = m_keys.size() - 1;
+        for (size_t j = (i + 1) & mask; !m_keys[j].empty(); j = (j + 1) & mask) {
+            const size_t home = m_keys[j].hash() & mask;
+            // Entry j stays if its home lies cyclically in (i, j]
+            const bool stays = (i <= j) ? (i < home && home <= j)
+                                        : (i < home || home <= j);
+            if (!stays) {
+                m_keys[i] = m_keys[j];
+                if constexpr (HasValues)
+                    m_values[i] = std::move(m_values[j]);
+                i = j;
+            }
+        }
+        m_keys[i].reset();
+        if constexpr (HasValues)
+            m_values[i] = Value();
+        --m_size;
+        return true;
+    }
+
+    std::vector<DelegateStorage> m_keys;
+    ValueArray m_values;
+
+private:
+    static constexpr size_t MinCapacity = 16;
+
+    // Maximum load factor of 7/8
+    static constexpr size_t MaxLoadNum = 7;
+    static constexpr size_t MaxLoadDen = 8;
+
+    void rehash(size_t capacity) {
+        std::vector<DelegateStorage> keys(capacity);
+        ValueArray values;
+        if constexpr (HasValues)
+            values.resize(capacity);
+
+        const size_t mask = capacity - 1;
+        for (size_t j = 0; j < m_keys.size(); ++j) {
+            if (m_keys[j].empty())
+                continue;
+            size_t i = m_keys[j].hash() & mask;
+            while (!keys[i].empty())
+                i = (i + 1) & mask;
+            keys[i] = m_keys[j];
+            if constexpr (HasValues)
+                values[i] = std::move(m_values[j]);
+        }
+        m_keys.swap(keys);
+        if constexpr (HasValues)
+            m_values.swap(values);
+    }
+
+    size_t m_size = 0;
+};
+
+} // end details namespace
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// DelegateFlatSet is a set of delegates, for deduplicating handlers and
+// unsubscribing by value in O(1).  Delegates of any signature are accepted.
+//
+
+class DelegateFlatSet : public details::DelegateHashTable<void> {
+public:
+    // Returns false if the delegate was already present
+    template <typename Signature>
+    bool insert(const Delegate<Signature>& d) { return insertKey(d.storage()).second; }
+
+    template <typename Signature>
+    bool erase(const Delegate<Signature>& d) { return eraseKey(d.storage()); }
+
+    template <typename Signature>
+    bool contains(const Delegate<Signature>& d) const { return find(d.storage()) != NotFound; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// DelegateFlatMap associates a value with each delegate, see DelegateFlatSet
+//
+
+template <class Value>
+class DelegateFlatMap : public details::DelegateHashTable<Value> {
+
+    using Base = details::DelegateHashTable<Value>;
+
+public:
+    // Returns false, and leaves the value unchanged, if the delegate was present
+    template <typename Signature>
+    bool insert(const Delegate<Signature>& d, Value value) {
+        auto slot = Base::insertKey(d.storage());
+        if (slot.second)
+            this->m_values[slot.first] = std::move(value);
+        return slot.second;
+    }
+
+    // Value of the delegate, default constructed if not present
+    template <typename Signature>
+    Value& operator[](const Delegate<Signature>& d) {
+        return this->m_values[Base::insertKey(d.storage()).first];
+    }
+
+    // Value of the delegate or null
+    template <typename Signature>
+    Value* find(const Delegate<Signature>& d) {
+        size_t i = Base::find(d.storage());
+        return (i == Base::NotFound) ? nullptr : &this->m_values[i];
+    }
+
+    template <typename Signature>
+    const Value* find(const Delegate<Signature>& d) const {
+        size_t i = Base::find(d.storage());
+        return (i == Base::NotFound) ? nullptr : &this->m_values[i];
+    }
+
+    template <typename Signature>
+    bool erase(const Delegate<Signature>& d) { return Base::eraseKey(d.storage()); }
+
+    template <typename Signature>
+    bool contains(const Delegate<Signature>& d) const {
+        return Base::find(d.storage()) != Base::NotFound;
+    }
+};
+
+} // end delly namespace
@@ -0,0 +1,332 @@
+#pragma once
+
+// Call counters and latency histograms of delegate targets, recorded by
+// Delegate::operator(), invokeEach and invokeBatch when compiled with
+// DELEGATE_PROFILING set to 1, see Delegate.h.  Included by Delegate.h in
+// that mode, and on its own by code reporting the profile.
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <elf.h>
+#include <link.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace delly {
+
+namespace details {
+
+// Reference cycles where available, nanoseconds otherwise
+inline uint64_t ReadProfileCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Calls recorded by one thread, by target code address.  Only the owning
+// thread writes, with plain loads and stores of relaxed atomics, so that
+// reports can read the counters while calls are recorded.  The table has
+// a fixed size and never moves: targets beyond its capacity are counted
+// in a last entry of address 0.
+//
+
+class ProfileTable {
+public:
+    // Histogram bucket n counts calls of [2^n, 2^(n+1)) cycles
+    static constexpr uint32_t Buckets = 32;
+    static constexpr uint32_t Capacity = 1024;
+
+    struct Entry {
+        std::atomic<uintptr_t> code{0};
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> cycles{0};
+        std::atomic<uint64_t> maxCycles{0};
+        std::atomic<uint64_t> histogram[Buckets] = {};
+    };
+
+    void record(uintptr_t code, uint64_t cycles) {
+        Entry& e = find(code);
+        Add(e.calls, 1);
+        Add(e.cycles, cycles);
+        if (cycles > e.maxCycles.load(std::memory_order_relaxed))
+            e.maxCycles.store(cycles, std::memory_order_relaxed);
+        const uint32_t bucket = std::min<uint32_t>(std::bit_width(cycles | 1) - 1, Buckets - 1);
+        Add(e.histogram[bucket], 1);
+    }
+
+    inline const Entry* begin() const { return m_entries; }
+    inline const Entry* end() const { return m_entries + Capacity + 1; }
+
+    void reset() {
+        for (Entry& e : m_entries) {
+            e.calls.store(0, std::memory_order_relaxed);
+            e.cycles.store(0, std::memory_order_relaxed);
+            e.maxCycles.store(0, std::memory_order_relaxed);
+            for (auto& count : e.histogram)
+                count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    static inline void Add(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    Entry& find(uintptr_t code) {
+        uint32_t i = uint32_t((code * 0x9e3779b97f4a7c15ULL) >> 32) & (Capacity - 1);
+        for (uint32_t probes = 0; probes < Capacity; ++probes, i = (i + 1) & (Capacity - 1)) {
+            const uintptr_t key = m_entries[i].code.load(std::memory_order_relaxed);
+            if (key == code)
+                return m_entries[i];
+            if (key == 0) {
+                // Published for readers, whose counters may lag
+                m_entries[i].code.store(code, std::memory_order_release);
+                return m_entries[i];
+            }
+        }
+        return m_entries[Capacity];
+    }
+
+    Entry m_entries[Capacity + 1];
+};
+
+// The tables of every thread which recorded calls, kept after the thread
+// exits so that its calls are still reported
+struct ProfileRegistry {
+    std::mutex lock;
+    std::vector<std::unique_ptr<ProfileTable>> tables;
+
+    static ProfileRegistry& Get() {
+        static ProfileRegistry registry;
+        return registry;
+    }
+};
+
+inline ProfileTable& ThreadProfileTable() {
+    static thread_local ProfileTable* table = nullptr;
+    if (!table) {
+        ProfileRegistry& registry = ProfileRegistry::Get();
+        std::lock_guard<std::mutex> lock(registry.lock);
+        registry.tables.push_back(std::make_unique<ProfileTable>());
+        table = registry.tables.back().get();
+    }
+    return *table;
+}
+
+// Records one call of a target, from construction to destruction
+class ProfiledCall {
+public:
+    explicit ProfiledCall(uintptr_t code)
+        : m_code(code), m_start(ReadProfileCycles())
+    {}
+
+    ~ProfiledCall() {
+        ThreadProfileTable().record(m_code, ReadProfileCycles() - m_start);
+    }
+
+    ProfiledCall(const ProfiledCall&) = delete;
+    ProfiledCall& operator=(const ProfiledCall&) = delete;
+
+private:
+    uintptr_t m_code;
+    uint64_t m_start;
+};
+
+} // end details namespace
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Calls of one target, summed over every thread
+//
+
+struct DelegateProfileEntry {
+    static constexpr uint32_t Buckets = details::ProfileTable::Buckets;
+
+    uintptr_t code = 0;     // 0 for targets which did not fit in a table
+    uint64_t calls = 0;
+    uint64_t cycles = 0;
+    uint64_t maxCycles = 0;
+    uint64_t histogram[Buckets] = {};
+
+    inline double meanCycles() const { return calls ? double(cycles) / double(calls) : 0; }
+
+    // Upper bound of the histogram bucket holding a percentile of calls
+    uint64_t percentileCycles(double percentile) const {
+        const uint64_t rank = uint64_t(percentile / 100 * double(calls));
+        uint64_t seen = 0;
+        for (uint32_t b = 0; b < Buckets; ++b) {
+            seen += histogram[b];
+            if (seen > rank)
+                return std::min((uint64_t(2) << b) - 1, maxCycles);
+        }
+        return maxCycles;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// DelegateProfiler reads the calls recorded by delegates compiled with
+// DELEGATE_PROFILING, by target: the function, the method, or the thunk
+// of a method bound at compile time.  Virtual methods are counted for their
+// final overrider.  Each element of invokeEach and invokeBatch is a call.
+// Cycles are wall clock reference cycles, including the
+// targets called in turn and any time the thread was descheduled.
+//
+//     DelegateProfiler::Report(stderr, 10);
+//
+// Prints the targets called most and the targets slowest on average, with
+// their latency percentiles.  Reading the profile while delegates are called
+// is safe, the counts are approximate; Reset() should be called while
+// delegates are not.
+//
+
+class DelegateProfiler {
+public:
+    // Merged entries of every thread, in no particular order
+    static std::vector<DelegateProfileEntry> Snapshot() {
+        std::vector<DelegateProfileEntry> entries;
+        std::unordered_map<uintptr_t, size_t> indices;
+        details::ProfileRegistry& registry = details::ProfileRegistry::Get();
+        std::lock_guard<std::mutex> lock(registry.lock);
+        for (const auto& table : registry.tables) {
+            for (const auto& e : *table) {
+                const uint64_t calls = e.calls.load(std::memory_order_relaxed);
+                if (!calls)
+                    continue;
+                const uintptr_t code = e.code.load(std::memory_order_acquire);
+                auto found = indices.try_emplace(code, entries.size());
+                if (found.second) {
+                    entries.emplace_back();
+                    entries.back().code = code;
+                }
+                DelegateProfileEntry& merged = entries[found.first->second];
+                merged.calls += calls;
+                merged.cycles += e.cycles.load(std::memory_order_relaxed);
+                merged.maxCycles = std::max(merged.maxCycles, e.maxCycles.load(std::memory_order_relaxed));
+                for (uint32_t b = 0; b < DelegateProfileEntry::Buckets; ++b)
+                    merged.histogram[b] += e.histogram[b].load(std::memory_order_relaxed);
+            }
+        }
+        return entries;
+    }
+
+    static void Reset() {
+        details::ProfileRegistry& registry = details::ProfileRegistry::Get();
+        std::lock_guard<std::mutex> lock(registry.lock);
+        for (const auto& table : registry.tables)
+            table->reset();
+    }
+
+    // Name of the function at a code address, with its source line when
+    // known: exported symbols through dladdr, others through addr2line on
+    // the module, which needs debug information or a symbol table.
+    static std::string Symbolize(uintptr_t code) {
+        if (!code)
+            return "(other targets)";
+        Dl_info info = {};
+        if (!dladdr(reinterpret_cast<void*>(code), &info) || !info.dli_fname)
+            return Hex(code);
+
+        // dladdr finds the closest exported symbol, only trust an exact match
+        if (info.dli_sname && reinterpret_cast<uintptr_t>(info.dli_saddr) == code)
+            return Demangle(info.dli_sname);
+
+        // Position independent modules are symbolized by offset
+        const uintptr_t base = reinterpret_cast<uintptr_t>(info.dli_fbase);
+        const auto* header = static_cast<const ElfW(Ehdr)*>(info.dli_fbase);
+        const uintptr_t address = (header && header->e_type == ET_DYN) ? code - base : code;
+        // The main program has no name
+        const std::string module = info.dli_fname[0] ? info.dli_fname : "/proc/self/exe";
+
+        std::string command = "addr2line -f -C -e '" + module + "' " + Hex(address) + " 2>/dev/null";
+        std::string function, line;
+        if (FILE* pipe = popen(command.c_str(), "r")) {
+            char buffer[1024];
+            if (fgets(buffer, sizeof(buffer), pipe))
+                function = Chomp(buffer);
+            if (fgets(buffer, sizeof(buffer), pipe))
+                line = Chomp(buffer);
+            pclose(pipe);
+        }
+        if (function.empty() || function == "??")
+            return module + "+" + Hex(code - base);
+        if (line.empty() || line.compare(0, 2, "??") == 0)
+            return function;
+        return function + " (" + line + ")";
+    }
+
+    // Prints the 'top' targets called most, and the 'top' slowest on average
+    static void Report(FILE* out, size_t top = 10) {
+        std::vector<DelegateProfileEntry> entries = Snapshot();
+        if (entries.empty()) {
+            fprintf(out, "No delegate calls recorded\n");
+            return;
+        }
+        std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+            return a.calls > b.calls;
+        });
+        PrintTable(out, "Delegate targets by calls", entries, top);
+        std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+            return a.meanCycles() > b.meanCycles();
+        });
+        PrintTable(out, "Delegate targets by mean cycles", entries, top);
+    }
+
+private:
+    static void PrintTable(FILE* out, const char* title, const std::vector<DelegateProfileEntry>& entries,
+                           size_t top) {
+        fprintf(out, "%s\n%12s %10s %10s %10s %10s  %s\n", title,
+                "calls", "mean", "p50", "p99", "max", "target");
+        for (size_t i = 0; i < entries.size() && i < top; ++i) {
+            const DelegateProfileEntry& e = entries[i];
+            fprintf(out, "%12llu %10.0f %10llu %10llu %10llu  %s\n",
+                    (unsigned long long)e.calls, e.meanCycles(),
+                    (unsigned long long)e.percentileCycles(50), (unsigned long long)e.percentileCycles(99),
+                    (unsigned long long)e.maxCycles, Symbolize(e.code).c_str());
+        }
+    }
+
+    static std::string Demangle(const char* name) {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+        std::string result = (status == 0 && demangled) ? demangled : name;
+        free(demangled);
+        return result;
+    }
+
+    static std::string Hex(uintptr_t value) {
+        char buffer[24];
+        snprintf(buffer, sizeof(buffer), "0x%llx", (unsigned long long)value);
+        return buffer;
+    }
+
+    static std::string Chomp(const char* s) {
+        std::string result(s);
+        while (!result.empty() && (result.back() == '\n' || result.back() == '\r'))
+            result.pop_back();
+        return result;
+    }
+};
+
+} // end delly namespace
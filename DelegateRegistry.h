@@ -0,0 +1,300 @@
+#pragma once
+
+#include "Delegate.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace delly {
+
+namespace details {
+
+template <typename Signature>
+struct ReturnOf;
+
+template <typename RetType, typename... Args>
+struct ReturnOf<RetType(Args...)> {
+    using Type = RetType;
+};
+
+// Decomposes the type of a function or method known at compile time
+template <class Target>
+struct TargetTraits : MethodTraits<Target> {
+    using ReturnType = typename ReturnOf<typename MethodTraits<Target>::Signature>::Type;
+    static constexpr bool IsMethod = true;
+};
+
+template <typename RetType, typename... Args>
+struct TargetTraits<RetType (*)(Args...)> {
+    using Class = void;
+    using Object = void;
+    using Signature = RetType(Args...);
+    using ReturnType = RetType;
+    static constexpr bool IsMethod = false;
+};
+
+template <typename RetType, typename... Args>
+struct TargetTraits<RetType (*)(Args...) noexcept> : TargetTraits<RetType (*)(Args...)> {};
+
+// Arguments of a call as stored in memory, by value also for reference
+// parameters
+template <typename Signature>
+struct PackedArgs;
+
+template <typename RetType, typename... Args>
+struct PackedArgs<RetType(Args...)> {
+    using Type = std::tuple<typename std::decay<Args>::type...>;
+    static_assert(std::conjunction<std::is_trivially_copyable<typename std::decay<Args>::type>...>::value,
+                  "Packed arguments must be trivially copyable");
+};
+
+// Address unique to a type within the process
+template <class T>
+struct TypeTag {
+    static inline const char tag = 0;
+};
+
+// FNV-1a of the name of the instantiation, which spells the target and its
+// signature: the same in every build of the same source
+template <auto Target, typename Signature>
+constexpr uint32_t HashTargetName() {
+#if defined(_MSC_VER)
+    const char* name = __FUNCSIG__;
+#else
+    const char* name = __PRETTY_FUNCTION__;
+#endif
+    uint32_t hash = 2166136261u;
+    for (; *name; ++name)
+        hash = (hash ^ uint8_t(*name)) * 16777619u;
+    return hash;
+}
+
+} // end details namespace
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// DelegateRegistry maps 32 bit ids back to functions and methods, for calls
+// made by another process running the same binary, where the addresses held
+// by a Delegate mean nothing.
+//
+// The id of a target is a hash of its name and signature, known at compile
+// time by IdOf: senders need no registry, and the ids do not depend on the
+// order of registration.  Adding a target whose id is already taken by
+// another throws std::logic_error: one of the two must be renamed.
+// Objects are named by handles chosen by the receiving process, small
+// integers indexing a table, and are checked against the class of the
+// method before a call.
+//
+//     // Receiver
+//     registry.add<&Worker::OnJob>();
+//     registry.setObject(7, worker);
+//     // Sender: DelegateRegistry::IdOf<&Worker::OnJob>() and handle 7,
+//     // then in the receiver
+//     Delegate<void(int)> d = registry.find<void(int)>(id, 7);
+//
+// Registering is not thread safe, lookups are.
+//
+
+class DelegateRegistry {
+
+    using DelegateStorage = details::DelegateStorage;
+    using Invoker = void (*) (void* obj, void* args);
+    using Binder = DelegateStorage (*) (void* obj);
+
+public:
+    // Id 0 is never assigned
+    template <auto Target>
+    static constexpr uint32_t IdOf() {
+        constexpr uint32_t hash = details::HashTargetName<Target,
+            typename details::TargetTraits<decltype(Target)>::Signature>();
+        return hash ? hash : 1;
+    }
+
+    // Size of the arguments of a call of Target, as packed by PackArgs
+    template <auto Target>
+    static constexpr uint32_t ArgsSizeOf() {
+        return uint32_t(sizeof(typename details::PackedArgs<
+            typename details::TargetTraits<decltype(Target)>::Signature>::Type));
+    }
+
+    // Register a function or method, returns its id.  Adding it again is
+    // harmless, adding another target of the same id throws.
+    template <auto Target>
+    uint32_t add() {
+        using Traits = details::TargetTraits<decltype(Target)>;
+        constexpr uint32_t id = IdOf<Target>();
+
+        Entry entry;
+        entry.id = id;
+        entry.argsSize = ArgsSizeOf<Target>();
+        entry.signature = &details::TypeTag<typename Traits::Signature>::tag;
+        entry.objectType = Traits::IsMethod ? &details::TypeTag<typename Traits::Class>::tag : nullptr;
+        entry.invoke = &Invoke<Target>;
+        entry.bind = &Bind<Target>;
+
+        if (Entry* e = findEntry(id)) {
+            if (e->invoke != entry.invoke)
+                throw std::logic_error("DelegateRegistry: two targets have the same id");
+            return id;
+        }
+        if (2 * (m_size + 1) > m_entries.size())
+            grow();
+        insert(entry);
+        return id;
+    }
+
+    // Name an object by a handle, for calls of methods of T, or of a base
+    // class given as T
+    template <class T>
+    void setObject(uint32_t handle, T& obj) {
+        if (handle >= m_objects.size())
+            m_objects.resize(size_t(handle) + 1);
+        m_objects[handle] = { &obj, &details::TypeTag<typename std::remove_const<T>::type>::tag };
+    }
+
+    void removeObject(uint32_t handle) {
+        if (handle < m_objects.size())
+            m_objects[handle] = {};
+    }
+
+    bool contains(uint32_t id) const { return findEntry(id) != nullptr; }
+    size_t size() const { return m_size; }
+
+    // The delegate of a target bound to the object of the handle, empty if
+    // the id is unknown, has another signature, or the handle names no
+    // object of its class.  Functions ignore the handle.
+    template <typename Signature>
+    Delegate<Signature> find(uint32_t id, uint32_t handle = 0) const {
+        const Entry* e = findEntry(id);
+        if (!e || e->signature != &details::TypeTag<Signature>::tag)
+            return Delegate<Signature>();
+        void* obj;
+        if (!resolve(*e, handle, obj))
+            return Delegate<Signature>();
+        return Delegate<Signature>(e->bind(obj));
+    }
+
+    // Call a target with arguments packed by PackArgs.  Returns false, and
+    // calls nothing, when find would return an empty delegate or the size
+    // of the arguments does not match.  Arguments of reference parameters
+    // are passed as references to the packed values.
+    bool invoke(uint32_t id, uint32_t handle, void* args, uint32_t argsSize) const {
+        const Entry* e = findEntry(id);
+        if (!e || e->argsSize != argsSize)
+            return false;
+        void* obj;
+        if (!resolve(*e, handle, obj))
+            return false;
+        e->invoke(obj, args);
+        return true;
+    }
+
+    // Write the arguments of a call of Target to memory of ArgsSizeOf<Target>
+    // bytes, aligned for them
+    template <auto Target, typename... Values>
+    static void PackArgs(void* args, Values&&... values) {
+        using Packed = typename details::PackedArgs<
+            typename details::TargetTraits<decltype(Target)>::Signature>::Type;
+        static_assert(std::tuple_size<Packed>::value == sizeof...(Values), "Wrong number of arguments");
+        ::new (args) Packed(std::forward<Values>(values)...);
+    }
+
+private:
+    struct Entry {
+        uint32_t id = 0;
+        uint32_t argsSize = 0;
+        const void* signature = nullptr;
+        const void* objectType = nullptr;
+        Invoker invoke = nullptr;
+        Binder bind = nullptr;
+    };
+
+    struct Object {
+        void* object = nullptr;
+        const void* type = nullptr;
+    };
+
+    // Each packed value is passed as the declared parameter type
+    template <auto Target, typename RetType, typename... Args, size_t... I>
+    static void Call(void* obj, void* args, RetType (*)(Args...), std::index_sequence<I...>) {
+        using Traits = details::TargetTraits<decltype(Target)>;
+        auto& packed = *static_cast<typename details::PackedArgs<RetType(Args...)>::Type*>(args);
+        if constexpr (Traits::IsMethod)
+            (static_cast<typename Traits::Object*>(obj)->*Target)(static_cast<Args&&>(std::get<I>(packed))...);
+        else
+            Target(static_cast<Args&&>(std::get<I>(packed))...);
+    }
+
+    template <auto Target>
+    static void Invoke(void* obj, void* args) {
+        using Signature = typename details::TargetTraits<decltype(Target)>::Signature;
+        using Packed = typename details::PackedArgs<Signature>::Type;
+        Call<Target>(obj, args, static_cast<Signature*>(nullptr),
+                     std::make_index_sequence<std::tuple_size<Packed>::value>());
+    }
+
+    template <auto Target>
+    static DelegateStorage Bind(void* obj) {
+        using Traits = details::TargetTraits<decltype(Target)>;
+        if constexpr (Traits::IsMethod)
+            return MakeDelegate<Target>(*static_cast<typename Traits::Object*>(obj)).storage();
+        else
+            return MakeDelegate(Target).storage();
+    }
+
+    bool resolve(const Entry& e, uint32_t handle, void*& obj) const {
+        obj = nullptr;
+        if (!e.objectType)
+            return true;
+        if (handle >= m_objects.size() || m_objects[handle].type != e.objectType)
+            return false;
+        obj = m_objects[handle].object;
+        return true;
+    }
+
+    // Open addressing on the id, which is already a hash
+    const Entry* findEntry(uint32_t id) const {
+        if (m_entries.empty() || id == 0)
+            return nullptr;
+        const size_t mask = m_entries.size() - 1;
+        for (size_t i = id & mask;; i = (i + 1) & mask) {
+            if (m_entries[i].id == id)
+                return &m_entries[i];
+            if (m_entries[i].id == 0)
+                return nullptr;
+        }
+    }
+
+    Entry* findEntry(uint32_t id) {
+        return const_cast<Entry*>(static_cast<const DelegateRegistry*>(this)->findEntry(id));
+    }
+
+    void insert(const Entry& entry) {
+        const size_t mask = m_entries.size() - 1;
+        size_t i = entry.id & mask;
+        while (m_entries[i].id != 0)
+            i = (i + 1) & mask;
+        m_entries[i] = entry;
+        ++m_size;
+    }
+
+    void grow() {
+        std::vector<Entry> entries(m_entries.empty() ? 16 : 2 * m_entries.size());
+        entries.swap(m_entries);
+        m_size = 0;
+        for (const Entry& e : entries)
+            if (e.id)
+                insert(e);
+    }
+
+    std::vector<Entry> m_entries;
+    size_t m_size = 0;
+    std::vector<Object> m_objects;
+};
+
+} // end delly namespace
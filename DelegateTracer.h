@@ -0,0 +1,568 @@
+#pragma once
+
+// Binary traces of the calls of selected delegates, recorded by
+// Delegate::operator(), invokeEach and invokeBatch when compiled with
+// DELEGATE_TRACING set to 1, see Delegate.h.  Included by Delegate.h in
+// that mode, and on its own by code reading traces, eg.
+// tools/DelegateTraceSummary.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace delly {
+
+template <typename Signature> class Delegate;
+
+namespace details {
+template <typename T> class ForwardArg;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Layout of a trace file: this header in the first page, then one record
+// per call, in the order of the calls.  Files are written by one thread of
+// one process.
+//
+
+struct DelegateTraceHeader {
+    static constexpr uint64_t Magic = 0x4543415254594c44; // "DLYTRACE"
+    static constexpr uint32_t Version = 1;
+    static constexpr size_t Size = 4096;
+
+    uint64_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t pid;
+    uint32_t tid;
+    // Clocks when the file was opened and closed, to convert cycles to
+    // time.  The end and the number of records are 0 until it is closed.
+    uint64_t startCycles;
+    uint64_t startNanoseconds;
+    uint64_t endCycles;
+    uint64_t endNanoseconds;
+    uint64_t records;
+    // Load address and path of the main program, to symbolize targets
+    uint64_t programBase;
+    char program[1024];
+};
+
+static_assert(sizeof(DelegateTraceHeader) <= DelegateTraceHeader::Size);
+
+struct DelegateTraceRecord {
+    static constexpr size_t ArgBytes = 24;
+
+    uint64_t start;         // Cycles when called
+    uint64_t cycles;        // Duration, 0 while the call runs
+    uint64_t code;          // Code address of the target
+    uint64_t object;        // Bound object, 0 for functions
+    uint16_t argCount;      // Leading arguments in args
+    uint16_t argBytes;
+    uint32_t depth;         // Traced calls running on the thread when called
+    uint8_t args[ArgBytes]; // Leading trivially copyable arguments, packed
+};
+
+static_assert(sizeof(DelegateTraceRecord) == 64);
+
+namespace details {
+
+inline uint64_t ReadTraceNanoseconds() {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Reference cycles where available, nanoseconds otherwise
+inline uint64_t ReadTraceCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return ReadTraceNanoseconds();
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// The trace file of one thread.  Records are written through a mapping of
+// one chunk of the file at a time, the file grows a chunk at a time.
+//
+
+class TraceWriter {
+public:
+    static constexpr uint64_t ChunkRecords = 1 << 16;
+    static constexpr size_t ChunkBytes = ChunkRecords * sizeof(DelegateTraceRecord);
+
+    TraceWriter(std::string path, uint64_t session)
+        : m_path(std::move(path)), m_session(session)
+    {
+        m_fd = ::open(m_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (m_fd < 0)
+            return;
+        void* p = MAP_FAILED;
+        if (ftruncate(m_fd, DelegateTraceHeader::Size) == 0)
+            p = mmap(nullptr, DelegateTraceHeader::Size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(m_fd);
+            m_fd = -1;
+            return;
+        }
+
+        m_header = static_cast<DelegateTraceHeader*>(p);
+        m_header->magic = DelegateTraceHeader::Magic;
+        m_header->version = DelegateTraceHeader::Version;
+        m_header->recordSize = sizeof(DelegateTraceRecord);
+        m_header->pid = uint32_t(getpid());
+        m_header->tid = uint32_t(syscall(SYS_gettid));
+        m_header->programBase = ProgramBase();
+        const ssize_t length = readlink("/proc/self/exe", m_header->program, sizeof(m_header->program) - 1);
+        m_header->program[length > 0 ? length : 0] = 0;
+        m_header->startNanoseconds = ReadTraceNanoseconds();
+        m_header->startCycles = ReadTraceCycles();
+    }
+
+    ~TraceWriter() { close(); }
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    inline bool ok() const { return m_header != nullptr; }
+    inline uint64_t session() const { return m_session; }
+    inline const std::string& path() const { return m_path; }
+
+    // The next record, zeroed, or nullptr if the file cannot grow
+    inline DelegateTraceRecord* append(uint64_t& index) {
+        if (m_count == m_mappedEnd && !mapNextChunk())
+            return nullptr;
+        index = m_count++;
+        return &m_chunk[index - m_mappedBegin];
+    }
+
+    // Records of calls which outlived their chunk are written to the file
+    inline void setCycles(uint64_t index, uint64_t cycles) {
+        if (index >= m_mappedBegin) {
+            m_chunk[index - m_mappedBegin].cycles = cycles;
+            return;
+        }
+        const off_t offset = off_t(DelegateTraceHeader::Size + index * sizeof(DelegateTraceRecord)
+                                   + offsetof(DelegateTraceRecord, cycles));
+        // If this fails the record reads as a call still running
+        [[maybe_unused]] const ssize_t written = pwrite(m_fd, &cycles, sizeof(cycles), offset);
+    }
+
+    // Completes the header and trims the file to its records
+    void close() {
+        if (!m_header)
+            return;
+        m_header->records = m_count;
+        m_header->endNanoseconds = ReadTraceNanoseconds();
+        m_header->endCycles = ReadTraceCycles();
+        if (m_chunk)
+            munmap(m_chunk, ChunkBytes);
+        munmap(m_header, DelegateTraceHeader::Size);
+        // If this fails the records past the count are zero, readers ignore them
+        [[maybe_unused]] const int trimmed =
+            ftruncate(m_fd, off_t(DelegateTraceHeader::Size + m_count * sizeof(DelegateTraceRecord)));
+        ::close(m_fd);
+        m_chunk = nullptr;
+        m_header = nullptr;
+        m_fd = -1;
+    }
+
+private:
+    bool mapNextChunk() {
+        if (m_failed)
+            return false;
+        if (m_chunk) {
+            munmap(m_chunk, ChunkBytes);
+            m_chunk = nullptr;
+            m_mappedBegin = m_mappedEnd;
+        }
+        const off_t offset = off_t(DelegateTraceHeader::Size + m_mappedEnd * sizeof(DelegateTraceRecord));
+        void* p = MAP_FAILED;
+        if (ftruncate(m_fd, offset + off_t(ChunkBytes)) == 0)
+            p = mmap(nullptr, ChunkBytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, offset);
+        if (p == MAP_FAILED) {
+            m_failed = true;
+            return false;
+        }
+        m_chunk = static_cast<DelegateTraceRecord*>(p);
+        m_mappedEnd += ChunkRecords;
+        return true;
+    }
+
+    // The main program is the first module listed
+    static uint64_t ProgramBase() {
+        uint64_t base = 0;
+        dl_iterate_phdr([](dl_phdr_info* info, size_t, void* data) {
+            *static_cast<uint64_t*>(data) = info->dlpi_addr;
+            return 1;
+        }, &base);
+        return base;
+    }
+
+    std::string m_path;
+    uint64_t m_session;
+    int m_fd = -1;
+    bool m_failed = false;
+    DelegateTraceHeader* m_header = nullptr;
+    DelegateTraceRecord* m_chunk = nullptr;
+    // Indices of the records in the mapped chunk, and of the next record
+    uint64_t m_mappedBegin = 0;
+    uint64_t m_mappedEnd = 0;
+    uint64_t m_count = 0;
+};
+
+// Tracing is started and the selection changed rarely, and read on every
+// call.  The selection is a set of code addresses which only grows until
+// it is cleared, read with no lock.
+struct TraceState {
+    static constexpr uint32_t SelectionCapacity = 1024;
+
+    static inline constinit std::atomic<bool> started{false};
+    static inline constinit std::atomic<bool> selectAll{false};
+    static inline constinit std::atomic<uint64_t> session{0};
+    static inline constinit std::atomic<uintptr_t> selected[SelectionCapacity] = {};
+
+    static inline uint32_t Slot(uintptr_t code) {
+        return uint32_t((code * 0x9e3779b97f4a7c15ULL) >> 32) & (SelectionCapacity - 1);
+    }
+
+    static bool Selected(uintptr_t code) {
+        if (selectAll.load(std::memory_order_relaxed))
+            return true;
+        uint32_t i = Slot(code);
+        for (uint32_t probes = 0; probes < SelectionCapacity; ++probes, i = (i + 1) & (SelectionCapacity - 1)) {
+            const uintptr_t key = selected[i].load(std::memory_order_relaxed);
+            if (key == code)
+                return true;
+            if (key == 0)
+                return false;
+        }
+        return false;
+    }
+};
+
+// The directory of the traces and the files written since tracing started
+struct TraceRegistry {
+    std::mutex lock;
+    std::string directory;
+    std::vector<std::string> files;
+
+    static TraceRegistry& Get() {
+        static TraceRegistry registry;
+        return registry;
+    }
+};
+
+// The file of the calling thread, closed when the thread exits
+struct TraceThread {
+    std::unique_ptr<TraceWriter> writer;
+    uint32_t depth = 0;
+
+    // The writer of the current session, opened on first use.  Records of
+    // running calls point into the file, it is only replaced between calls.
+    TraceWriter* current() {
+        const uint64_t session = TraceState::session.load(std::memory_order_acquire);
+        if (writer && writer->session() == session)
+            return writer->ok() ? writer.get() : nullptr;
+        if (depth > 0)
+            return nullptr;
+        writer.reset();
+
+        TraceRegistry& registry = TraceRegistry::Get();
+        std::lock_guard<std::mutex> lock(registry.lock);
+        const std::string path = registry.directory + "/delegates." + std::to_string(getpid()) + "."
+                                 + std::to_string(syscall(SYS_gettid)) + ".trace";
+        writer = std::make_unique<TraceWriter>(path, session);
+        if (!writer->ok())
+            return nullptr;
+        registry.files.push_back(path);
+        return writer.get();
+    }
+};
+
+inline TraceThread& ThisTraceThread() {
+    static thread_local TraceThread thread;
+    return thread;
+}
+
+template <typename T>
+struct IsForwardArg : std::false_type {};
+
+template <typename T>
+struct IsForwardArg<ForwardArg<T>> : std::true_type {};
+
+// Copies the leading arguments into the record while they are trivially
+// copyable, passed as is, and fit
+template <typename... Args>
+struct TraceArgs {
+    template <typename... Params>
+    static void Snapshot(DelegateTraceRecord& r, const Params&... params) {
+        bool open = true;
+        (Append<Args>(r, open, params), ...);
+    }
+
+    template <typename Arg, typename Param>
+    static void Append(DelegateTraceRecord& r, bool& open, const Param& param) {
+        using Value = typename std::decay<Arg>::type;
+        if constexpr (std::is_trivially_copyable<Value>::value && !IsForwardArg<Param>::value) {
+            if (open && r.argBytes + sizeof(Value) <= DelegateTraceRecord::ArgBytes) {
+                const Value& value = param;
+                memcpy(r.args + r.argBytes, &value, sizeof(Value));
+                r.argBytes += uint16_t(sizeof(Value));
+                ++r.argCount;
+                return;
+            }
+        }
+        open = false;
+    }
+};
+
+// Records one call of a selected target, from begin to destruction
+class TracedCall {
+public:
+    TracedCall() = default;
+
+    TracedCall(const TracedCall&) = delete;
+    TracedCall& operator=(const TracedCall&) = delete;
+
+    template <typename... Args, typename... Params>
+    void begin(uintptr_t code, const void* object, const Params&... params) {
+        if (!TraceState::Selected(code))
+            return;
+        TraceThread& thread = ThisTraceThread();
+        TraceWriter* writer = thread.current();
+        if (!writer)
+            return;
+        DelegateTraceRecord* r = writer->append(m_index);
+        if (!r)
+            return;
+        r->code = code;
+        r->object = reinterpret_cast<uintptr_t>(object);
+        r->depth = thread.depth++;
+        TraceArgs<Args...>::Snapshot(*r, params...);
+        m_thread = &thread;
+        m_writer = writer;
+        m_start = r->start = ReadTraceCycles();
+    }
+
+    ~TracedCall() {
+        if (m_writer) {
+            m_writer->setCycles(m_index, ReadTraceCycles() - m_start);
+            --m_thread->depth;
+        }
+    }
+
+private:
+    TraceThread* m_thread = nullptr;
+    TraceWriter* m_writer = nullptr;
+    uint64_t m_index = 0;
+    uint64_t m_start = 0;
+};
+
+} // end details namespace
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// DelegateTracer records the calls of selected targets made through
+// delegates compiled with DELEGATE_TRACING: when, for how long, the target
+// and its object, and the leading arguments.  Targets are selected by the
+// code they call, like DelegateProfiler counts them, and each element of
+// invokeEach and invokeBatch is recorded as a call.  Each thread writes
+// its calls to its own file, delegates.<pid>.<tid>.trace in the directory
+// given to Start, through a shared mapping: the records of a process which
+// crashes are kept.
+//
+//     DelegateTracer::Select(MakeDelegate<&Session::OnRequest>(session));
+//     DelegateTracer::Start("/var/tmp/traces");
+//     ...
+//     DelegateTracer::Stop();
+//
+// Read the files with DelegateTraceReader, or summarize them with the
+// DelegateTraceSummary tool.  While tracing is stopped, a call costs one
+// more relaxed load; calls of targets not selected also look the target up.
+//
+// Stop completes the file of the calling thread.  Other threads complete
+// theirs when they exit, or at their first traced call after the next
+// Start; until then their files end at the first record not written.
+//
+
+class DelegateTracer {
+public:
+    // Returns false if the directory cannot be written
+    static bool Start(const std::string& directory) {
+        if (access(directory.c_str(), W_OK) != 0)
+            return false;
+        details::TraceRegistry& registry = details::TraceRegistry::Get();
+        {
+            std::lock_guard<std::mutex> lock(registry.lock);
+            registry.directory = directory;
+            registry.files.clear();
+        }
+        details::TraceState::session.fetch_add(1, std::memory_order_release);
+        details::TraceState::started.store(true, std::memory_order_release);
+        return true;
+    }
+
+    static void Stop() {
+        details::TraceState::started.store(false, std::memory_order_release);
+        details::TraceThread& thread = details::ThisTraceThread();
+        if (thread.depth == 0)
+            thread.writer.reset();
+    }
+
+    static inline bool Started() {
+        return details::TraceState::started.load(std::memory_order_relaxed);
+    }
+
+    // Trace the calls of the target of a delegate, through any delegate
+    template <typename Signature>
+    static void Select(const Delegate<Signature>& d) {
+        SelectCode(d.targetAddress());
+    }
+
+    static void SelectCode(uintptr_t code) {
+        using details::TraceState;
+        if (!code)
+            return;
+        std::lock_guard<std::mutex> lock(details::TraceRegistry::Get().lock);
+        uint32_t i = TraceState::Slot(code);
+        for (uint32_t probes = 0; probes < TraceState::SelectionCapacity;
+             ++probes, i = (i + 1) & (TraceState::SelectionCapacity - 1)) {
+            const uintptr_t key = TraceState::selected[i].load(std::memory_order_relaxed);
+            if (key == code)
+                return;
+            if (key == 0) {
+                TraceState::selected[i].store(code, std::memory_order_relaxed);
+                return;
+            }
+        }
+        // The selection is full, trace everything rather than miss calls
+        TraceState::selectAll.store(true, std::memory_order_relaxed);
+    }
+
+    static void SelectAll() {
+        details::TraceState::selectAll.store(true, std::memory_order_relaxed);
+    }
+
+    static void ClearSelection() {
+        std::lock_guard<std::mutex> lock(details::TraceRegistry::Get().lock);
+        details::TraceState::selectAll.store(false, std::memory_order_relaxed);
+        for (auto& key : details::TraceState::selected)
+            key.store(0, std::memory_order_relaxed);
+    }
+
+    // Files written since tracing was last started
+    static std::vector<std::string> Files() {
+        details::TraceRegistry& registry = details::TraceRegistry::Get();
+        std::lock_guard<std::mutex> lock(registry.lock);
+        return registry.files;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// DelegateTraceReader maps a trace file and reads its records.  Files of
+// threads which are still tracing, or of processes which crashed, end at
+// the first record not written yet.
+//
+
+class DelegateTraceReader {
+public:
+    DelegateTraceReader() = default;
+    explicit DelegateTraceReader(const std::string& path) { open(path); }
+
+    DelegateTraceReader(DelegateTraceReader&& o) noexcept { swap(o); }
+    DelegateTraceReader& operator=(DelegateTraceReader&& o) noexcept {
+        DelegateTraceReader(std::move(o)).swap(*this);
+        return *this;
+    }
+
+    DelegateTraceReader(const DelegateTraceReader&) = delete;
+    DelegateTraceReader& operator=(const DelegateTraceReader&) = delete;
+
+    ~DelegateTraceReader() {
+        if (m_data)
+            munmap(m_data, m_size);
+    }
+
+    // Returns false if the file is missing or not a trace
+    bool open(const std::string& path) {
+        DelegateTraceReader().swap(*this);
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        void* p = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && size_t(st.st_size) >= DelegateTraceHeader::Size)
+            p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED)
+            return false;
+        m_data = static_cast<char*>(p);
+        m_size = size_t(st.st_size);
+
+        const DelegateTraceHeader& h = header();
+        if (h.magic != DelegateTraceHeader::Magic || h.version != DelegateTraceHeader::Version
+            || h.recordSize != sizeof(DelegateTraceRecord)) {
+            DelegateTraceReader().swap(*this);
+            return false;
+        }
+
+        // Records are written in order, the unwritten ones are zero
+        const size_t capacity = (m_size - DelegateTraceHeader::Size) / sizeof(DelegateTraceRecord);
+        const DelegateTraceRecord* first = begin();
+        m_count = size_t(std::partition_point(first, first + capacity, [](const DelegateTraceRecord& r) {
+            return r.start != 0;
+        }) - first);
+        return true;
+    }
+
+    inline bool valid() const { return m_data != nullptr; }
+    inline const DelegateTraceHeader& header() const { return *reinterpret_cast<const DelegateTraceHeader*>(m_data); }
+
+    inline const DelegateTraceRecord* begin() const {
+        return reinterpret_cast<const DelegateTraceRecord*>(m_data + DelegateTraceHeader::Size);
+    }
+    inline const DelegateTraceRecord* end() const { return begin() + m_count; }
+    inline size_t size() const { return m_count; }
+
+    // From the clocks of the header, 0 if the file was not closed
+    double nanosecondsPerCycle() const {
+        const DelegateTraceHeader& h = header();
+        if (h.endCycles <= h.startCycles)
+            return 0;
+        return double(h.endNanoseconds - h.startNanoseconds) / double(h.endCycles - h.startCycles);
+    }
+
+private:
+    void swap(DelegateTraceReader& o) {
+        std::swap(m_data, o.m_data);
+        std::swap(m_size, o.m_size);
+        std::swap(m_count, o.m_count);
+    }
+
+    char* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_count = 0;
+};
+
+} // end delly namespace
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "Delegate.h"
+
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+#if defined(_DEBUG) || !defined(NDEBUG)
+#define DEBUG_ASSERT(x) assert((x))
+#else
+#define DEBUG_ASSERT(x)
+#endif
+
+namespace delly {
+
+namespace details {
+
+// A compile time method called as a function, on the object passed as its
+// first argument
+template <auto Method, typename Signature = typename MethodTraits<decltype(Method)>::Signature>
+struct UnboundMethod;
+
+template <auto Method, typename RetType, typename... Args>
+struct UnboundMethod<Method, RetType(Args...)> {
+    using Object = typename MethodTraits<decltype(Method)>::Object;
+    using Signature = RetType(Object&, Args...);
+
+    static RetType Call(Object& obj, Args... args) {
+        return (obj.*Method)(std::forward<Args>(args)...);
+    }
+};
+
+} // end details namespace
+
+template <typename Enum, typename Signature, size_t Count = size_t(Enum::Count)> class DispatchArray;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// DispatchArray is an array of delegates indexed by the values of an enum,
+// in place of a switch calling a method per value, eg. the handler of each
+// state of a state machine or of each opcode of an interpreter.  The enum
+// values must be 0 to Count - 1, Count defaults to the value Enum::Count.
+//
+//     enum class State { Idle, Open, Closing, Count };
+//     struct Connection { void onIdle(Event); void onOpen(Event); void onClosing(Event); };
+//
+//     constinit const auto handlers = MakeDispatchArray<State,
+//         &Connection::onIdle, &Connection::onOpen, &Connection::onClosing>(g_connection);
+//     handlers(state, event);
+//
+// Arrays of compile time methods of objects with static storage duration,
+// and of functions, are constant expressions.  Dispatching is an indexed
+// load and the delegate call.  The key and the handler are checked unless
+// NDEBUG is defined, as the rest of the library; a build without NDEBUG,
+// such as the default release flags of this repository, keeps the checks.
+//
+// Handlers which all act on one object, such as the opcodes of a virtual
+// machine, are faster as methods receiving the object as an argument:
+//
+//     constexpr auto ops = MakeDispatchArray<Op, &Machine::onAdd, &Machine::onJump>();
+//     ops.run(first, Op::Halt, machine);   // Op(Machine&) handlers
+//
+// The object then stays in a register from one handler to the next, where
+// a bound object is loaded from the array after each handler returns the
+// next key, adding a load to every dispatch.
+//
+
+template <typename Enum, typename RetType, typename... Args, size_t Count>
+class DispatchArray<Enum, RetType(Args...), Count> {
+    static_assert(std::is_enum<Enum>::value, "DispatchArray is indexed by an enum");
+
+public:
+    using DelegateType = Delegate<RetType(Args...)>;
+
+    struct Entry {
+        Enum key;
+        DelegateType handler;
+    };
+
+    constexpr DispatchArray() = default;
+
+    // Handlers by key, in any order, missing keys have no handler
+    constexpr DispatchArray(std::initializer_list<Entry> entries) {
+        for (const Entry& e : entries)
+            m_handlers[Index(e.key)] = e.handler;
+    }
+
+    // Compile time methods of one object, in the order of the keys from the
+    // first one.  Keys after the last method have no handler.
+    template <auto... Methods, class Y>
+    static constexpr DispatchArray FromMethods(Y& obj) {
+        static_assert(sizeof...(Methods) <= Count, "More methods than keys");
+        DispatchArray a;
+        size_t i = 0;
+        ((a.m_handlers[i++] = MakeDelegate<Methods>(obj)), ...);
+        return a;
+    }
+
+    // Compile time methods called on the object passed as first argument,
+    // in the order of the keys from the first one
+    template <auto... Methods>
+    static constexpr DispatchArray FromMethods() {
+        static_assert(sizeof...(Methods) <= Count, "More methods than keys");
+        DispatchArray a;
+        size_t i = 0;
+        ((a.m_handlers[i++] = DelegateType(&details::UnboundMethod<Methods>::Call)), ...);
+        return a;
+    }
+
+    static constexpr size_t size() { return Count; }
+
+    constexpr void set(Enum key, const DelegateType& handler) { m_handlers[Index(key)] = handler; }
+
+    inline const DelegateType& operator[](Enum key) const {
+        DEBUG_ASSERT(Index(key) < Count);
+        return m_handlers[Index(key)];
+    }
+
+    inline bool contains(Enum key) const { return Index(key) < Count && !m_handlers[Index(key)].empty(); }
+
+    inline const DelegateType* begin() const { return m_handlers; }
+    inline const DelegateType* end() const { return m_handlers + Count; }
+
+    // Call the handler of a key, arguments are passed as by
+    // Delegate::operator()
+    template <typename... Params, typename = typename std::enable_if<
+                  std::conjunction<std::is_convertible<Params&&, Args>...>::value>::type>
+    inline RetType operator() (Enum key, Params&& ... params) const {
+        DEBUG_ASSERT(contains(key));
+        return m_handlers[Index(key)](std::forward<Params>(params)...);
+    }
+
+    inline RetType operator() (Enum key, details::BracedParamType<Args> ... args) const {
+        DEBUG_ASSERT(contains(key));
+        return m_handlers[Index(key)](std::forward<details::BracedParamType<Args>>(args)...);
+    }
+
+    // Threaded dispatch, for handlers returning the key of the next handler
+    // such as the next opcode: calls the handlers from 'first' on, until one
+    // returns 'stop'.  Every handler receives the same arguments.
+    void run(Enum first, Enum stop, Args... args) const {
+        static_assert(std::is_same<RetType, Enum>::value, "run() requires handlers returning the next key");
+        for (Enum key = first; key != stop; )
+            key = operator()(key, args...);
+    }
+
+private:
+    static constexpr size_t Index(Enum key) { return static_cast<size_t>(key); }
+
+    DelegateType m_handlers[Count] = {};
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Helper functions make the DispatchArray of compile time methods, one per
+// key in the order of the keys: bound to one object, or called on the
+// object passed as first argument
+//
+
+template <typename Enum, auto First, auto... Rest, class Y>
+constexpr DispatchArray<Enum, typename details::MethodTraits<decltype(First)>::Signature, 1 + sizeof...(Rest)>
+MakeDispatchArray(Y& obj) {
+    using Array = DispatchArray<Enum, typename details::MethodTraits<decltype(First)>::Signature, 1 + sizeof...(Rest)>;
+    return Array::template FromMethods<First, Rest...>(obj);
+}
+
+template <typename Enum, auto First, auto... Rest>
+constexpr DispatchArray<Enum, typename details::UnboundMethod<First>::Signature, 1 + sizeof...(Rest)>
+MakeDispatchArray() {
+    using Array = DispatchArray<Enum, typename details::UnboundMethod<First>::Signature, 1 + sizeof...(Rest)>;
+    return Array::template FromMethods<First, Rest...>();
+}
+
+} // end delly namespace
+
+#undef DEBUG_ASSERT
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Delegate.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace delly {
+
+template <typename Signature> class DispatchTable;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// DispatchTable invokes a large list of delegates, grouped by the code they
+// call.  Consecutive calls to the same method on different objects jump to
+// the same target, which the indirect branch predictor gets right, where a
+// list in registration order alternates targets and mispredicts.
+//
+// Each delegate has an order: all delegates of a lower order are invoked
+// before those of a higher order.  Within an order, the invocation order is
+// unspecified.  Virtual methods are grouped by their final overrider, looked
+// up when the delegate is added.
+//
+// The table is kept sorted by add(), so invoking it does not modify it and
+// several threads may invoke the same table at once.  Delegates must not be
+// added or removed while the table is invoked.
+//
+
+template <typename... Args>
+class DispatchTable<void(Args...)> {
+
+    using DummyClass = details::DummyClass;
+    using DelegateStorage = details::DelegateStorage;
+
+public:
+    using DelegateType = Delegate<void(Args...)>;
+
+    DispatchTable() = default;
+
+    // Insert d among the delegates of its order and target, O(n)
+    void add(const DelegateType& d, int order = 0) {
+        assert(!d.empty());
+        const Entry e{ targetOf(d.storage()), order, d.storage() };
+        m_entries.insert(std::upper_bound(m_entries.begin(), m_entries.end(), e, &Entry::Less), e);
+    }
+
+    // Remove the first delegate equal to d, O(n)
+    bool remove(const DelegateType& d) {
+        auto it = std::find_if(m_entries.begin(), m_entries.end(),
+                               [&](const Entry& e) { return e.storage == d.storage(); });
+        if (it == m_entries.end())
+            return false;
+        // Erasing keeps the remaining entries sorted
+        m_entries.erase(it);
+        return true;
+    }
+
+    bool contains(const DelegateType& d) const {
+        return std::any_of(m_entries.begin(), m_entries.end(),
+                           [&](const Entry& e) { return e.storage == d.storage(); });
+    }
+
+    void clear() { m_entries.clear(); }
+    void reserve(size_t n) { m_entries.reserve(n); }
+
+    inline size_t size() const { return m_entries.size(); }
+    inline bool empty() const { return m_entries.empty(); }
+
+    // Invoke every delegate
+    void operator() (Args ... args) const {
+        for (const Entry& e : m_entries)
+            DelegateType(e.storage)(args...);
+    }
+
+private:
+    // Address of the code a delegate ends up calling.  Static functions are
+    // stored as the object, with no method.
+    static uintptr_t targetOf(const DelegateStorage& s) {
+        if (!s.hasMethod())
+            return reinterpret_cast<uintptr_t>(s.getThis());
+        using MemFunc = void (DummyClass::*)(Args...);
+        auto func = reinterpret_cast<MemFunc>(s.getMemFunc());
+        return details::DirectCallHelper<sizeof(MemFunc)>::Decode(s.getThis(), func).address();
+    }
+
+    struct Entry {
+        uintptr_t target;
+        int order;
+        DelegateStorage storage;
+
+        // Group the delegates by order and target
+        static bool Less(const Entry& a, const Entry& b) {
+            if (a.order != b.order)
+                return a.order < b.order;
+            if (a.target != b.target)
+                return a.target < b.target;
+            return a.storage < b.storage;
+        }
+    };
+
+    std::vector<Entry> m_entries;
+};
+
+} // end delly namespace
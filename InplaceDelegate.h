@@ -0,0 +1,190 @@
+#pragma once
+
+#include "Delegate.h"
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace delly {
+
+namespace details {
+
+// Operations on callables which cannot be copied as raw bytes
+enum class InplaceOp { Copy, Move, Destroy };
+
+// Default capacity makes the whole InplaceDelegate one cache line
+static const size_t InplaceDefaultCapacity = CacheLineSize - 2 * sizeof(void*);
+
+} // end details namespace
+
+template <typename Signature, size_t Capacity = details::InplaceDefaultCapacity>
+class InplaceDelegate;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// InplaceDelegate stores any copyable callable, including lambdas with
+// captures, in a fixed buffer of Capacity bytes.  It never allocates and
+// callables which do not fit are rejected at compile time.
+//
+// Invocation is a single call through the stored thunk.  Trivially copyable
+// callables, such as Delegate and function pointers, are copied as raw
+// bytes and need no destructor.
+//
+
+template <typename RetType, typename... Args, size_t Capacity>
+class InplaceDelegate<RetType(Args...), Capacity> {
+
+    using InvokeFunc = RetType (*) (void*, Args...);
+    using ManageFunc = void (*) (details::InplaceOp, void*, void*);
+
+    template <class F>
+    using EnableCallable = typename std::enable_if<
+        !std::is_same<typename std::decay<F>::type, InplaceDelegate>::value
+        && std::is_invocable_r<RetType, typename std::decay<F>::type&, Args...>::value>::type;
+
+public:
+    using DelegateType = Delegate<RetType(Args...)>;
+    static constexpr size_t capacity = Capacity;
+
+    InplaceDelegate() = default;
+    InplaceDelegate(const std::nullptr_t) noexcept : InplaceDelegate() {}
+
+    InplaceDelegate(const InplaceDelegate& o) { copyFrom(o); }
+    InplaceDelegate(InplaceDelegate&& o) noexcept { moveFrom(o); }
+
+    // Any callable: lambdas, functors, function pointers and Delegates.
+    // Null function pointers and empty Delegates make an empty InplaceDelegate.
+    template <class F, class = EnableCallable<F>>
+    InplaceDelegate(F&& f) { store(std::forward<F>(f)); }
+
+    ~InplaceDelegate() { destroy(); }
+
+    InplaceDelegate& operator=(const InplaceDelegate& o) {
+        if (this != &o) {
+            destroy();
+            copyFrom(o);
+        }
+        return *this;
+    }
+
+    InplaceDelegate& operator=(InplaceDelegate&& o) noexcept {
+        if (this != &o) {
+            destroy();
+            moveFrom(o);
+        }
+        return *this;
+    }
+
+    InplaceDelegate& operator=(const std::nullptr_t) {
+        reset();
+        return *this;
+    }
+
+    template <class F, class = EnableCallable<F>>
+    InplaceDelegate& operator=(F&& f) {
+        destroy();
+        store(std::forward<F>(f));
+        return *this;
+    }
+
+    // Invoke the stored callable
+    RetType operator() (Args ... args) const {
+        return m_invoke(const_cast<Buffer*>(&m_buffer), std::forward<Args>(args)...);
+    }
+
+    void reset() { destroy(); }
+
+    inline bool empty() const { return !m_invoke; }
+    inline explicit operator bool() const { return !empty(); }
+    inline bool operator!() const { return empty(); }
+
+    inline bool operator==(const std::nullptr_t) const { return empty(); }
+    inline bool operator!=(const std::nullptr_t) const { return !empty(); }
+
+private:
+    using Buffer = typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type;
+
+    template <class F>
+    void store(F&& f) {
+        using Fn = typename std::decay<F>::type;
+        static_assert(sizeof(Fn) <= Capacity, "Callable is too large for the InplaceDelegate capacity");
+        static_assert(alignof(Fn) <= alignof(Buffer), "Callable is over-aligned for InplaceDelegate");
+        static_assert(std::is_copy_constructible<Fn>::value, "Callable must be copy constructible");
+
+        if (IsNull(f))
+            return;
+
+        ::new (static_cast<void*>(&m_buffer)) Fn(std::forward<F>(f));
+        m_invoke = &Invoke<Fn>;
+        m_manage = std::is_trivially_copyable<Fn>::value ? nullptr : &Manage<Fn>;
+    }
+
+    void copyFrom(const InplaceDelegate& o) {
+        if (o.m_manage)
+            o.m_manage(details::InplaceOp::Copy, &m_buffer, const_cast<Buffer*>(&o.m_buffer));
+        else
+            memcpy(&m_buffer, &o.m_buffer, sizeof(m_buffer));
+        m_invoke = o.m_invoke;
+        m_manage = o.m_manage;
+    }
+
+    void moveFrom(InplaceDelegate& o) {
+        if (o.m_manage)
+            o.m_manage(details::InplaceOp::Move, &m_buffer, &o.m_buffer);
+        else
+            memcpy(&m_buffer, &o.m_buffer, sizeof(m_buffer));
+        m_invoke = o.m_invoke;
+        m_manage = o.m_manage;
+        o.destroy();
+    }
+
+    void destroy() {
+        if (m_manage)
+            m_manage(details::InplaceOp::Destroy, &m_buffer, nullptr);
+        m_invoke = nullptr;
+        m_manage = nullptr;
+    }
+
+    template <class Fn>
+    static RetType Invoke(void* buffer, Args ... args) {
+        if constexpr (std::is_void<RetType>::value)
+            std::invoke(*static_cast<Fn*>(buffer), std::forward<Args>(args)...);
+        else
+            return std::invoke(*static_cast<Fn*>(buffer), std::forward<Args>(args)...);
+    }
+
+    template <class Fn>
+    static void Manage(details::InplaceOp op, void* dst, void* src) {
+        switch (op) {
+        case details::InplaceOp::Copy:
+            ::new (dst) Fn(*static_cast<const Fn*>(src));
+            break;
+        case details::InplaceOp::Move:
+            ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+            break;
+        case details::InplaceOp::Destroy:
+            static_cast<Fn*>(dst)->~Fn();
+            break;
+        }
+    }
+
+    template <class Fn>
+    static bool IsNull(const Fn& f) {
+        if constexpr (std::is_pointer<Fn>::value || std::is_member_pointer<Fn>::value)
+            return f == nullptr;
+        else
+            return false;
+    }
+
+    static bool IsNull(const DelegateType& d) { return d.empty(); }
+
+    Buffer m_buffer;
+    InvokeFunc m_invoke = nullptr;
+    ManageFunc m_manage = nullptr;
+};
+
+} // end delly namespace
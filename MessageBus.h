@@ -0,0 +1,128 @@
+#pragma once
+
+#include "MulticastDelegate.h"
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+namespace delly {
+
+namespace details {
+
+// Position of T in a list of types, the list size if absent
+template <class T, class... List>
+struct TypeIndex;
+
+template <class T>
+struct TypeIndex<T> : std::integral_constant<size_t, 0> {};
+
+template <class T, class... Rest>
+struct TypeIndex<T, T, Rest...> : std::integral_constant<size_t, 0> {};
+
+template <class T, class First, class... Rest>
+struct TypeIndex<T, First, Rest...>
+    : std::integral_constant<size_t, 1 + TypeIndex<T, Rest...>::value> {};
+
+// The message type of a compile time handler method, void(const T&)
+template <class Signature>
+struct MessageOf;
+
+template <class T>
+struct MessageOf<void(const T&)> { using Type = T; };
+
+} // end details namespace
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// MessageBus routes messages of a fixed set of types to the subscribers of
+// each type:
+//
+//     MessageBus<Quote, Trade, Heartbeat> bus;
+//     bus.subscribe<Quote>(MakeDelegate<&Book::OnQuote>(book));
+//     bus.subscribe<&Tape::OnTrade>(tape);
+//     bus.publish(Quote{ ... });
+//
+// Each type has its own MulticastDelegate, found through the position of
+// the type in the list, so publishing is a direct call of the subscribers
+// of the type with no lookup, hashing or allocation.  Types not in the
+// list do not compile.
+//
+// Subscribers must not be added or removed while a message of their type
+// is published.
+//
+
+template <class... Msgs>
+class MessageBus {
+public:
+    template <class T>
+    using Channel = MulticastDelegate<void(const T&)>;
+
+    template <class T>
+    using Handler = Delegate<void(const T&)>;
+
+    // Handle of a subscriber, typed by its message so that it can only
+    // unsubscribe from the channel it was added to
+    template <class T>
+    struct Subscription {
+        details::MulticastHandle handle;
+
+        inline bool valid() const { return handle.valid(); }
+        inline explicit operator bool() const { return valid(); }
+
+        inline bool operator==(const Subscription& o) const { return handle == o.handle; }
+        inline bool operator!=(const Subscription& o) const { return !operator==(o); }
+    };
+
+    // Dense id of a message type, its position in the list
+    template <class T>
+    static constexpr size_t TypeId() {
+        constexpr size_t id = details::TypeIndex<T, Msgs...>::value;
+        static_assert(id < sizeof...(Msgs), "Message type not routed by this bus");
+        return id;
+    }
+
+    static constexpr size_t TypeCount() { return sizeof...(Msgs); }
+
+    template <class T>
+    Subscription<T> subscribe(const Handler<T>& handler) {
+        return { channel<T>().add(handler) };
+    }
+
+    // Subscribe a compile time method taking the message, eg.
+    // subscribe<&X::OnQuote>(x)
+    template <auto Method, class Y>
+    auto subscribe(Y& obj) {
+        using T = typename details::MessageOf<typename details::MethodTraits<decltype(Method)>::Signature>::Type;
+        return Subscription<T>{ channel<T>().add(MakeDelegate<Method>(obj)) };
+    }
+
+    template <class T>
+    bool unsubscribe(Subscription<T> s) { return channel<T>().remove(s.handle); }
+
+    template <class T>
+    bool unsubscribe(const Handler<T>& handler) { return channel<T>().remove(handler); }
+
+    template <class T>
+    inline void publish(const T& message) const {
+        channel<T>()(message);
+    }
+
+    template <class T>
+    inline size_t subscribers() const { return channel<T>().size(); }
+
+    template <class T>
+    inline Channel<T>& channel() { return std::get<TypeId<T>()>(m_channels); }
+
+    template <class T>
+    inline const Channel<T>& channel() const { return std::get<TypeId<T>()>(m_channels); }
+
+    void clear() {
+        std::apply([](auto&... channels) { (channels.clear(), ...); }, m_channels);
+    }
+
+private:
+    std::tuple<Channel<Msgs>...> m_channels;
+};
+
+} // end delly namespace
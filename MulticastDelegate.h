@@ -0,0 +1,189 @@
+#pragma once
+
+#include "Delegate.h"
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace delly {
+
+namespace details {
+
+inline void PrefetchRead(const void* p) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p, 0, 3);
+#else
+    (void)p;
+#endif
+}
+
+// Subscriber handle: a slot index and the generation of the slot when added
+struct MulticastHandle {
+    uint32_t index = 0;
+    uint32_t generation = 0;
+
+    inline bool valid() const { return generation != 0; }
+    inline explicit operator bool() const { return valid(); }
+
+    inline bool operator==(const MulticastHandle& o) const {
+        return index == o.index && generation == o.generation;
+    }
+    inline bool operator!=(const MulticastHandle& o) const { return !operator==(o); }
+};
+
+} // end details namespace
+
+template <typename Signature> class MulticastDelegate;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// MulticastDelegate invokes any number of delegates with the same arguments.
+//
+// The bound objects and methods are kept in two separate, dense arrays so
+// dispatch is one loop over contiguous memory, prefetching the objects of
+// upcoming subscribers.  Subscribers are added and removed in O(1) through
+// handles.  Removal moves the last subscriber into the freed position, so
+// the dispatch order is unspecified.
+//
+// Subscribers must not be added or removed while the delegate is invoked.
+//
+
+template <typename... Args>
+class MulticastDelegate<void(Args...)> {
+
+    using DummyClass = details::DummyClass;
+    using DelegateStorage = details::DelegateStorage;
+    using DelegateFuncStorage = details::DelegateFuncStorage;
+
+public:
+    using DelegateType = Delegate<void(Args...)>;
+    using Handle = details::MulticastHandle;
+
+    // Number of subscribers ahead of the current one to prefetch
+    static constexpr size_t PrefetchDistance = 8;
+
+    MulticastDelegate() = default;
+
+    // Add a subscriber, returns the handle used to remove it
+    Handle add(const DelegateType& d) {
+        assert(!d.empty());
+
+        uint32_t slot;
+        if (m_freeSlot != NoSlot) {
+            slot = m_freeSlot;
+            m_freeSlot = m_slots[slot].dense;
+        } else {
+            slot = uint32_t(m_slots.size());
+            m_slots.push_back({});
+        }
+
+        const DelegateStorage& s = d.storage();
+        m_slots[slot].dense = uint32_t(m_objects.size());
+        m_objects.push_back(s.getThis());
+        m_funcs.push_back(s.getFuncStorage());
+        m_denseToSlot.push_back(slot);
+        return { slot, m_slots[slot].generation };
+    }
+
+    // Remove a subscriber, returns false if the handle is no longer valid
+    bool remove(Handle h) {
+        if (h.index >= m_slots.size() || m_slots[h.index].generation != h.generation)
+            return false;
+
+        const uint32_t dense = m_slots[h.index].dense;
+        const uint32_t last = uint32_t(m_objects.size() - 1);
+        if (dense != last) {
+            m_objects[dense] = m_objects[last];
+            m_funcs[dense] = m_funcs[last];
+            m_denseToSlot[dense] = m_denseToSlot[last];
+            m_slots[m_denseToSlot[dense]].dense = dense;
+        }
+        m_objects.pop_back();
+        m_funcs.pop_back();
+        m_denseToSlot.pop_back();
+        releaseSlot(h.index);
+        return true;
+    }
+
+    // Remove the first subscriber equal to the delegate, O(n)
+    bool remove(const DelegateType& d) {
+        const DelegateStorage& s = d.storage();
+        for (size_t i = 0; i < m_objects.size(); ++i) {
+            if (DelegateStorage::FromParts(m_objects[i], m_funcs[i]) == s) {
+                const uint32_t slot = m_denseToSlot[i];
+                return remove(Handle{ slot, m_slots[slot].generation });
+            }
+        }
+        return false;
+    }
+
+    bool contains(Handle h) const {
+        return h.index < m_slots.size() && m_slots[h.index].generation == h.generation;
+    }
+
+    void clear() {
+        for (uint32_t slot : m_denseToSlot)
+            releaseSlot(slot);
+        m_objects.clear();
+        m_funcs.clear();
+        m_denseToSlot.clear();
+    }
+
+    void reserve(size_t n) {
+        m_objects.reserve(n);
+        m_funcs.reserve(n);
+        m_denseToSlot.reserve(n);
+        m_slots.reserve(n);
+    }
+
+    inline size_t size() const { return m_objects.size(); }
+    inline bool empty() const { return m_objects.empty(); }
+    inline explicit operator bool() const { return !empty(); }
+    inline bool operator!() const { return empty(); }
+
+    // Invoke every subscriber
+    void operator() (Args ... args) const {
+        DummyClass* const* objects = m_objects.data();
+        const DelegateFuncStorage* funcs = m_funcs.data();
+        const size_t n = m_objects.size();
+
+        size_t i = 0;
+        for (; i + PrefetchDistance < n; ++i) {
+            details::PrefetchRead(objects[i + PrefetchDistance]);
+            DelegateType(DelegateStorage::FromParts(objects[i], funcs[i]))(args...);
+        }
+        for (; i < n; ++i) {
+            DelegateType(DelegateStorage::FromParts(objects[i], funcs[i]))(args...);
+        }
+    }
+
+private:
+    static constexpr uint32_t NoSlot = ~uint32_t(0);
+
+    // Invalidate handles to the slot and put it on the free list
+    void releaseSlot(uint32_t index) {
+        Slot& slot = m_slots[index];
+        // Generation 0 is reserved for invalid handles
+        if (++slot.generation == 0)
+            slot.generation = 1;
+        slot.dense = m_freeSlot;
+        m_freeSlot = index;
+    }
+
+    struct Slot {
+        uint32_t dense = 0; // index in the dense arrays, or next free slot
+        uint32_t generation = 1;
+    };
+
+    // Dense arrays, one entry per subscriber
+    std::vector<DummyClass*> m_objects;
+    std::vector<DelegateFuncStorage> m_funcs;
+    std::vector<uint32_t> m_denseToSlot;
+
+    // Handle slots
+    std::vector<Slot> m_slots;
+    uint32_t m_freeSlot = NoSlot;
+};
+
+} // end delly namespace
@@ -0,0 +1,280 @@
+#pragma once
+
+#include "DelegateRegistry.h"
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace delly {
+
+struct ObjectHandle
+{
+    uint32_t value;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// SharedCallRing passes calls from one process to another running the same
+// binary, eg. to worker processes, through a ring buffer of bytes in shared
+// memory.  Linux only.
+//
+// Each call is one record: the id of the target in the DelegateRegistry, the
+// handle of the object, and the arguments, which must be trivially copyable.
+// The producer writes them directly into the ring and the consumer calls the
+// target with references to them, nothing is serialized or copied in
+// between.  There is one producer and one consumer; the producer publishes
+// records by storing the tail, the consumer hands the space back by storing
+// the head.
+//
+//     // Parent
+//     SharedCallRing ring = SharedCallRing::Create(1 << 20);
+//     // fork, or pass ring.fd() over a unix socket
+//     ring.push<&Worker::OnJob>(ObjectHandle{ 7 }, job, priority);
+//     ring.push<&Flush>();
+//
+//     // Worker
+//     SharedCallRing ring = SharedCallRing::Open(fd);
+//     registry.add<&Worker::OnJob>();
+//     registry.setObject(7, worker);
+//     ring.drain(registry);
+//
+// The ring lives in a memfd, which is inherited across fork and exec.
+// Records the registry cannot call are skipped and counted by dropped.
+// Creating or mapping the ring throws std::system_error on failure.
+//
+
+class SharedCallRing {
+public:
+    // Records are aligned on 8 bytes, their arguments must not be over-aligned
+    static constexpr size_t RecordAlignment = sizeof(uint64_t);
+
+    // A ring of capacity bytes, rounded up to a power of two, in a new memfd
+    static SharedCallRing Create(size_t capacity = 1 << 16) {
+        size_t size = 64;
+        while (size < capacity)
+            size *= 2;
+
+        const int fd = memfd_create("delly-call-ring", 0);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "memfd_create");
+        if (ftruncate(fd, off_t(sizeof(Header) + size)) != 0) {
+            const int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "ftruncate");
+        }
+
+        SharedCallRing ring(fd, sizeof(Header) + size);
+        ring.m_header->capacity = size;
+        ring.m_header->magic = Magic;
+        ring.m_capacity = size;
+        return ring;
+    }
+
+    // Map the ring of a memfd made by Create in this or another process.
+    // The descriptor is duplicated, the caller keeps its own.
+    static SharedCallRing Open(int fd) {
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+            throw std::system_error(errno, std::generic_category(), "fstat");
+        if (size_t(st.st_size) < sizeof(Header))
+            throw std::system_error(EINVAL, std::generic_category(), "SharedCallRing::Open");
+        const int copy = dup(fd);
+        if (copy < 0)
+            throw std::system_error(errno, std::generic_category(), "dup");
+
+        SharedCallRing ring(copy, size_t(st.st_size));
+        if (ring.m_header->magic != Magic || sizeof(Header) + ring.m_header->capacity != size_t(st.st_size))
+            throw std::system_error(EINVAL, std::generic_category(), "SharedCallRing::Open");
+        ring.m_capacity = ring.m_header->capacity;
+        return ring;
+    }
+
+    SharedCallRing(SharedCallRing&& o) noexcept { swap(o); }
+
+    SharedCallRing& operator=(SharedCallRing&& o) noexcept {
+        SharedCallRing(std::move(o)).swap(*this);
+        return *this;
+    }
+
+    SharedCallRing(const SharedCallRing&) = delete;
+    SharedCallRing& operator=(const SharedCallRing&) = delete;
+
+    ~SharedCallRing() {
+        if (m_header)
+            munmap(m_header, m_mappedSize);
+        if (m_fd >= 0)
+            close(m_fd);
+    }
+
+    inline int fd() const { return m_fd; }
+    inline size_t capacity() const { return m_capacity; }
+
+    // Queue a call of a method on the object of a handle, returns false if
+    // the ring is full
+    template <auto Method, typename... Values,
+              typename = typename std::enable_if<std::is_member_function_pointer<decltype(Method)>::value>::type>
+    bool tryPush(ObjectHandle object, Values&&... values) {
+        return write<Method>(object.value, std::forward<Values>(values)...);
+    }
+
+    // Queue a call of a function, returns false if the ring is full
+    template <auto Function, typename... Values,
+              typename = typename std::enable_if<!std::is_member_function_pointer<decltype(Function)>::value>::type>
+    bool tryPush(Values&&... values) {
+        return write<Function>(0, std::forward<Values>(values)...);
+    }
+
+    // Queue a call, waiting while the ring is full
+    template <auto Method, typename... Values,
+              typename = typename std::enable_if<std::is_member_function_pointer<decltype(Method)>::value>::type>
+    void push(ObjectHandle object, const Values&... values) {
+        while (!write<Method>(object.value, values...))
+            std::this_thread::yield();
+    }
+
+    template <auto Function, typename... Values,
+              typename = typename std::enable_if<!std::is_member_function_pointer<decltype(Function)>::value>::type>
+    void push(const Values&... values) {
+        while (!write<Function>(0, values...))
+            std::this_thread::yield();
+    }
+
+    // Call the queued records in order through the registry, at most
+    // maxCalls, from the consumer.  Returns the number of calls made.
+    size_t drain(const DelegateRegistry& registry, size_t maxCalls = ~size_t(0)) {
+        uint64_t head = m_header->head.load(std::memory_order_relaxed);
+        const uint64_t tail = m_header->tail.load(std::memory_order_acquire);
+        size_t calls = 0;
+        while (calls < maxCalls && head != tail) {
+            Record* r = recordAt(size_t(head & (m_capacity - 1)));
+            assert(r->size && r->size % RecordAlignment == 0 && r->size <= tail - head);
+            head += r->size;
+            if (r->id == 0)
+                continue;
+            if (registry.invoke(r->id, r->object, r + 1, r->argsSize))
+                ++calls;
+            else
+                ++m_dropped;
+        }
+        m_header->head.store(head, std::memory_order_release);
+        return calls;
+    }
+
+    // True if no call is queued
+    bool empty() const {
+        return m_header->head.load(std::memory_order_acquire) == m_header->tail.load(std::memory_order_acquire);
+    }
+
+    // Records skipped by drain in this process
+    inline size_t dropped() const { return m_dropped; }
+
+private:
+    static constexpr uint64_t Magic = 0x676e6972636c6c64; // "dllcring"
+
+    // The positions are atomics shared by the two processes, which must not
+    // take a lock
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+    // At the start of the memfd, followed by the ring.  Positions are byte
+    // positions, increasing forever; the offset is position & (capacity - 1).
+    struct Header {
+        uint64_t magic;
+        uint64_t capacity;
+        alignas(details::CacheLineSize) std::atomic<uint64_t> tail;
+        alignas(details::CacheLineSize) std::atomic<uint64_t> head;
+    };
+
+    // Followed by the arguments.  Padding records at the end of the ring
+    // have id 0, and only their size and id are written: the gap they fill
+    // may be as small as 8 bytes.
+    struct Record {
+        uint32_t size;
+        uint32_t id;
+        uint32_t object;
+        uint32_t argsSize;
+    };
+
+    SharedCallRing() = default;
+
+    SharedCallRing(int fd, size_t mappedSize) : m_mappedSize(mappedSize), m_fd(fd) {
+        void* p = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            const int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "mmap");
+        }
+        m_header = static_cast<Header*>(p);
+    }
+
+    void swap(SharedCallRing& o) {
+        std::swap(m_header, o.m_header);
+        std::swap(m_capacity, o.m_capacity);
+        std::swap(m_mappedSize, o.m_mappedSize);
+        std::swap(m_fd, o.m_fd);
+        std::swap(m_cachedHead, o.m_cachedHead);
+        std::swap(m_dropped, o.m_dropped);
+    }
+
+    static constexpr size_t RoundUp(size_t size) {
+        return (size + RecordAlignment - 1) & ~(RecordAlignment - 1);
+    }
+
+    inline Record* recordAt(size_t offset) const {
+        return reinterpret_cast<Record*>(reinterpret_cast<char*>(m_header + 1) + offset);
+    }
+
+    template <auto Target, typename... Values>
+    bool write(uint32_t object, Values&&... values) {
+        using Signature = typename details::TargetTraits<decltype(Target)>::Signature;
+        using Packed = typename details::PackedArgs<Signature>::Type;
+        static_assert(std::is_void<typename details::TargetTraits<decltype(Target)>::ReturnType>::value,
+                      "Queued targets must return void");
+        static_assert(alignof(Packed) <= RecordAlignment, "Arguments must not be over-aligned");
+
+        constexpr size_t size = RoundUp(sizeof(Record) + sizeof(Packed));
+        assert(size <= m_capacity / 4);
+
+        const uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+        size_t offset = size_t(tail & (m_capacity - 1));
+        // Records do not wrap, pad to the start of the ring instead
+        const size_t padding = (offset + size > m_capacity) ? m_capacity - offset : 0;
+        if (tail + padding + size - m_cachedHead > m_capacity) {
+            m_cachedHead = m_header->head.load(std::memory_order_acquire);
+            if (tail + padding + size - m_cachedHead > m_capacity)
+                return false;
+        }
+
+        if (padding) {
+            Record* pad = recordAt(offset);
+            pad->size = uint32_t(padding);
+            pad->id = 0;
+            offset = 0;
+        }
+        Record* r = recordAt(offset);
+        *r = Record{ uint32_t(size), DelegateRegistry::IdOf<Target>(), object, uint32_t(sizeof(Packed)) };
+        DelegateRegistry::PackArgs<Target>(r + 1, std::forward<Values>(values)...);
+        m_header->tail.store(tail + padding + size, std::memory_order_release);
+        return true;
+    }
+
+    Header* m_header = nullptr;
+    size_t m_capacity = 0;
+    size_t m_mappedSize = 0;
+    int m_fd = -1;
+    // Producer side: the head last read, the space before it is free
+    uint64_t m_cachedHead = 0;
+    // Consumer side
+    size_t m_dropped = 0;
+};
+
+} // end delly namespace
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace delly {
+
+// Handle to an object of a SlotMap: a slot index and the generation of the
+// slot when the object was inserted
+struct SlotHandle {
+    uint32_t index = 0;
+    uint32_t generation = 0;
+
+    inline bool valid() const { return generation != 0; }
+    inline explicit operator bool() const { return valid(); }
+
+    inline bool operator==(const SlotHandle& o) const {
+        return index == o.index && generation == o.generation;
+    }
+    inline bool operator!=(const SlotHandle& o) const { return !operator==(o); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// SlotMap owns objects in one dense array and hands out generation checked
+// handles to them.  Inserting and erasing are O(1); erasing moves the last
+// object into the freed position, so pointers to objects are invalidated by
+// erase() and by inserting, but handles stay valid until their object is
+// erased.  A handle to an erased object never finds the object which reuses
+// its slot.
+//
+
+template <class T>
+class SlotMap {
+public:
+    using Handle = SlotHandle;
+    using iterator = typename std::vector<T>::iterator;
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    SlotMap() = default;
+
+    template <typename... CtorArgs>
+    Handle emplace(CtorArgs&&... args) {
+        uint32_t slot;
+        if (m_freeSlot != NoSlot) {
+            slot = m_freeSlot;
+            m_freeSlot = m_slots[slot].dense;
+        } else {
+            slot = uint32_t(m_slots.size());
+            m_slots.push_back({});
+        }
+
+        m_slots[slot].dense = uint32_t(m_values.size());
+        m_values.emplace_back(std::forward<CtorArgs>(args)...);
+        m_denseToSlot.push_back(slot);
+        return { slot, m_slots[slot].generation };
+    }
+
+    Handle insert(const T& value) { return emplace(value); }
+    Handle insert(T&& value) { return emplace(std::move(value)); }
+
+    // Destroy the object, returns false if the handle is no longer valid
+    bool erase(Handle h) {
+        if (!contains(h))
+            return false;
+
+        const uint32_t dense = m_slots[h.index].dense;
+        const uint32_t last = uint32_t(m_values.size() - 1);
+        if (dense != last) {
+            m_values[dense] = std::move(m_values[last]);
+            m_denseToSlot[dense] = m_denseToSlot[last];
+            m_slots[m_denseToSlot[dense]].dense = dense;
+        }
+        m_values.pop_back();
+        m_denseToSlot.pop_back();
+        releaseSlot(h.index);
+        return true;
+    }
+
+    inline bool contains(Handle h) const {
+        return h.index < m_slots.size() && m_slots[h.index].generation == h.generation;
+    }
+
+    // The object of the handle, or null once erased
+    inline T* get(Handle h) {
+        return contains(h) ? &m_values[m_slots[h.index].dense] : nullptr;
+    }
+
+    inline const T* get(Handle h) const {
+        return contains(h) ? &m_values[m_slots[h.index].dense] : nullptr;
+    }
+
+    void clear() {
+        for (uint32_t slot : m_denseToSlot)
+            releaseSlot(slot);
+        m_values.clear();
+        m_denseToSlot.clear();
+    }
+
+    void reserve(size_t n) {
+        m_values.reserve(n);
+        m_denseToSlot.reserve(n);
+        m_slots.reserve(n);
+    }
+
+    inline size_t size() const { return m_values.size(); }
+    inline bool empty() const { return m_values.empty(); }
+
+    // Objects in storage order
+    iterator begin() { return m_values.begin(); }
+    iterator end() { return m_values.end(); }
+    const_iterator begin() const { return m_values.begin(); }
+    const_iterator end() const { return m_values.end(); }
+
+private:
+    static constexpr uint32_t NoSlot = ~uint32_t(0);
+
+    // Invalidate handles to the slot and put it on the free list
+    void releaseSlot(uint32_t index) {
+        Slot& slot = m_slots[index];
+        // Generation 0 is reserved for invalid handles
+        if (++slot.generation == 0)
+            slot.generation = 1;
+        slot.dense = m_freeSlot;
+        m_freeSlot = index;
+    }
+
+    struct Slot {
+        uint32_t dense = 0; // index in the dense arrays, or next free slot
+        uint32_t generation = 1;
+    };
+
+    // Dense arrays, one entry per object
+    std::vector<T> m_values;
+    std::vector<uint32_t> m_denseToSlot;
+
+    // Handle slots
+    std::vector<Slot> m_slots;
+    uint32_t m_freeSlot = NoSlot;
+};
+
+} // end delly namespace
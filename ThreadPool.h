@@ -0,0 +1,452 @@
+#pragma once
+
+#include "Delegate.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace delly {
+
+using Task = Delegate<void()>;
+
+namespace details {
+
+// Blocks while the word holds the expected value, until woken.  Spurious
+// wake ups are possible.
+inline void FutexWait(std::atomic<uint32_t>& word, uint32_t expected) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+    if (word.load(std::memory_order_acquire) == expected)
+        std::this_thread::yield();
+#endif
+}
+
+inline void FutexWake(std::atomic<uint32_t>& word, int count) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+#else
+    (void)word;
+    (void)count;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Chase-Lev work stealing deque of tasks, after "Correct and Efficient
+// Work-Stealing for Weak Memory Models" (Le, Pop, Cohen, Zappa Nardelli).
+//
+// The owner pushes and takes at the bottom, other threads steal from the
+// top.  Tasks are stored inline as words of their DelegateStorage, read and
+// written atomically since a thief may read a slot the owner overwrites;
+// the compare and swap on top then rejects the torn read.  The ring grows
+// when full; replaced rings are kept until the deque is destroyed, as
+// thieves may still read them.
+//
+
+class TaskDeque {
+public:
+    explicit TaskDeque(size_t capacity = 256)
+        : m_ring(newRing(capacity))
+    {}
+
+    TaskDeque(const TaskDeque&) = delete;
+    TaskDeque& operator=(const TaskDeque&) = delete;
+
+    // Owner only
+    void push(const Task& task) {
+        const int64_t b = m_bottom.load(std::memory_order_relaxed);
+        const int64_t t = m_top.load(std::memory_order_acquire);
+        Ring* ring = m_ring.load(std::memory_order_relaxed);
+        if (b - t > int64_t(ring->mask))
+            ring = grow(ring, t, b);
+        ring->store(b, task.storage());
+        // A release store rather than the paper's release fence, the same
+        // instruction on x86 and visible to ThreadSanitizer
+        m_bottom.store(b + 1, std::memory_order_release);
+    }
+
+    // Owner only, returns false if empty
+    bool take(Task& task) {
+        const int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+        Ring* ring = m_ring.load(std::memory_order_relaxed);
+        m_bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = m_top.load(std::memory_order_relaxed);
+
+        bool taken = false;
+        if (t <= b) {
+            task = Task(ring->load(b));
+            taken = true;
+            if (t == b) {
+                // Last task, race thieves for it
+                taken = m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                      std::memory_order_relaxed);
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+            }
+        } else {
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return taken;
+    }
+
+    // Any thread, returns false if empty or another thread won the task
+    bool steal(Task& task) {
+        int64_t t = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = m_bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return false;
+
+        Ring* ring = m_ring.load(std::memory_order_acquire);
+        DelegateStorage storage = ring->load(t);
+        if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                           std::memory_order_relaxed))
+            return false;
+        task = Task(storage);
+        return true;
+    }
+
+    bool empty() const {
+        return m_top.load(std::memory_order_acquire) >= m_bottom.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t TaskWords = sizeof(DelegateStorage) / sizeof(uintptr_t);
+    static_assert(sizeof(DelegateStorage) % sizeof(uintptr_t) == 0);
+    static_assert(std::is_trivially_copyable<DelegateStorage>::value);
+
+    struct Slot {
+        std::atomic<uintptr_t> words[TaskWords];
+    };
+
+    struct Ring {
+        size_t mask;
+        std::unique_ptr<Slot[]> slots;
+
+        void store(int64_t i, const DelegateStorage& storage) {
+            uintptr_t words[TaskWords];
+            memcpy(words, &storage, sizeof(words));
+            Slot& slot = slots[size_t(i) & mask];
+            for (size_t w = 0; w < TaskWords; ++w)
+                slot.words[w].store(words[w], std::memory_order_relaxed);
+        }
+
+        DelegateStorage load(int64_t i) const {
+            uintptr_t words[TaskWords];
+            const Slot& slot = slots[size_t(i) & mask];
+            for (size_t w = 0; w < TaskWords; ++w)
+                words[w] = slot.words[w].load(std::memory_order_relaxed);
+            DelegateStorage storage;
+            memcpy(&storage, words, sizeof(words));
+            return storage;
+        }
+    };
+
+    Ring* newRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity)
+            size *= 2;
+        m_rings.emplace_back(new Ring{ size - 1, std::unique_ptr<Slot[]>(new Slot[size]) });
+        return m_rings.back().get();
+    }
+
+    Ring* grow(Ring* ring, int64_t t, int64_t b) {
+        Ring* bigger = newRing(2 * (ring->mask + 1));
+        for (int64_t i = t; i < b; ++i)
+            bigger->store(i, ring->load(i));
+        m_ring.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    // Every ring allocated, owner only.  Declared first, the constructor
+    // allocates the initial ring.
+    std::vector<std::unique_ptr<Ring>> m_rings;
+
+    alignas(CacheLineSize) std::atomic<int64_t> m_top{0};
+    alignas(CacheLineSize) std::atomic<int64_t> m_bottom{0};
+    std::atomic<Ring*> m_ring;
+};
+
+} // end details namespace
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// ThreadPool runs Task (Delegate<void()>) on a fixed set of worker threads.
+//
+// Each worker has its own work stealing deque: tasks submitted from a
+// worker go to its deque and run in LIFO order, idle workers steal the
+// oldest tasks of others.  Tasks submitted from other threads go through a
+// shared queue.  Tasks are stored inline, nothing is allocated per task.
+// Workers with nothing to run or steal park on a futex until more work is
+// submitted.
+//
+// The objects bound to tasks must live until the tasks have run.  Pending
+// tasks are dropped when the pool is destroyed.
+//
+
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) {
+        if (threads == 0)
+            threads = 1;
+        for (size_t i = 0; i < threads; ++i)
+            m_workers.emplace_back(new Worker());
+        for (size_t i = 0; i < threads; ++i)
+            m_workers[i]->thread = std::thread(&ThreadPool::run, this, i);
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        m_stop.store(true, std::memory_order_seq_cst);
+        for (auto& w : m_workers) {
+            w->state.store(Running, std::memory_order_seq_cst);
+            details::FutexWake(w->state, 1);
+        }
+        for (auto& w : m_workers)
+            w->thread.join();
+    }
+
+    inline size_t size() const { return m_workers.size(); }
+
+    void submit(const Task& task) {
+        assert(!task.empty());
+        Worker* worker = currentWorker();
+        if (worker) {
+            worker->deque.push(task);
+        } else {
+            std::lock_guard<std::mutex> lock(m_injectLock);
+            m_injected.push_back(task);
+            m_injectedCount.fetch_add(1, std::memory_order_release);
+        }
+        wake(1);
+    }
+
+    // Submit tasks at once, from any thread
+    void submit(const Task* tasks, size_t count) {
+        Worker* worker = currentWorker();
+        if (worker) {
+            for (size_t i = 0; i < count; ++i)
+                worker->deque.push(tasks[i]);
+        } else {
+            std::lock_guard<std::mutex> lock(m_injectLock);
+            m_injected.insert(m_injected.end(), tasks, tasks + count);
+            m_injectedCount.fetch_add(count, std::memory_order_release);
+        }
+        wake(count);
+    }
+
+    // Run one pending task on the calling thread, returns false if none was
+    // found.  Used to help while waiting for tasks.
+    bool runPending() {
+        Task task;
+        if (!findTask(currentWorker(), task))
+            return false;
+        task();
+        return true;
+    }
+
+private:
+    // Worker states, the futex word of parked workers
+    static constexpr uint32_t Running = 0;
+    static constexpr uint32_t Parked = 1;
+
+    struct Worker {
+        details::TaskDeque deque;
+        std::thread thread;
+        const ThreadPool* pool = nullptr;
+        std::atomic<uint32_t> state{Running};
+    };
+
+    static Worker*& ThisWorker() {
+        static thread_local Worker* worker = nullptr;
+        return worker;
+    }
+
+    // The worker of the calling thread if it belongs to this pool
+    Worker* currentWorker() const {
+        Worker* worker = ThisWorker();
+        return (worker && worker->pool == this) ? worker : nullptr;
+    }
+
+    void run(size_t index) {
+        Worker* self = m_workers[index].get();
+        self->pool = this;
+        ThisWorker() = self;
+
+        Task task;
+        while (!m_stop.load(std::memory_order_relaxed)) {
+            if (findTask(self, task)) {
+                task();
+                continue;
+            }
+            park(self);
+        }
+    }
+
+    bool findTask(Worker* self, Task& task) {
+        if (self && self->deque.take(task))
+            return true;
+        if (takeInjected(self, task))
+            return true;
+
+        // Steal, starting from a random victim
+        const size_t n = m_workers.size();
+        const size_t start = randomIndex(n);
+        for (size_t i = 0; i < n; ++i) {
+            Worker* victim = m_workers[(start + i) % n].get();
+            if (victim != self && victim->deque.steal(task))
+                return true;
+        }
+        return false;
+    }
+
+    // Take a task from the shared queue, and a share of the others into the
+    // worker's deque where idle workers can steal them
+    bool takeInjected(Worker* self, Task& task) {
+        if (m_injectedCount.load(std::memory_order_acquire) == 0)
+            return false;
+        std::lock_guard<std::mutex> lock(m_injectLock);
+        const size_t available = m_injected.size() - m_injectedHead;
+        if (available == 0)
+            return false;
+
+        size_t count = 1;
+        if (self)
+            count = std::max<size_t>(1, std::min<size_t>(available / m_workers.size(), MaxInjectedBatch));
+        task = m_injected[m_injectedHead];
+        for (size_t i = 1; i < count; ++i)
+            self->deque.push(m_injected[m_injectedHead + i]);
+        m_injectedHead += count;
+        m_injectedCount.fetch_sub(count, std::memory_order_relaxed);
+        if (m_injectedHead == m_injected.size()) {
+            m_injected.clear();
+            m_injectedHead = 0;
+        }
+        return true;
+    }
+
+    bool hasWork() const {
+        if (m_injectedCount.load(std::memory_order_acquire) != 0)
+            return true;
+        for (const auto& w : m_workers)
+            if (!w->deque.empty())
+                return true;
+        return false;
+    }
+
+    // Sleep until work is submitted.  The worker is counted as a sleeper
+    // before checking for work, and submitters check the count after
+    // publishing work, so one of them sees the other.  A submitter claims a
+    // parked worker by setting it running before waking it, so further
+    // submissions do not wake it again before it was scheduled.
+    void park(Worker* self) {
+        self->state.store(Parked, std::memory_order_seq_cst);
+        m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (hasWork() || m_stop.load(std::memory_order_relaxed)) {
+            // Unpark unless a submitter claimed the worker meanwhile
+            if (self->state.exchange(Running, std::memory_order_seq_cst) == Parked)
+                m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+            return;
+        }
+        while (self->state.load(std::memory_order_acquire) == Parked)
+            details::FutexWait(self->state, Parked);
+    }
+
+    void wake(size_t count) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_sleepers.load(std::memory_order_relaxed) == 0)
+            return;
+        for (auto& w : m_workers) {
+            if (w->state.load(std::memory_order_relaxed) == Parked &&
+                w->state.exchange(Running, std::memory_order_seq_cst) == Parked) {
+                m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+                details::FutexWake(w->state, 1);
+                if (--count == 0)
+                    return;
+            }
+        }
+    }
+
+    static size_t randomIndex(size_t n) {
+        static thread_local std::minstd_rand rng(
+            uint32_t(std::hash<std::thread::id>()(std::this_thread::get_id())));
+        return rng() % n;
+    }
+
+    // Most tasks moved from the shared queue to a worker deque at once
+    static constexpr size_t MaxInjectedBatch = 32;
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    // Tasks submitted from outside the pool
+    std::mutex m_injectLock;
+    std::vector<Task> m_injected;
+    size_t m_injectedHead = 0;
+    std::atomic<size_t> m_injectedCount{0};
+
+    // Parking
+    alignas(details::CacheLineSize) std::atomic<uint32_t> m_sleepers{0};
+    std::atomic<bool> m_stop{false};
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// ParallelFor calls body(chunkBegin, chunkEnd) over [begin, end) split in
+// chunks of at most grain indices, run as tasks of the pool.  The calling
+// thread runs pending tasks until every chunk is done.
+//
+
+inline void ParallelFor(ThreadPool& pool, size_t begin, size_t end, size_t grain,
+                        const Delegate<void(size_t, size_t)>& body) {
+    if (begin >= end)
+        return;
+    if (grain == 0)
+        grain = 1;
+
+    struct Chunk {
+        const Delegate<void(size_t, size_t)>* body;
+        std::atomic<size_t>* remaining;
+        size_t begin;
+        size_t end;
+
+        void run() {
+            (*body)(begin, end);
+            remaining->fetch_sub(1, std::memory_order_release);
+        }
+    };
+
+    const size_t count = (end - begin + grain - 1) / grain;
+    std::atomic<size_t> remaining{count};
+    std::vector<Chunk> chunks(count);
+    std::vector<Task> tasks(count);
+    for (size_t i = 0; i < count; ++i) {
+        const size_t first = begin + i * grain;
+        chunks[i] = { &body, &remaining, first, std::min(end, first + grain) };
+        tasks[i] = MakeDelegate<&Chunk::run>(chunks[i]);
+    }
+    pool.submit(tasks.data(), count);
+
+    while (remaining.load(std::memory_order_acquire) != 0) {
+        if (!pool.runPending())
+            std::this_thread::yield();
+    }
+}
+
+} // end delly namespace
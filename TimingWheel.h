@@ -0,0 +1,241 @@
+#pragma once
+
+#include "Delegate.h"
+#include "SlotMap.h"
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace delly {
+
+// Handle to a scheduled timer, invalid once it fired or was cancelled
+using TimerHandle = SlotHandle;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// TimingWheel calls Delegate<void()> callbacks after a number of ticks.
+//
+// Timers are hashed by expiry into 4 levels of 256 slots, level n spanning
+// 256^n ticks per slot (Varghese and Lauck).  Each tick expires one slot of
+// level 0, and when level 0 wraps around the next slot of level 1 is
+// redistributed to level 0, and so on up.  Scheduling and cancelling are
+// O(1); timers further than 2^32 ticks away wait in the last level and are
+// redistributed until due.
+//
+// Timers are pooled nodes holding the callback and the links of an intrusive
+// circular list, addressed by index so the pool can grow.  Each list has a
+// sentinel node, so unlinking needs no list head.  Handles carry the
+// generation of the node, which changes when the timer fires or is
+// cancelled.
+//
+// Callbacks may schedule and cancel timers, including timers due in the
+// same tick, but must not advance the wheel.
+//
+
+class TimingWheel {
+public:
+    static constexpr uint32_t LevelBits = 8;
+    static constexpr uint32_t SlotsPerLevel = 1 << LevelBits;
+    static constexpr uint32_t Levels = 4;
+
+    explicit TimingWheel(uint64_t now = 0)
+        : m_now(now)
+    {
+        m_nodes.resize(SentinelCount);
+        for (uint32_t i = 0; i < SentinelCount; ++i)
+            m_nodes[i].prev = m_nodes[i].next = i;
+    }
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    inline uint64_t now() const { return m_now; }
+    inline size_t size() const { return m_size; }
+    inline bool empty() const { return m_size == 0; }
+
+    void reserve(size_t timers) { m_nodes.reserve(SentinelCount + timers); }
+
+    // Call the callback once 'delay' ticks have elapsed, at least one
+    TimerHandle schedule(uint64_t delay, const Delegate<void()>& callback) {
+        return scheduleAt(m_now + (delay ? delay : 1), callback);
+    }
+
+    // Call the callback at a tick, or at the next tick if it is past
+    TimerHandle scheduleAt(uint64_t tick, const Delegate<void()>& callback) {
+        assert(!callback.empty());
+        const uint32_t index = allocate();
+        Node& node = m_nodes[index];
+        node.callback = callback;
+        node.expiry = (tick > m_now) ? tick : m_now + 1;
+        insert(index);
+        ++m_size;
+        return { index, node.generation };
+    }
+
+    // Returns false if the timer already fired or was cancelled
+    bool cancel(TimerHandle h) {
+        if (!pending(h))
+            return false;
+        unlink(h.index);
+        release(h.index);
+        --m_size;
+        return true;
+    }
+
+    inline bool pending(TimerHandle h) const {
+        return h.index >= SentinelCount && h.index < m_nodes.size() &&
+               m_nodes[h.index].generation == h.generation;
+    }
+
+    // Tick at which a pending timer fires
+    inline uint64_t expiry(TimerHandle h) const {
+        assert(pending(h));
+        return m_nodes[h.index].expiry;
+    }
+
+    // Advance by a number of ticks, calling the callbacks of the timers
+    // due, in order of ticks.  Returns the number of callbacks called.
+    size_t advance(uint64_t ticks = 1) {
+        size_t calls = 0;
+        for (; ticks; --ticks) {
+            if (m_size == 0) {
+                // Nothing to expire or redistribute
+                m_now += ticks;
+                break;
+            }
+            ++m_now;
+            cascade();
+            calls += expire(ListOf(0, m_now));
+        }
+        return calls;
+    }
+
+    // Advance up to a tick
+    size_t advanceTo(uint64_t tick) {
+        return (tick > m_now) ? advance(tick - m_now) : 0;
+    }
+
+private:
+    static constexpr uint32_t NoNode = ~uint32_t(0);
+
+    // One sentinel per slot, one for the timers being expired, one for the
+    // slot being redistributed
+    static constexpr uint32_t ExpiringList = Levels * SlotsPerLevel;
+    static constexpr uint32_t CascadeList = ExpiringList + 1;
+    static constexpr uint32_t SentinelCount = CascadeList + 1;
+
+    struct Node {
+        Delegate<void()> callback;
+        uint64_t expiry = 0;
+        uint32_t prev = NoNode;
+        uint32_t next = NoNode;     // or next free node
+        uint32_t generation = 1;
+    };
+
+    static inline uint32_t ListOf(uint32_t level, uint64_t tick) {
+        return level * SlotsPerLevel + uint32_t((tick >> (level * LevelBits)) & (SlotsPerLevel - 1));
+    }
+
+    // The slot of a timer, by how far away it is
+    void insert(uint32_t index) {
+        const uint64_t expiry = m_nodes[index].expiry;
+        const uint64_t delta = expiry - m_now;
+        uint32_t level = 0;
+        while (level + 1 < Levels && delta >= (uint64_t(1) << ((level + 1) * LevelBits)))
+            ++level;
+        uint64_t tick = expiry;
+        if (level == Levels - 1 && delta >= (uint64_t(1) << (Levels * LevelBits)))
+            tick = m_now + (uint64_t(1) << (Levels * LevelBits)) - 1;
+        pushBack(ListOf(level, tick), index);
+    }
+
+    void pushBack(uint32_t list, uint32_t index) {
+        Node& node = m_nodes[index];
+        Node& sentinel = m_nodes[list];
+        node.prev = sentinel.prev;
+        node.next = list;
+        m_nodes[sentinel.prev].next = index;
+        sentinel.prev = index;
+    }
+
+    void unlink(uint32_t index) {
+        Node& node = m_nodes[index];
+        m_nodes[node.prev].next = node.next;
+        m_nodes[node.next].prev = node.prev;
+    }
+
+    // Move every node of a list to the empty list 'to'
+    void splice(uint32_t from, uint32_t to) {
+        Node& source = m_nodes[from];
+        if (source.next == from)
+            return;
+        Node& target = m_nodes[to];
+        target.next = source.next;
+        target.prev = source.prev;
+        m_nodes[source.next].prev = to;
+        m_nodes[source.prev].next = to;
+        source.next = source.prev = from;
+    }
+
+    // When a level wraps around, redistribute the current slot of the level
+    // above it
+    void cascade() {
+        for (uint32_t level = 1; level < Levels; ++level) {
+            if (m_now & ((uint64_t(1) << (level * LevelBits)) - 1))
+                break;
+            splice(ListOf(level, m_now), CascadeList);
+            while (m_nodes[CascadeList].next != CascadeList) {
+                const uint32_t index = m_nodes[CascadeList].next;
+                unlink(index);
+                insert(index);
+            }
+        }
+    }
+
+    // Call the callbacks of a slot, which may change the wheel meanwhile
+    size_t expire(uint32_t list) {
+        splice(list, ExpiringList);
+        size_t calls = 0;
+        while (m_nodes[ExpiringList].next != ExpiringList) {
+            const uint32_t index = m_nodes[ExpiringList].next;
+            unlink(index);
+            // Copied out, the callback may grow the pool
+            const Delegate<void()> callback = m_nodes[index].callback;
+            release(index);
+            --m_size;
+            callback();
+            ++calls;
+        }
+        return calls;
+    }
+
+    uint32_t allocate() {
+        if (m_freeNode != NoNode) {
+            const uint32_t index = m_freeNode;
+            m_freeNode = m_nodes[index].next;
+            return index;
+        }
+        m_nodes.emplace_back();
+        return uint32_t(m_nodes.size() - 1);
+    }
+
+    // Invalidate handles to the node and put it on the free list
+    void release(uint32_t index) {
+        Node& node = m_nodes[index];
+        // Generation 0 is reserved for invalid handles
+        if (++node.generation == 0)
+            node.generation = 1;
+        node.callback.reset();
+        node.prev = NoNode;
+        node.next = m_freeNode;
+        m_freeNode = index;
+    }
+
+    std::vector<Node> m_nodes;
+    uint32_t m_freeNode = NoNode;
+    size_t m_size = 0;
+    uint64_t m_now;
+};
+
+} // end delly namespace
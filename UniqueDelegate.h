@@ -0,0 +1,386 @@
+#pragma once
+
+#include "Delegate.h"
+#include "InplaceDelegate.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace delly {
+
+namespace details {
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Size class allocator of the callables UniqueDelegate stores out of line.
+// Blocks are powers of two from 64 to 4096 bytes, carved from slabs which
+// are never released.  Each thread keeps free lists per class, and trades
+// batches of blocks with a shared list when its own runs empty or grows
+// too long, so blocks freed by other threads, such as handlers completed
+// on an I/O thread, are reused.  Larger or over-aligned callables use
+// operator new.
+//
+
+class DelegatePool {
+public:
+    static constexpr size_t MinBlockSize = 64;
+    static constexpr size_t MaxBlockSize = 4096;
+    static constexpr size_t Classes = 7;
+    static constexpr size_t BlockAlignment = 64;
+
+    // Blocks moved at once between a thread and the shared lists
+    static constexpr uint32_t BatchSize = 32;
+    static constexpr uint32_t MaxCached = 2 * BatchSize;
+
+    static constexpr bool Pooled(size_t size, size_t align) {
+        return size <= MaxBlockSize && align <= BlockAlignment;
+    }
+
+    static void* Allocate(size_t size, size_t align) {
+        if (!Pooled(size, align))
+            return ::operator new(size, std::align_val_t(align));
+        const size_t c = ClassOf(size);
+        ThreadCache& cache = t_cache;
+        if (!cache.lists[c])
+            Refill(cache, c);
+        FreeBlock* block = cache.lists[c];
+        cache.lists[c] = block->next;
+        --cache.counts[c];
+        return block;
+    }
+
+    static void Free(void* p, size_t size, size_t align) {
+        if (!Pooled(size, align))
+            return ::operator delete(p, std::align_val_t(align));
+        const size_t c = ClassOf(size);
+        ThreadCache& cache = t_cache;
+        FreeBlock* block = static_cast<FreeBlock*>(p);
+        if (cache.exited) {
+            // Freed during thread exit, after the cache was flushed
+            Shared& shared = GetShared();
+            std::lock_guard<std::mutex> lock(shared.lock);
+            block->next = shared.lists[c];
+            shared.lists[c] = block;
+            return;
+        }
+        if (!cache.registered)
+            Register(cache);
+        block->next = cache.lists[c];
+        cache.lists[c] = block;
+        if (++cache.counts[c] > MaxCached)
+            Release(cache, c, BatchSize);
+    }
+
+    static constexpr size_t ClassOf(size_t size) {
+        size_t c = 0;
+        while ((MinBlockSize << c) < size)
+            ++c;
+        return c;
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    // Trivially destructible, usable until the thread ends
+    struct ThreadCache {
+        FreeBlock* lists[Classes];
+        uint32_t counts[Classes];
+        bool registered;
+        bool exited;
+    };
+
+    // Returns the blocks of a thread when it exits
+    struct CacheFlusher {
+        ~CacheFlusher() {
+            for (size_t c = 0; c < Classes; ++c)
+                Release(t_cache, c, t_cache.counts[c]);
+            t_cache.exited = true;
+        }
+    };
+
+    struct Shared {
+        std::mutex lock;
+        FreeBlock* lists[Classes] = {};
+    };
+
+    // Never destroyed, blocks may be freed during static destruction
+    static Shared& GetShared() {
+        static Shared* shared = new Shared();
+        return *shared;
+    }
+
+    // Flush the cache when the thread exits
+    static void Register(ThreadCache& cache) {
+        static thread_local CacheFlusher flusher;
+        (void)flusher;
+        cache.registered = true;
+    }
+
+    static void Refill(ThreadCache& cache, size_t c) {
+        if (!cache.registered)
+            Register(cache);
+
+        const size_t blockSize = MinBlockSize << c;
+        Shared& shared = GetShared();
+        {
+            std::lock_guard<std::mutex> lock(shared.lock);
+            for (uint32_t i = 0; i < BatchSize && shared.lists[c]; ++i) {
+                FreeBlock* block = shared.lists[c];
+                shared.lists[c] = block->next;
+                block->next = cache.lists[c];
+                cache.lists[c] = block;
+                ++cache.counts[c];
+            }
+        }
+        if (cache.lists[c])
+            return;
+
+        char* slab = static_cast<char*>(::operator new(blockSize * BatchSize, std::align_val_t(BlockAlignment)));
+        for (uint32_t i = BatchSize; i-- > 0; ) {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(slab + i * blockSize);
+            block->next = cache.lists[c];
+            cache.lists[c] = block;
+        }
+        cache.counts[c] += BatchSize;
+    }
+
+    static void Release(ThreadCache& cache, size_t c, uint32_t count) {
+        if (!count)
+            return;
+        FreeBlock* first = cache.lists[c];
+        FreeBlock* last = first;
+        for (uint32_t i = 1; i < count; ++i)
+            last = last->next;
+        cache.lists[c] = last->next;
+        cache.counts[c] -= count;
+
+        Shared& shared = GetShared();
+        std::lock_guard<std::mutex> lock(shared.lock);
+        last->next = shared.lists[c];
+        shared.lists[c] = first;
+    }
+
+    static inline thread_local ThreadCache t_cache = {};
+};
+
+// Operations on callables which cannot be moved as raw bytes
+enum class UniqueOp { Relocate, Destroy };
+
+} // end details namespace
+
+template <typename Signature, size_t InlineBytes = details::InplaceDefaultCapacity>
+class UniqueDelegate;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// UniqueDelegate stores any callable which can be moved, including lambdas
+// owning a buffer or a unique_ptr, such as completion handlers.  It can be
+// moved but not copied.
+//
+// Callables of up to InlineBytes which do not throw when moved are stored
+// inline.  Others are stored in a block of the DelegatePool, and moving the
+// UniqueDelegate moves the pointer to the block.  A Delegate, which owns
+// nothing, is stored inline and needs no destructor.  Invocation is a single
+// call through the stored thunk.
+//
+
+template <typename RetType, typename... Args, size_t InlineBytes>
+class UniqueDelegate<RetType(Args...), InlineBytes> {
+
+    using InvokeFunc = RetType (*) (void*, Args...);
+    using ManageFunc = void (*) (details::UniqueOp, void*, void*);
+
+    template <class F>
+    using EnableCallable = typename std::enable_if<
+        !std::is_same<typename std::decay<F>::type, UniqueDelegate>::value
+        && !std::is_same<typename std::decay<F>::type, Delegate<RetType(Args...)>>::value
+        && std::is_invocable_r<RetType, typename std::decay<F>::type&, Args...>::value>::type;
+
+public:
+    using DelegateType = Delegate<RetType(Args...)>;
+    static constexpr size_t inlineBytes = InlineBytes;
+
+    UniqueDelegate() = default;
+    UniqueDelegate(const std::nullptr_t) noexcept : UniqueDelegate() {}
+
+    UniqueDelegate(const UniqueDelegate&) = delete;
+    UniqueDelegate& operator=(const UniqueDelegate&) = delete;
+
+    UniqueDelegate(UniqueDelegate&& o) noexcept { moveFrom(o); }
+
+    // Copies the delegate as is, an empty Delegate makes an empty
+    // UniqueDelegate
+    UniqueDelegate(const DelegateType& d) noexcept {
+        if (!d.empty()) {
+            ::new (static_cast<void*>(&m_buffer)) DelegateType(d);
+            m_invoke = &Invoke<DelegateType>;
+        }
+    }
+
+    // Any callable which can be moved.  Null function pointers make an
+    // empty UniqueDelegate.
+    template <class F, class = EnableCallable<F>>
+    UniqueDelegate(F&& f) { store(std::forward<F>(f)); }
+
+    ~UniqueDelegate() { destroy(); }
+
+    UniqueDelegate& operator=(UniqueDelegate&& o) noexcept {
+        if (this != &o) {
+            destroy();
+            moveFrom(o);
+        }
+        return *this;
+    }
+
+    UniqueDelegate& operator=(const std::nullptr_t) {
+        reset();
+        return *this;
+    }
+
+    template <class F, class = EnableCallable<F>>
+    UniqueDelegate& operator=(F&& f) {
+        destroy();
+        store(std::forward<F>(f));
+        return *this;
+    }
+
+    // Invoke the stored callable
+    RetType operator() (Args ... args) const {
+        return m_invoke(const_cast<Buffer*>(&m_buffer), std::forward<Args>(args)...);
+    }
+
+    void reset() { destroy(); }
+
+    inline bool empty() const { return !m_invoke; }
+    inline explicit operator bool() const { return !empty(); }
+    inline bool operator!() const { return empty(); }
+
+    inline bool operator==(const std::nullptr_t) const { return empty(); }
+    inline bool operator!=(const std::nullptr_t) const { return !empty(); }
+
+    // Whether a callable is stored inline, or in the DelegatePool
+    template <class F>
+    static constexpr bool StoresInline() {
+        using Fn = typename std::decay<F>::type;
+        return sizeof(Fn) <= InlineBytes && alignof(Fn) <= alignof(Buffer)
+            && std::is_nothrow_move_constructible<Fn>::value;
+    }
+
+private:
+    using Buffer = typename std::aligned_storage<InlineBytes, alignof(std::max_align_t)>::type;
+
+    // Callables without a manage function are trivially copyable and no
+    // larger than a Delegate, a move copies only these bytes
+    static constexpr size_t TrivialBytes = sizeof(DelegateType);
+    static_assert(InlineBytes >= TrivialBytes, "The inline buffer holds at least a Delegate");
+
+    template <class F>
+    void store(F&& f) {
+        using Fn = typename std::decay<F>::type;
+        static_assert(std::is_move_constructible<Fn>::value, "Callable must be move constructible");
+
+        if (IsNull(f))
+            return;
+
+        if constexpr (StoresInline<Fn>()) {
+            ::new (static_cast<void*>(&m_buffer)) Fn(std::forward<F>(f));
+            m_invoke = &Invoke<Fn>;
+            m_manage = std::is_trivially_copyable<Fn>::value && sizeof(Fn) <= TrivialBytes
+                ? nullptr : &ManageInline<Fn>;
+        } else {
+            void* block = details::DelegatePool::Allocate(sizeof(Fn), alignof(Fn));
+            try {
+                ::new (block) Fn(std::forward<F>(f));
+            } catch (...) {
+                details::DelegatePool::Free(block, sizeof(Fn), alignof(Fn));
+                throw;
+            }
+            *reinterpret_cast<void**>(&m_buffer) = block;
+            m_invoke = &InvokePooled<Fn>;
+            m_manage = &ManagePooled<Fn>;
+        }
+    }
+
+    void moveFrom(UniqueDelegate& o) {
+        if (o.m_manage)
+            o.m_manage(details::UniqueOp::Relocate, &m_buffer, &o.m_buffer);
+        else
+            memcpy(&m_buffer, &o.m_buffer, TrivialBytes);
+        m_invoke = o.m_invoke;
+        m_manage = o.m_manage;
+        // The source was relocated, it has nothing left to destroy
+        o.m_invoke = nullptr;
+        o.m_manage = nullptr;
+    }
+
+    void destroy() {
+        if (m_manage)
+            m_manage(details::UniqueOp::Destroy, &m_buffer, nullptr);
+        m_invoke = nullptr;
+        m_manage = nullptr;
+    }
+
+    template <class Fn>
+    static RetType Invoke(void* buffer, Args ... args) {
+        if constexpr (std::is_void<RetType>::value)
+            std::invoke(*static_cast<Fn*>(buffer), std::forward<Args>(args)...);
+        else
+            return std::invoke(*static_cast<Fn*>(buffer), std::forward<Args>(args)...);
+    }
+
+    template <class Fn>
+    static RetType InvokePooled(void* buffer, Args ... args) {
+        return Invoke<Fn>(*static_cast<void**>(buffer), std::forward<Args>(args)...);
+    }
+
+    // Relocate move constructs into dst and destroys src
+    template <class Fn>
+    static void ManageInline(details::UniqueOp op, void* dst, void* src) {
+        switch (op) {
+        case details::UniqueOp::Relocate:
+            ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+            static_cast<Fn*>(src)->~Fn();
+            break;
+        case details::UniqueOp::Destroy:
+            static_cast<Fn*>(dst)->~Fn();
+            break;
+        }
+    }
+
+    template <class Fn>
+    static void ManagePooled(details::UniqueOp op, void* dst, void* src) {
+        switch (op) {
+        case details::UniqueOp::Relocate:
+            *static_cast<void**>(dst) = *static_cast<void**>(src);
+            break;
+        case details::UniqueOp::Destroy: {
+            Fn* f = *static_cast<Fn**>(dst);
+            f->~Fn();
+            details::DelegatePool::Free(f, sizeof(Fn), alignof(Fn));
+            break;
+        }
+        }
+    }
+
+    template <class Fn>
+    static bool IsNull(const Fn& f) {
+        if constexpr (std::is_pointer<Fn>::value || std::is_member_pointer<Fn>::value)
+            return f == nullptr;
+        else
+            return false;
+    }
+
+    Buffer m_buffer;
+    InvokeFunc m_invoke = nullptr;
+    ManageFunc m_manage = nullptr;
+};
+
+} // end delly namespace
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "Delegate.h"
+#include "SlotMap.h"
+
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace delly {
+
+template <typename Signature> class WeakDelegate;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// WeakDelegate calls a method of an object owned by a SlotMap, if the object
+// still exists.  It stores the map, the slot index and generation of the
+// object in place of an object pointer, and checks the generation on every
+// invocation: there is no reference count and no atomic operation.
+//
+// Invoking returns whether the method was called, or for methods returning a
+// value, an optional which is empty once the object was erased.  Methods
+// returning a reference return a pointer instead, null once the object was
+// erased.  The method is bound at compile time:
+//
+//     SlotMap<Timer> timers;
+//     auto h = timers.emplace();
+//     auto d = MakeWeakDelegate<&Timer::OnExpired>(timers, h);
+//     d(now);      // calls timers.get(h)->OnExpired(now)
+//     timers.erase(h);
+//     d(now);      // does nothing, returns false
+//
+// The SlotMap must outlive its weak delegates, which like the map itself
+// are not thread safe.
+//
+
+template <typename RetType, typename... Args>
+class WeakDelegate<RetType(Args...)> {
+
+    using Handle = SlotHandle;
+
+public:
+    using ResultType = typename std::conditional<std::is_void<RetType>::value, bool,
+                       typename std::conditional<std::is_reference<RetType>::value,
+                                                 std::remove_reference_t<RetType>*,
+                                                 std::optional<RetType>>::type>::type;
+
+    WeakDelegate() = default;
+    WeakDelegate(const std::nullptr_t) noexcept : WeakDelegate() {}
+
+    // Bind a method known at compile time to the object of a handle
+    template <auto Method, class T>
+    inline void bind(SlotMap<T>& map, Handle h) {
+        using Traits = details::MethodTraits<decltype(Method)>;
+        static_assert(std::is_same<typename Traits::Signature, RetType(Args...)>::value,
+                      "Method signature must match the delegate");
+        static_assert(std::is_base_of<typename Traits::Class, T>::value,
+                      "Method must belong to the objects of the map");
+        m_map = &map;
+        m_handle = h;
+        m_ops = OpsFor<Method, T>();
+    }
+
+    void reset() { *this = WeakDelegate(); }
+
+    // True once the object was erased, or if nothing is bound
+    inline bool expired() const { return !m_ops || !m_ops->alive(m_map, m_handle); }
+
+    inline bool empty() const { return !m_ops; }
+    inline explicit operator bool() const { return !empty(); }
+    inline bool operator!() const { return empty(); }
+
+    inline Handle handle() const { return m_handle; }
+
+    // Call the method if the object still exists.  Arguments are passed as
+    // by Delegate::operator().
+    template <typename... Params, typename = typename std::enable_if<
+                  std::conjunction<std::is_convertible<Params&&, Args>...>::value>::type>
+    inline ResultType operator() (Params&& ... params) const {
+        return call<details::ParamType<Args>...>(std::forward<Params>(params)...);
+    }
+
+    inline ResultType operator() (details::BracedParamType<Args> ... args) const {
+        return call<details::ParamType<Args>...>(std::forward<details::BracedParamType<Args>>(args)...);
+    }
+
+    bool operator==(const WeakDelegate& o) const {
+        return m_map == o.m_map && m_handle == o.m_handle && m_ops == o.m_ops;
+    }
+    bool operator!=(const WeakDelegate& o) const { return !operator==(o); }
+
+private:
+    template <typename... Params>
+    inline ResultType call(Params ... args) const {
+        if (!m_ops)
+            return ResultType();
+        return m_ops->invoke(m_map, m_handle, std::forward<Params>(args)...);
+    }
+
+    // Per method and object type operations
+    struct Ops {
+        ResultType (*invoke)(void* map, Handle h, details::ParamType<Args>... args);
+        bool (*alive)(const void* map, Handle h);
+    };
+
+    template <auto Method, class T, typename... Params>
+    static ResultType Invoke(void* map, Handle h, Params... args) {
+        T* obj = static_cast<SlotMap<T>*>(map)->get(h);
+        if (!obj)
+            return ResultType();
+        if constexpr (std::is_void<RetType>::value) {
+            (obj->*Method)(std::forward<Params>(args)...);
+            return true;
+        } else if constexpr (std::is_reference<RetType>::value) {
+            return std::addressof((obj->*Method)(std::forward<Params>(args)...));
+        } else {
+            return ResultType((obj->*Method)(std::forward<Params>(args)...));
+        }
+    }
+
+    template <class T>
+    static bool Alive(const void* map, Handle h) {
+        return static_cast<const SlotMap<T>*>(map)->contains(h);
+    }
+
+    // A function, so that Ops is only completed where a method is bound
+    template <auto Method, class T>
+    static const Ops* OpsFor() {
+        static constexpr Ops ops = { &Invoke<Method, T, details::ParamType<Args>...>, &Alive<T> };
+        return &ops;
+    }
+
+    void* m_map = nullptr;
+    Handle m_handle;
+    const Ops* m_ops = nullptr;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Helper function deduces the signature from the method
+//
+
+template <auto Method, class T>
+WeakDelegate<typename details::MethodTraits<decltype(Method)>::Signature>
+MakeWeakDelegate(SlotMap<T>& map, SlotHandle h) {
+    WeakDelegate<typename details::MethodTraits<decltype(Method)>::Signature> d;
+    d.template bind<Method>(map, h);
+    return d;
+}
+
+} // end delly namespace
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Minimal timing helpers shared by the benchmarks.
+
+// Keep a value alive without letting the compiler reason about it
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void ClobberMemory() {
+    asm volatile("" : : : "memory");
+}
+
+// Reference cycles where available, nanoseconds otherwise
+inline uint64_t ReadCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Returns the best cycles per iteration over a number of runs
+template <typename Body>
+double MeasureCycles(size_t iterations, Body&& body, int runs = 7) {
+    double best = 1e300;
+    for (int r = 0; r < runs; ++r) {
+        uint64_t start = ReadCycles();
+        for (size_t i = 0; i < iterations; ++i)
+            body(i);
+        uint64_t stop = ReadCycles();
+        best = std::min(best, double(stop - start) / double(iterations));
+    }
+    return best;
+}
+
+// Results are printed as a table, or as CSV or JSON to track regressions.
+// Select the format with --csv or --json, see BeginReport.
+enum class ReportFormat { Text, Csv, Json };
+
+struct ReportState {
+    ReportFormat format = ReportFormat::Text;
+    size_t count = 0;
+};
+
+inline ReportState& CurrentReport() {
+    static ReportState state;
+    return state;
+}
+
+inline void BeginReport(int argc, char** argv) {
+    ReportState& state = CurrentReport();
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--csv"))
+            state.format = ReportFormat::Csv;
+        else if (!strcmp(argv[i], "--json"))
+            state.format = ReportFormat::Json;
+    }
+    if (state.format == ReportFormat::Csv)
+        printf("name,cycles_per_op\n");
+    else if (state.format == ReportFormat::Json)
+        printf("[");
+}
+
+inline void EndReport() {
+    if (CurrentReport().format == ReportFormat::Json)
+        printf("\n]\n");
+}
+
+// Names must not contain quotes or commas
+inline void Report(const char* name, double cyclesPerOp) {
+    ReportState& state = CurrentReport();
+    switch (state.format) {
+    case ReportFormat::Text:
+        printf("%-48s %8.2f cycles/op\n", name, cyclesPerOp);
+        break;
+    case ReportFormat::Csv:
+        printf("%s,%.3f\n", name, cyclesPerOp);
+        break;
+    case ReportFormat::Json:
+        printf("%s\n  {\"name\": \"%s\", \"cycles_per_op\": %.3f}", state.count ? "," : "", name, cyclesPerOp);
+        break;
+    }
+    ++state.count;
+}
+
+// Free text, only shown in the table format
+inline void Note(const char* text) {
+    if (CurrentReport().format == ReportFormat::Text)
+        printf("%s\n", text);
+}
+
+// Hardware event counter for the calling thread, eg. PERF_COUNT_HW_BRANCH_MISSES.
+// Counters are unavailable outside Linux, in most virtual machines, or when
+// perf_event_paranoid forbids them; valid() is then false.
+class PerfCounter {
+public:
+#if defined(__linux__)
+    explicit PerfCounter(uint64_t config) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        m_fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    ~PerfCounter() {
+        if (m_fd >= 0)
+            close(m_fd);
+    }
+
+    void start() {
+        if (m_fd < 0)
+            return;
+        ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    // Events counted since start()
+    uint64_t stop() {
+        uint64_t count = 0;
+        if (m_fd < 0)
+            return count;
+        ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(m_fd, &count, sizeof(count)) != sizeof(count))
+            count = 0;
+        return count;
+    }
+#else
+    explicit PerfCounter(uint64_t) {}
+    void start() {}
+    uint64_t stop() { return 0; }
+#endif
+
+    PerfCounter(const PerfCounter&) = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
+
+    bool valid() const { return m_fd >= 0; }
+
+private:
+    int m_fd = -1;
+};
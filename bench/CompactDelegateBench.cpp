@@ -0,0 +1,98 @@
+#include "CompactDelegate.h"
+#include "Bench.h"
+
+#include <functional>
+#include <vector>
+
+using namespace delly;
+
+// Arrays of 10M callbacks, one per order: memory used by the array and the
+// cost of invoking every element in turn, for std::function, Delegate and
+// CompactDelegate.  Callbacks are spread over four methods, the orders are
+// in one arena.
+//
+// Usage: CompactDelegateBench [--csv | --json]
+
+#define NOINLINE __attribute__((noinline))
+
+struct Order
+{
+    NOINLINE void OnFill(int quantity) { position += quantity; }
+    NOINLINE void OnPartialFill(int quantity) { position += quantity / 2; }
+    NOINLINE void OnCancel(int quantity) { position -= quantity; }
+    NOINLINE void OnReject(int) { position = 0; }
+
+    long position = 0;
+};
+
+using Callback = Delegate<void(int)>;
+
+static const size_t Count = 10000000;
+
+static Callback CallbackOf(Order& order, size_t i) {
+    switch (i & 3) {
+    case 0: return MakeDelegate(order, &Order::OnFill);
+    case 1: return MakeDelegate(order, &Order::OnPartialFill);
+    case 2: return MakeDelegate(order, &Order::OnCancel);
+    default: return MakeDelegate(order, &Order::OnReject);
+    }
+}
+
+template <class Array>
+static void BenchArray(const char* name, const Array& callbacks) {
+    char line[128];
+    snprintf(line, sizeof(line), "%s: %zu bytes per callback, %.0f MB", name,
+             sizeof(callbacks[0]), double(sizeof(callbacks[0]) * callbacks.size()) / 1e6);
+    Note(line);
+
+    char op[96];
+    snprintf(op, sizeof(op), "invoke/%s", name);
+    Report(op, MeasureCycles(callbacks.size(), [&](size_t i) {
+        callbacks[i](int(i));
+    }, 3));
+}
+
+int main(int argc, char** argv) {
+    BeginReport(argc, argv);
+
+    std::vector<Order> orders(Count);
+    CompactDelegateArena::Register(orders.data());
+
+    {
+        std::vector<std::function<void(int)>> callbacks;
+        callbacks.reserve(Count);
+        for (size_t i = 0; i < Count; ++i) {
+            Order* order = &orders[i];
+            switch (i & 3) {
+            case 0: callbacks.emplace_back([order](int q) { order->OnFill(q); }); break;
+            case 1: callbacks.emplace_back([order](int q) { order->OnPartialFill(q); }); break;
+            case 2: callbacks.emplace_back([order](int q) { order->OnCancel(q); }); break;
+            default: callbacks.emplace_back([order](int q) { order->OnReject(q); }); break;
+            }
+        }
+        BenchArray("std::function", callbacks);
+    }
+
+    std::vector<Callback> delegates(Count);
+    for (size_t i = 0; i < Count; ++i)
+        delegates[i] = CallbackOf(orders[i], i);
+    BenchArray("Delegate", delegates);
+
+    std::vector<CompactDelegate<void(int)>> compact(Count);
+    Report("encode/CompactDelegate", MeasureCycles(Count, [&](size_t i) {
+        compact[i] = CompactDelegate<void(int)>(delegates[i]);
+    }, 1));
+    Report("decode/CompactDelegate", MeasureCycles(Count, [&](size_t i) {
+        DoNotOptimize(compact[i].delegate());
+    }, 3));
+    delegates = std::vector<Callback>();
+    BenchArray("CompactDelegate", compact);
+
+    long total = 0;
+    for (auto& o : orders)
+        total += o.position;
+    DoNotOptimize(total);
+
+    EndReport();
+    return 0;
+}
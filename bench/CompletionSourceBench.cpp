@@ -0,0 +1,136 @@
+#include "CompletionSource.h"
+#include "Bench.h"
+
+#include <coroutine>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+using namespace delly;
+
+// Cost per co_await of a coroutine chaining a million awaits on a callback
+// based event loop: the loop holds one pending completion callback and calls
+// it, which resumes the coroutine, which starts the next operation.
+//
+// The Delegate awaiter against awaiters completing through std::function,
+// once with a capture which fits in the small buffer of std::function and
+// once with a capture of two more words, like a buffer and its size, which
+// does not.  Allocations are counted by replacing operator new.
+
+static size_t g_allocations = 0;
+
+void* operator new(size_t size) {
+    ++g_allocations;
+    if (void* p = malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+static const int Awaits = 1000000;
+
+// Coroutine which starts at once and frees its frame when done
+struct Detached
+{
+    struct promise_type {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// Event loop calling the pending completion until no operation is started
+template <class Callback>
+struct Loop
+{
+    void post(Callback c) { pending = std::move(c); }
+    void run() {
+        for (int i = 0; pending; ++i) {
+            Callback c = std::move(pending);
+            pending = nullptr;
+            c(i);
+        }
+    }
+
+    Callback pending;
+};
+
+using DelegateLoop = Loop<Delegate<void(int)>>;
+using FunctionLoop = Loop<std::function<void(int)>>;
+
+Detached DelegateChain(DelegateLoop& loop, long& sum) {
+    for (int i = 0; i < Awaits; ++i)
+        sum += co_await AwaitDelegate<int>([&loop](Delegate<void(int)> done) { loop.post(done); });
+}
+
+// Resumes through a std::function capturing the awaiter, the handle and
+// Padding extra words
+template <int Padding>
+struct FunctionAwaiter
+{
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+        if constexpr (Padding == 0) {
+            loop->post([this, h](int v) {
+                value = v;
+                h.resume();
+            });
+        } else {
+            size_t extra[Padding] = {};
+            loop->post([this, h, extra](int v) {
+                value = v + int(extra[0]);
+                h.resume();
+            });
+        }
+    }
+    int await_resume() const { return value; }
+
+    FunctionLoop* loop;
+    int value = 0;
+};
+
+template <int Padding>
+Detached FunctionChain(FunctionLoop& loop, long& sum) {
+    for (int i = 0; i < Awaits; ++i)
+        sum += co_await FunctionAwaiter<Padding>{ &loop };
+}
+
+template <class LoopType, class Start>
+static void BenchChain(const char* name, Start start) {
+    size_t allocations = 0;
+    double cycles = MeasureCycles(1, [&](size_t) {
+        LoopType loop;
+        long sum = 0;
+        const size_t before = g_allocations;
+        start(loop, sum);
+        loop.run();
+        allocations = g_allocations - before;
+        DoNotOptimize(sum);
+    }) / Awaits;
+    Report(name, cycles);
+
+    char note[128];
+    snprintf(note, sizeof(note), "    %.2f allocations per await", double(allocations) / Awaits);
+    Note(note);
+}
+
+int main(int argc, char** argv) {
+    BeginReport(argc, argv);
+
+    BenchChain<DelegateLoop>("await/Delegate", [](DelegateLoop& loop, long& sum) {
+        DelegateChain(loop, sum);
+    });
+    BenchChain<FunctionLoop>("await/std::function small capture", [](FunctionLoop& loop, long& sum) {
+        FunctionChain<0>(loop, sum);
+    });
+    BenchChain<FunctionLoop>("await/std::function 4 word capture", [](FunctionLoop& loop, long& sum) {
+        FunctionChain<2>(loop, sum);
+    });
+
+    EndReport();
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "ConcurrentMulticastDelegate.h"
+#include "Bench.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace delly;
+
+// Dispatch throughput of ConcurrentMulticastDelegate against a mutex guarded
+// vector of Delegates, from 1 to N publishing threads.  A background thread
+// subscribes and unsubscribes continuously while events are published.
+
+struct Subscriber
+{
+    void OnEvent(int value) { total += value; }
+
+    long total = 0;
+    char padding[56];
+};
+
+using EventDelegate = Delegate<void(int)>;
+
+class MutexMulticast {
+public:
+    void add(const EventDelegate& d) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_delegates.push_back(d);
+    }
+
+    void remove(const EventDelegate& d) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        for (size_t i = 0; i < m_delegates.size(); ++i) {
+            if (m_delegates[i] == d) {
+                m_delegates.erase(m_delegates.begin() + i);
+                return;
+            }
+        }
+    }
+
+    void operator() (int value) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        for (const auto& d : m_delegates)
+            d(value);
+    }
+
+private:
+    std::mutex m_lock;
+    std::vector<EventDelegate> m_delegates;
+};
+
+static const size_t SubscriberCount = 16;
+static const auto Duration = std::chrono::milliseconds(300);
+
+// Returns total events published per second
+template <class Multicast>
+static double Run(Multicast& multicast, unsigned threads) {
+    // Each publisher has its own subscribers so counters are not shared
+    std::vector<std::vector<Subscriber>> subscribers(threads, std::vector<Subscriber>(SubscriberCount));
+    for (auto& group : subscribers)
+        for (auto& s : group)
+            multicast.add(MakeDelegate(s, &Subscriber::OnEvent));
+
+    Subscriber churn;
+    std::atomic<bool> stop{false};
+    std::atomic<long> events{0};
+
+    std::thread writer([&]() {
+        while (!stop.load(std::memory_order_relaxed)) {
+            multicast.add(MakeDelegate(churn, &Subscriber::OnEvent));
+            multicast.remove(MakeDelegate(churn, &Subscriber::OnEvent));
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+
+    std::vector<std::thread> publishers;
+    for (unsigned t = 0; t < threads; ++t) {
+        publishers.emplace_back([&]() {
+            long n = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                multicast(1);
+                ++n;
+            }
+            events.fetch_add(n);
+        });
+    }
+
+    std::this_thread::sleep_for(Duration);
+    stop = true;
+    for (auto& p : publishers)
+        p.join();
+    writer.join();
+
+    for (auto& group : subscribers)
+        for (auto& s : group)
+            multicast.remove(MakeDelegate(s, &Subscriber::OnEvent));
+
+    return double(events.load()) / std::chrono::duration<double>(Duration).count();
+}
+
+int main() {
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Powers of two up to the number of cores
+    std::vector<unsigned> counts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+        counts.push_back(threads);
+    counts.push_back(maxThreads);
+
+    printf("%-10s %22s %22s\n", "threads", "mutex events/s", "concurrent events/s");
+    for (unsigned threads : counts) {
+        MutexMulticast locked;
+        double lockedRate = Run(locked, threads);
+
+        ConcurrentMulticastDelegate<void(int)> concurrent;
+        double concurrentRate = Run(concurrent, threads);
+
+        printf("%-10u %22.0f %22.0f\n", threads, lockedRate, concurrentRate);
+    }
+    return 0;
+}
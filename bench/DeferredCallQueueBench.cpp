@@ -0,0 +1,107 @@
+#include "DeferredCallQueue.h"
+#include "Bench.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace delly;
+
+// Throughput of handing calls from 1 to N producer threads to one consumer
+// thread: DeferredCallQueue against a mutex guarded deque of std::function.
+
+struct EventLoop
+{
+    void OnEvent(int producer, int value) { total += producer + value; }
+
+    long total = 0;
+};
+
+class MutexQueue {
+public:
+    void push(std::function<void()> f) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_calls.push_back(std::move(f));
+    }
+
+    size_t drain() {
+        std::deque<std::function<void()>> calls;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            calls.swap(m_calls);
+        }
+        for (auto& f : calls)
+            f();
+        return calls.size();
+    }
+
+private:
+    std::mutex m_lock;
+    std::deque<std::function<void()>> m_calls;
+};
+
+static const int CallsPerProducer = 200000;
+
+// Returns calls per second from producing the first call to consuming the last
+template <class Push, class Drain>
+static double Run(unsigned producers, Push&& push, Drain&& drain) {
+    const long total = long(producers) * CallsPerProducer;
+    std::atomic<bool> start{false};
+    std::vector<std::thread> threads;
+    for (unsigned p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            while (!start.load())
+                std::this_thread::yield();
+            for (int i = 0; i < CallsPerProducer; ++i)
+                push(int(p), i);
+        });
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start = true;
+    long consumed = 0;
+    while (consumed < total) {
+        size_t n = drain();
+        if (!n)
+            std::this_thread::yield();
+        consumed += long(n);
+    }
+    auto end = std::chrono::steady_clock::now();
+    for (auto& t : threads)
+        t.join();
+    return double(total) / std::chrono::duration<double>(end - begin).count();
+}
+
+int main() {
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Powers of two up to the number of cores
+    std::vector<unsigned> counts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+        counts.push_back(threads);
+    counts.push_back(maxThreads);
+
+    printf("%-10s %22s %22s\n", "producers", "mutex calls/s", "queue calls/s");
+    for (unsigned producers : counts) {
+        EventLoop loop;
+
+        MutexQueue locked;
+        double lockedRate = Run(producers,
+            [&](int p, int v) { locked.push([&loop, p, v]() { loop.OnEvent(p, v); }); },
+            [&]() { return locked.drain(); });
+
+        DeferredCallQueue queue(1 << 16);
+        auto onEvent = MakeDelegate(loop, &EventLoop::OnEvent);
+        double queueRate = Run(producers,
+            [&](int p, int v) { queue.push(onEvent, p, v); },
+            [&]() { return queue.drain(); });
+
+        printf("%-10u %22.0f %22.0f\n", producers, lockedRate, queueRate);
+        DoNotOptimize(loop.total);
+    }
+    return 0;
+}
@@ -0,0 +1,208 @@
+#include "Delegate.h"
+#include "Bench.h"
+
+#include <functional>
+
+using namespace delly;
+
+// Cost of binding, copying, comparing and invoking a Delegate for every kind
+// of target, against a raw function pointer, a virtual call, std::function
+// and a lambda passed as a template parameter.
+//
+// Usage: DelegateBench [--csv | --json]
+//
+// Targets are not inlined so each invocation is a call plus a trivial body.
+// DoNotOptimize on the callable before each use keeps the compiler from
+// devirtualizing or hoisting it out of the loop.
+
+#define NOINLINE __attribute__((noinline))
+
+static int g_sink = 0;
+
+NOINLINE int FreeFunction(int value) { return g_sink += value; }
+
+struct Base
+{
+    virtual ~Base() = default;
+    NOINLINE int NonVirtual(int value) { return total += value; }
+    NOINLINE virtual int Virtual(int value) { return total += value; }
+
+    int total = 0;
+};
+
+struct Derived : public Base
+{
+    NOINLINE int Virtual(int value) override { return total -= value; }
+};
+
+// Multiple inheritance: binding Base methods to a Multiple adjusts 'this'
+// to the Base subobject, and calling the override through the Base vtable
+// goes through a thunk which adjusts it back
+struct Other
+{
+    virtual ~Other() = default;
+    long other = 0;
+};
+
+struct Multiple : public Other, public Base
+{
+    NOINLINE int Virtual(int value) override { return total ^= value; }
+};
+
+// Virtual inheritance: binding finds the Base subobject through the vtable,
+// and the override is called through a virtual thunk which reads its
+// adjustment back from the vtable
+struct VirtualLeft : public virtual Base { long left = 0; };
+struct VirtualRight : public virtual Base { long right = 0; };
+struct Diamond : public VirtualLeft, public VirtualRight
+{
+    NOINLINE int Virtual(int value) override { return total += 2 * value; }
+};
+
+using IntDelegate = Delegate<int(int)>;
+using IntFunction = std::function<int(int)>;
+
+static const size_t Iterations = 20000000;
+
+static void ReportOp(const char* op, const char* target, double cycles) {
+    char name[96];
+    snprintf(name, sizeof(name), "%s/%s", op, target);
+    Report(name, cycles);
+}
+
+template <class Callable>
+static void BenchInvoke(const char* target, Callable callable) {
+    ReportOp("invoke", target, MeasureCycles(Iterations, [&](size_t i) {
+        DoNotOptimize(callable);
+        DoNotOptimize(callable(int(i)));
+    }));
+}
+
+template <class Func>
+static NOINLINE void InvokeTemplate(Func&& f, size_t i) {
+    DoNotOptimize(f(int(i)));
+}
+
+// Binding from a target which the compiler cannot see through
+template <class Make>
+static void BenchBind(const char* target, Make make) {
+    ReportOp("bind", target, MeasureCycles(Iterations, [&](size_t) {
+        auto callable = make();
+        DoNotOptimize(callable);
+    }));
+}
+
+template <class Callable>
+static void BenchCopy(const char* target, const Callable& callable) {
+    ReportOp("copy", target, MeasureCycles(Iterations, [&](size_t) {
+        DoNotOptimize(callable);
+        Callable copy(callable);
+        DoNotOptimize(copy);
+    }));
+}
+
+template <class Callable>
+static void BenchCompare(const char* target, const Callable& a, const Callable& b) {
+    ReportOp("compare", target, MeasureCycles(Iterations, [&](size_t) {
+        DoNotOptimize(a);
+        DoNotOptimize(b);
+        DoNotOptimize(a == b);
+    }));
+}
+
+int main(int argc, char** argv) {
+    BeginReport(argc, argv);
+
+    Derived derived;
+    Multiple multiple;
+    Diamond diamond;
+    Base* pderived = &derived;
+
+    // Baselines
+    {
+        int (*func)(int) = &FreeFunction;
+        BenchInvoke("function pointer", func);
+        BenchInvoke("virtual call", [pderived](int v) {
+            Base* p = pderived;
+            DoNotOptimize(p);
+            return p->Virtual(v);
+        });
+        ReportOp("invoke", "lambda template", MeasureCycles(Iterations, [&](size_t i) {
+            InvokeTemplate([](int v) { return FreeFunction(v); }, i);
+        }));
+        BenchInvoke("std::function free function", IntFunction(&FreeFunction));
+        BenchInvoke("std::function virtual member", IntFunction([pderived](int v) { return pderived->Virtual(v); }));
+    }
+
+    // Delegate for each kind of binding
+    IntDelegate dfree(&FreeFunction);
+    IntDelegate dmember(pderived, &Base::NonVirtual);
+    IntDelegate dvirtual(pderived, &Base::Virtual);
+    IntDelegate dmultiple(&multiple, &Base::Virtual);
+    IntDelegate ddiamond(&diamond, &Base::Virtual);
+    IntDelegate dresolved = MakeResolvedDelegate(pderived, &Base::Virtual);
+    IntDelegate dcompile = MakeDelegate<&Base::Virtual>(pderived);
+
+    BenchInvoke("Delegate free function", dfree);
+    BenchInvoke("Delegate member", dmember);
+    BenchInvoke("Delegate virtual member", dvirtual);
+    BenchInvoke("Delegate multiple inheritance", dmultiple);
+    BenchInvoke("Delegate virtual inheritance", ddiamond);
+    BenchInvoke("Delegate bindResolved", dresolved);
+    BenchInvoke("Delegate compile time method", dcompile);
+
+    // Bind
+    BenchBind("function pointer", [&]() {
+        int (*func)(int) = &FreeFunction;
+        DoNotOptimize(func);
+        return func;
+    });
+    BenchBind("std::function member", [&]() {
+        Base* p = pderived;
+        DoNotOptimize(p);
+        return IntFunction([p](int v) { return p->Virtual(v); });
+    });
+    BenchBind("Delegate free function", [&]() {
+        int (*func)(int) = &FreeFunction;
+        DoNotOptimize(func);
+        return IntDelegate(func);
+    });
+    BenchBind("Delegate member", [&]() {
+        Base* p = pderived;
+        DoNotOptimize(p);
+        return IntDelegate(p, &Base::NonVirtual);
+    });
+    BenchBind("Delegate virtual member", [&]() {
+        Base* p = pderived;
+        DoNotOptimize(p);
+        return IntDelegate(p, &Base::Virtual);
+    });
+    BenchBind("Delegate multiple inheritance", [&]() {
+        Multiple* p = &multiple;
+        DoNotOptimize(p);
+        return IntDelegate(p, &Base::Virtual);
+    });
+    BenchBind("Delegate virtual inheritance", [&]() {
+        Diamond* p = &diamond;
+        DoNotOptimize(p);
+        return IntDelegate(p, &Base::Virtual);
+    });
+    BenchBind("Delegate bindResolved", [&]() {
+        Base* p = pderived;
+        DoNotOptimize(p);
+        return MakeResolvedDelegate(p, &Base::Virtual);
+    });
+
+    // Copy
+    BenchCopy("function pointer", &FreeFunction);
+    BenchCopy("std::function member", IntFunction([pderived](int v) { return pderived->Virtual(v); }));
+    BenchCopy("Delegate", dvirtual);
+
+    // Compare
+    BenchCompare("function pointer", &FreeFunction, &FreeFunction);
+    BenchCompare("Delegate member", dmember, IntDelegate(pderived, &Base::NonVirtual));
+    BenchCompare("Delegate different members", dmember, dvirtual);
+
+    EndReport();
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include "DelegateFlatSet.h"
+#include "Bench.h"
+
+#include <random>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+using namespace delly;
+
+// Membership tests against about a million registered delegates, comparing
+// DelegateFlatSet with std::set and std::unordered_set.  Half of the queries
+// hit and half miss, in random order so every lookup is a cold access.
+
+struct Handler
+{
+    void OnEvent(int) {}
+    char padding[8];
+};
+
+using EventDelegate = Delegate<void(int)>;
+
+static const size_t Entries = 1 << 20;
+static const size_t Queries = 1 << 22;
+
+template <class Contains>
+static double Measure(const std::vector<EventDelegate>& queries, Contains&& contains) {
+    size_t found = 0;
+    double cycles = MeasureCycles(queries.size(), [&](size_t i) {
+        found += contains(queries[i]);
+    }, 3);
+    DoNotOptimize(found);
+    return cycles;
+}
+
+int main() {
+    std::vector<Handler> handlers(2 * Entries);
+
+    DelegateFlatSet flat;
+    std::set<EventDelegate> tree;
+    std::unordered_set<EventDelegate> hashed;
+    for (size_t i = 0; i < Entries; ++i) {
+        EventDelegate d = MakeDelegate(handlers[2 * i], &Handler::OnEvent);
+        flat.insert(d);
+        tree.insert(d);
+        hashed.insert(d);
+    }
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> pick(0, handlers.size() - 1);
+    std::vector<EventDelegate> queries;
+    queries.reserve(Queries);
+    for (size_t i = 0; i < Queries; ++i)
+        queries.push_back(MakeDelegate(handlers[pick(rng)], &Handler::OnEvent));
+
+    printf("Cycles per lookup, %zu entries\n", Entries);
+    Report("std::set", Measure(queries, [&](const EventDelegate& d) { return tree.count(d); }));
+    Report("std::unordered_set", Measure(queries, [&](const EventDelegate& d) { return hashed.count(d); }));
+    Report("DelegateFlatSet", Measure(queries, [&](const EventDelegate& d) { return size_t(flat.contains(d)); }));
+    return 0;
+}
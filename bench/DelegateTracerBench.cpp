@@ -0,0 +1,53 @@
+// Built with DELEGATE_TRACING set to 1
+#include "Delegate.h"
+#include "Bench.h"
+
+#include <cstdlib>
+#include <string>
+
+using namespace delly;
+
+// Cost of a call through a delegate compiled with DELEGATE_TRACING: while
+// tracing is stopped, started for other targets, and recording the call to
+// the trace file of the thread.  DelegateBench has the cost of the same
+// calls without tracing.
+//
+// Usage: DelegateTracerBench [--csv | --json]
+
+#define NOINLINE __attribute__((noinline))
+
+static const size_t Calls = 1000000;
+
+struct Counter
+{
+    NOINLINE void OnTick(int n) { total += n; }
+    NOINLINE void OnOther(int n) { total -= n; }
+
+    long total = 0;
+};
+
+int main(int argc, char** argv) {
+    BeginReport(argc, argv);
+
+    Counter c;
+    const Delegate<void(int)> tick = MakeDelegate<&Counter::OnTick>(c);
+    const Delegate<void(int)> other = MakeDelegate<&Counter::OnOther>(c);
+
+    Report("call/tracing stopped", MeasureCycles(Calls, [&](size_t i) { tick(int(i)); }));
+
+    char path[] = "/tmp/delegate-traces-XXXXXX";
+    const std::string directory = mkdtemp(path);
+    DelegateTracer::Select(other);
+    DelegateTracer::Start(directory);
+    Report("call/target not selected", MeasureCycles(Calls, [&](size_t i) { tick(int(i)); }));
+    Report("call/recorded", MeasureCycles(Calls, [&](size_t i) { other(int(i)); }));
+    DelegateTracer::Stop();
+    DoNotOptimize(c.total);
+
+    for (const auto& file : DelegateTracer::Files())
+        unlink(file.c_str());
+    rmdir(directory.c_str());
+
+    EndReport();
+    return 0;
+}
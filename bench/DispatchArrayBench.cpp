@@ -0,0 +1,169 @@
+#include "DispatchArray.h"
+#include "Bench.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace delly;
+
+// A bytecode interpreter running 1M opcodes, random or repeating in a short
+// cycle the branch predictor learns, each handled by a method
+// returning the next opcode.  Compares dispatching through a switch, through
+// virtual state objects indexed by opcode, and through a DispatchArray:
+// bound to the machine, calling each handler and with the threaded run(),
+// and with handlers receiving the machine as argument.  Handlers are not
+// inlined, as in a switch calling member functions.  Built with NDEBUG,
+// like every bench.
+//
+// Usage: DispatchArrayBench [--csv | --json]
+
+#define NOINLINE __attribute__((noinline))
+
+enum class Op : uint8_t { Add, Sub, Xor, Shl, Mul, Neg, Inc, Dec, Halt, Count };
+
+struct Machine
+{
+    NOINLINE Op onAdd() { acc += 3; return code[++pc]; }
+    NOINLINE Op onSub() { acc -= 5; return code[++pc]; }
+    NOINLINE Op onXor() { acc ^= 0x55; return code[++pc]; }
+    NOINLINE Op onShl() { acc <<= 1; return code[++pc]; }
+    NOINLINE Op onMul() { acc *= 7; return code[++pc]; }
+    NOINLINE Op onNeg() { acc = -acc; return code[++pc]; }
+    NOINLINE Op onInc() { ++acc; return code[++pc]; }
+    NOINLINE Op onDec() { --acc; return code[++pc]; }
+
+    void start(const std::vector<Op>& program) {
+        code = program.data();
+        pc = 0;
+    }
+
+    const Op* code = nullptr;
+    size_t pc = 0;
+    uint64_t acc = 0;
+};
+
+static NOINLINE void RunSwitch(Machine& m) {
+    Op op = m.code[0];
+    while (op != Op::Halt) {
+        switch (op) {
+        case Op::Add: op = m.onAdd(); break;
+        case Op::Sub: op = m.onSub(); break;
+        case Op::Xor: op = m.onXor(); break;
+        case Op::Shl: op = m.onShl(); break;
+        case Op::Mul: op = m.onMul(); break;
+        case Op::Neg: op = m.onNeg(); break;
+        case Op::Inc: op = m.onInc(); break;
+        case Op::Dec: op = m.onDec(); break;
+        default: return;
+        }
+    }
+}
+
+// Virtual state pattern: one object per opcode
+struct OpState
+{
+    virtual ~OpState() = default;
+    virtual Op execute(Machine& m) const = 0;
+};
+
+template <Op (Machine::*Method)()>
+struct MethodState : public OpState
+{
+    Op execute(Machine& m) const override { return (m.*Method)(); }
+};
+
+static NOINLINE void RunVirtual(Machine& m, const OpState* const* states) {
+    Op op = m.code[0];
+    while (op != Op::Halt)
+        op = states[size_t(op)]->execute(m);
+}
+
+using Handlers = DispatchArray<Op, Op()>;
+
+static NOINLINE void RunDispatch(Machine& m, const Handlers& handlers) {
+    Op op = m.code[0];
+    while (op != Op::Halt)
+        op = handlers(op);
+}
+
+static NOINLINE void RunThreaded(Machine& m, const Handlers& handlers) {
+    handlers.run(m.code[0], Op::Halt);
+}
+
+using UnboundHandlers = DispatchArray<Op, Op(Machine&)>;
+
+static NOINLINE void RunUnbound(Machine& m, const UnboundHandlers& handlers) {
+    handlers.run(m.code[0], Op::Halt, m);
+}
+
+static const size_t ProgramSize = 1000000;
+
+int main(int argc, char** argv) {
+    BeginReport(argc, argv);
+
+    std::mt19937 random(42);
+    std::vector<Op> randomProgram(ProgramSize), cyclicProgram(ProgramSize);
+    for (size_t i = 0; i < ProgramSize; ++i) {
+        randomProgram[i] = Op(random() % size_t(Op::Halt));
+        cyclicProgram[i] = Op(i % size_t(Op::Halt));
+    }
+    randomProgram.push_back(Op::Halt);
+    cyclicProgram.push_back(Op::Halt);
+
+    Machine m;
+    std::unique_ptr<OpState> states[] = {
+        std::make_unique<MethodState<&Machine::onAdd>>(),
+        std::make_unique<MethodState<&Machine::onSub>>(),
+        std::make_unique<MethodState<&Machine::onXor>>(),
+        std::make_unique<MethodState<&Machine::onShl>>(),
+        std::make_unique<MethodState<&Machine::onMul>>(),
+        std::make_unique<MethodState<&Machine::onNeg>>(),
+        std::make_unique<MethodState<&Machine::onInc>>(),
+        std::make_unique<MethodState<&Machine::onDec>>(),
+    };
+    const OpState* statePointers[size_t(Op::Halt)];
+    for (size_t i = 0; i < size_t(Op::Halt); ++i)
+        statePointers[i] = states[i].get();
+
+    const Handlers handlers = Handlers::FromMethods<&Machine::onAdd, &Machine::onSub, &Machine::onXor,
+        &Machine::onShl, &Machine::onMul, &Machine::onNeg, &Machine::onInc, &Machine::onDec>(m);
+    constexpr UnboundHandlers unbound = UnboundHandlers::FromMethods<&Machine::onAdd, &Machine::onSub,
+        &Machine::onXor, &Machine::onShl, &Machine::onMul, &Machine::onNeg, &Machine::onInc, &Machine::onDec>();
+
+    // Each run interprets the whole program
+    for (const auto* program : { &randomProgram, &cyclicProgram }) {
+        const char* kind = (program == &randomProgram) ? "random" : "cyclic";
+        char name[96];
+        snprintf(name, sizeof(name), "%s/switch", kind);
+        Report(name, MeasureCycles(1, [&](size_t) {
+            m.start(*program);
+            RunSwitch(m);
+        }) / ProgramSize);
+        snprintf(name, sizeof(name), "%s/virtual state", kind);
+        Report(name, MeasureCycles(1, [&](size_t) {
+            m.start(*program);
+            RunVirtual(m, statePointers);
+        }) / ProgramSize);
+        snprintf(name, sizeof(name), "%s/DispatchArray", kind);
+        Report(name, MeasureCycles(1, [&](size_t) {
+            m.start(*program);
+            RunDispatch(m, handlers);
+        }) / ProgramSize);
+        snprintf(name, sizeof(name), "%s/DispatchArray run", kind);
+        Report(name, MeasureCycles(1, [&](size_t) {
+            m.start(*program);
+            RunThreaded(m, handlers);
+        }) / ProgramSize);
+        snprintf(name, sizeof(name), "%s/DispatchArray run, machine argument", kind);
+        Report(name, MeasureCycles(1, [&](size_t) {
+            m.start(*program);
+            RunUnbound(m, unbound);
+        }) / ProgramSize);
+    }
+
+    DoNotOptimize(m.acc);
+
+    EndReport();
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "DispatchTable.h"
+#include "Bench.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace delly;
+
+// Invokes 4096 delegates spread over 32 different methods, registered in
+// random order, from a vector of Delegates and from a DispatchTable.
+// Reports cycles and branch mispredictions per call; mispredictions need
+// hardware counters, see PerfCounter.
+
+struct HandlerBase
+{
+    virtual ~HandlerBase() = default;
+    virtual Delegate<void(int)> MakeHandler() = 0;
+
+    long total = 0;
+};
+
+template <int N>
+struct Handler : public HandlerBase
+{
+    void OnEvent(int value) { total += value * N; }
+    Delegate<void(int)> MakeHandler() override { return MakeDelegate(this, &Handler::OnEvent); }
+};
+
+template <int... N>
+static void MakeHandlers(std::vector<std::unique_ptr<HandlerBase>>& handlers, std::integer_sequence<int, N...>) {
+    int unused[] = { (handlers.emplace_back(new Handler<N>()), 0)... };
+    (void)unused;
+}
+
+static const size_t Methods = 32;
+static const size_t Delegates = 4096;
+static const size_t Events = 2000;
+
+template <class Invoke>
+static void Measure(const char* name, Invoke&& invoke) {
+    PerfCounter misses(PERF_COUNT_HW_BRANCH_MISSES);
+    misses.start();
+    double cycles = MeasureCycles(Events, [&](size_t i) { invoke(int(i)); }, 1);
+    uint64_t missCount = misses.stop();
+
+    printf("%-32s %8.2f cycles/call", name, cycles / double(Delegates));
+    if (misses.valid())
+        printf(" %8.3f branch misses/call", double(missCount) / double(Events * Delegates));
+    else
+        printf("   branch misses n/a");
+    printf("\n");
+}
+
+int main() {
+    std::vector<std::unique_ptr<HandlerBase>> handlers;
+    for (size_t i = 0; i < Delegates / Methods; ++i)
+        MakeHandlers(handlers, std::make_integer_sequence<int, int(Methods)>());
+    std::shuffle(handlers.begin(), handlers.end(), std::mt19937(42));
+
+    std::vector<Delegate<void(int)>> list;
+    DispatchTable<void(int)> table;
+    for (auto& h : handlers) {
+        list.push_back(h->MakeHandler());
+        table.add(h->MakeHandler());
+    }
+
+    Measure("vector<Delegate>", [&](int value) {
+        for (const auto& d : list)
+            d(value);
+    });
+    Measure("DispatchTable", [&](int value) { table(value); });
+
+    if (!PerfCounter(PERF_COUNT_HW_BRANCH_MISSES).valid())
+        printf("Hardware counters unavailable: no PMU access or perf_event_paranoid too high\n");
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "Delegate.h"
+#include "Bench.h"
+
+#include <vector>
+
+using namespace delly;
+
+// Compares calling one delegate per element of a batch with operator()
+// against invokeEach, which decodes the bound target once for the batch.
+
+struct Message
+{
+    int id;
+    int value;
+};
+
+struct Handler
+{
+    virtual ~Handler() = default;
+
+    void OnMessage(const Message& m) { total += m.value; }
+    virtual void OnVirtualMessage(const Message& m) { total += m.value; }
+
+    long total = 0;
+};
+
+struct DerivedHandler : public Handler
+{
+    void OnVirtualMessage(const Message& m) override { total -= m.value; }
+};
+
+static long g_total = 0;
+static void OnStaticMessage(const Message& m) { g_total += m.value; }
+
+using MessageDelegate = Delegate<void(const Message&)>;
+
+static const size_t BatchSize = 1024;
+static const size_t Batches = 20000;
+
+static void Compare(const char* name, const MessageDelegate& d, const std::vector<Message>& batch) {
+    double loopCycles = MeasureCycles(Batches, [&](size_t) {
+        for (const auto& m : batch)
+            d(m);
+        ClobberMemory();
+    });
+    double eachCycles = MeasureCycles(Batches, [&](size_t) {
+        d.invokeEach(batch);
+        ClobberMemory();
+    });
+
+    char label[64];
+    snprintf(label, sizeof(label), "%s, operator() loop", name);
+    Report(label, loopCycles / double(batch.size()));
+    snprintf(label, sizeof(label), "%s, invokeEach", name);
+    Report(label, eachCycles / double(batch.size()));
+}
+
+int main() {
+    std::vector<Message> batch(BatchSize);
+    for (size_t i = 0; i < batch.size(); ++i)
+        batch[i] = { int(i), int(i % 7) };
+
+    DerivedHandler handler;
+    Handler* base = &handler;
+
+    printf("Cycles per call, batches of %zu\n", BatchSize);
+    Compare("method", MakeDelegate(base, &Handler::OnMessage), batch);
+    Compare("virtual method", MakeDelegate(base, &Handler::OnVirtualMessage), batch);
+    Compare("static function", MakeDelegate(&OnStaticMessage), batch);
+
+    DoNotOptimize(handler.total);
+    DoNotOptimize(g_total);
+    return 0;
+}
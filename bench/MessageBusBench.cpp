@@ -0,0 +1,143 @@
+#include "MessageBus.h"
+#include "Bench.h"
+
+#include <functional>
+#include <random>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace delly;
+
+// 64 message types with 1 to 4 subscribers each, and 1M publishes of types
+// drawn at random, more often from the first types.  Compares MessageBus
+// with a bus looking up a std::vector of std::function by std::type_index
+// on each publish.  Each publish goes through a table of one function per
+// type, the same for both buses; "table only" is its cost alone.
+//
+// Usage: MessageBusBench [--csv | --json]
+
+#define NOINLINE __attribute__((noinline))
+
+static const size_t Types = 64;
+static const size_t Publishes = 1000000;
+
+template <size_t N>
+struct Message
+{
+    int value;
+};
+
+struct Subscriber
+{
+    template <size_t N>
+    NOINLINE void OnMessage(const Message<N>& m) { total += m.value + long(N); }
+
+    long total = 0;
+};
+
+// The current bus
+class TypeMapBus {
+public:
+    template <class T>
+    void subscribe(std::function<void(const T&)> handler) {
+        m_handlers[std::type_index(typeid(T))].push_back([handler](const void* m) {
+            handler(*static_cast<const T*>(m));
+        });
+    }
+
+    template <class T>
+    void publish(const T& message) const {
+        auto it = m_handlers.find(std::type_index(typeid(T)));
+        if (it == m_handlers.end())
+            return;
+        for (const auto& handler : it->second)
+            handler(&message);
+    }
+
+private:
+    std::unordered_map<std::type_index, std::vector<std::function<void(const void*)>>> m_handlers;
+};
+
+template <class Sequence>
+struct BusOf;
+
+template <size_t... N>
+struct BusOf<std::index_sequence<N...>> {
+    using Type = MessageBus<Message<N>...>;
+};
+
+using Bus = BusOf<std::make_index_sequence<Types>>::Type;
+
+using BusPublish = void (*)(const Bus&, int);
+using MapPublish = void (*)(const TypeMapBus&, int);
+using NoPublish = void (*)(long&, int);
+
+template <size_t N>
+NOINLINE void PublishOnBus(const Bus& bus, int value) { bus.publish(Message<N>{ value }); }
+
+template <size_t N>
+NOINLINE void PublishOnMap(const TypeMapBus& bus, int value) { bus.publish(Message<N>{ value }); }
+
+template <size_t N>
+NOINLINE void PublishNothing(long& total, int value) { total += value + long(N); }
+
+// Type N has 1 + N % 4 subscribers
+template <size_t N>
+static void SubscribeType(Bus& bus, TypeMapBus& map, std::vector<Subscriber>& subscribers, size_t& next) {
+    for (size_t i = 0; i < 1 + N % 4; ++i) {
+        Subscriber* s = &subscribers[next++ % subscribers.size()];
+        bus.subscribe<&Subscriber::OnMessage<N>>(*s);
+        map.subscribe<Message<N>>([s](const Message<N>& m) { s->OnMessage(m); });
+    }
+}
+
+template <size_t... N>
+static void Setup(Bus& bus, TypeMapBus& map, std::vector<Subscriber>& subscribers,
+                  BusPublish* busPublish, MapPublish* mapPublish, NoPublish* noPublish,
+                  std::index_sequence<N...>) {
+    size_t next = 0;
+    int unused[] = { (SubscribeType<N>(bus, map, subscribers, next),
+                      busPublish[N] = &PublishOnBus<N>,
+                      mapPublish[N] = &PublishOnMap<N>,
+                      noPublish[N] = &PublishNothing<N>, 0)... };
+    (void)unused;
+}
+
+int main(int argc, char** argv) {
+    BeginReport(argc, argv);
+
+    Bus bus;
+    TypeMapBus map;
+    std::vector<Subscriber> subscribers(256);
+    BusPublish busPublish[Types];
+    MapPublish mapPublish[Types];
+    NoPublish noPublish[Types];
+    Setup(bus, map, subscribers, busPublish, mapPublish, noPublish, std::make_index_sequence<Types>());
+
+    // Mixed workload, the lower types are published most
+    std::mt19937 random(42);
+    std::geometric_distribution<size_t> skew(0.08);
+    std::vector<uint8_t> types(Publishes);
+    for (auto& t : types)
+        t = uint8_t(skew(random) % Types);
+
+    long total = 0;
+    Report("publish/table only", MeasureCycles(Publishes, [&](size_t i) {
+        noPublish[types[i]](total, int(i));
+    }));
+    Report("publish/type_index map of std::function", MeasureCycles(Publishes, [&](size_t i) {
+        mapPublish[types[i]](map, int(i));
+    }));
+    Report("publish/MessageBus", MeasureCycles(Publishes, [&](size_t i) {
+        busPublish[types[i]](bus, int(i));
+    }));
+
+    for (auto& s : subscribers)
+        total += s.total;
+    DoNotOptimize(total);
+
+    EndReport();
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "MulticastDelegate.h"
+#include "Bench.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace delly;
+
+// Compares MulticastDelegate dispatch against a naive vector of Delegates
+// for 10, 1K and 100K subscribers.  Subscribers are separate heap objects
+// bound in random order, like listeners registered over the life of a program.
+
+struct Subscriber
+{
+    void OnEvent(int value) { total += value; }
+
+    long total = 0;
+    char padding[56];
+};
+
+using EventDelegate = Delegate<void(int)>;
+
+static void RunFanOut(size_t subscribers) {
+    std::vector<std::unique_ptr<Subscriber>> objects;
+    for (size_t i = 0; i < subscribers; ++i)
+        objects.emplace_back(new Subscriber());
+    std::shuffle(objects.begin(), objects.end(), std::mt19937(42));
+
+    std::vector<EventDelegate> naive;
+    MulticastDelegate<void(int)> multicast;
+    multicast.reserve(subscribers);
+    for (auto& o : objects) {
+        naive.push_back(MakeDelegate(o.get(), &Subscriber::OnEvent));
+        multicast.add(MakeDelegate(o.get(), &Subscriber::OnEvent));
+    }
+
+    // Keep the total work per measurement roughly constant
+    const size_t events = std::max<size_t>(10, 20000000 / subscribers);
+
+    double naiveCycles = MeasureCycles(events, [&](size_t i) {
+        for (const auto& d : naive)
+            d(int(i));
+    });
+    double multicastCycles = MeasureCycles(events, [&](size_t i) {
+        multicast(int(i));
+    });
+
+    char name[64];
+    snprintf(name, sizeof(name), "%zu subscribers, vector<Delegate>", subscribers);
+    Report(name, naiveCycles / double(subscribers));
+    snprintf(name, sizeof(name), "%zu subscribers, MulticastDelegate", subscribers);
+    Report(name, multicastCycles / double(subscribers));
+}
+
+int main() {
+    printf("Cycles per subscriber call\n");
+    RunFanOut(10);
+    RunFanOut(1000);
+    RunFanOut(100000);
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "Delegate.h"
+#include "Bench.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace delly;
+
+// Compares invoking virtual methods bound with bind() against bindResolved().
+// Late-bound delegates load the vtable on every call, resolved delegates
+// call the final overrider directly.
+
+struct Handler
+{
+    virtual ~Handler() = default;
+    virtual void OnEvent(int value) = 0;
+
+    long total = 0;
+};
+
+template <int N>
+struct ConcreteHandler : public Handler
+{
+    void OnEvent(int value) override { total += value * N; }
+};
+
+using EventDelegate = Delegate<void(int)>;
+
+static double RunDelegates(const std::vector<EventDelegate>& ds, size_t iterations) {
+    const size_t mask = ds.size() - 1;
+    return MeasureCycles(iterations, [&](size_t i) {
+        ds[i & mask](int(i));
+    });
+}
+
+int main() {
+
+    // A single hot handler: the vtable stays in L1
+    {
+        ConcreteHandler<3> h;
+        std::vector<EventDelegate> late = { MakeDelegate(h, &Handler::OnEvent) };
+        std::vector<EventDelegate> resolved = { MakeResolvedDelegate(h, &Handler::OnEvent) };
+
+        const size_t iterations = 10000000;
+        Report("hot handler, bind()", RunDelegates(late, iterations));
+        Report("hot handler, bindResolved()", RunDelegates(resolved, iterations));
+        DoNotOptimize(h.total);
+    }
+
+    // Many handlers scattered in memory: every vtable lookup is a dependent
+    // load on the object that may miss the cache
+    {
+        const size_t count = size_t(1) << 18;
+        std::vector<std::unique_ptr<Handler>> objects;
+        objects.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            switch (i % 4) {
+            case 0: objects.emplace_back(new ConcreteHandler<1>()); break;
+            case 1: objects.emplace_back(new ConcreteHandler<2>()); break;
+            case 2: objects.emplace_back(new ConcreteHandler<3>()); break;
+            default: objects.emplace_back(new ConcreteHandler<4>()); break;
+            }
+        }
+
+        std::vector<EventDelegate> late, resolved;
+        for (auto& o : objects) {
+            late.push_back(MakeDelegate(o.get(), &Handler::OnEvent));
+            resolved.push_back(MakeResolvedDelegate(o.get(), &Handler::OnEvent));
+        }
+
+        // Visit the delegates in random order
+        std::mt19937 rng(42);
+        std::vector<size_t> order(count);
+        for (size_t i = 0; i < count; ++i)
+            order[i] = i;
+        std::shuffle(order.begin(), order.end(), rng);
+        std::vector<EventDelegate> lateShuffled, resolvedShuffled;
+        for (size_t i : order) {
+            lateShuffled.push_back(late[i]);
+            resolvedShuffled.push_back(resolved[i]);
+        }
+
+        const size_t iterations = count * 8;
+        Report("256K handlers, bind()", RunDelegates(lateShuffled, iterations));
+        Report("256K handlers, bindResolved()", RunDelegates(resolvedShuffled, iterations));
+    }
+
+    return 0;
+}
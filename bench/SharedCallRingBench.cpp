@@ -0,0 +1,170 @@
+#include "SharedCallRing.h"
+#include "Bench.h"
+
+#include <cstring>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace delly;
+
+// 1M calls sent to a worker process, from the first call to the worker
+// exiting after the last.  Compares SharedCallRing with the same records
+// written to a pipe in batches of 4 KiB, read and called through the same
+// DelegateRegistry: the difference is the copies and system calls.  "in
+// process" pushes and drains the ring from one thread, the cost of the
+// records alone.
+//
+// Usage: SharedCallRingBench [--csv | --json]
+
+#define NOINLINE __attribute__((noinline))
+
+static const uint64_t Calls = 1000000;
+static const uint32_t WorkerHandle = 1;
+
+struct Order { uint64_t id; int32_t quantity; int32_t price; };
+
+struct Worker
+{
+    NOINLINE void OnOrder(const Order& o) { total += o.quantity * int64_t(o.price); }
+    NOINLINE void OnStop(uint64_t calls) { stopped = calls; }
+
+    int64_t total = 0;
+    uint64_t stopped = 0;
+};
+
+static DelegateRegistry MakeRegistry(Worker& w) {
+    DelegateRegistry registry;
+    registry.add<&Worker::OnOrder>();
+    registry.add<&Worker::OnStop>();
+    registry.setObject(WorkerHandle, w);
+    return registry;
+}
+
+static Order MakeOrder(uint64_t i) {
+    return Order{ i, int32_t(i & 127), int32_t(100 + (i & 15)) };
+}
+
+// The same record as the ring: id, handle, size of the arguments, arguments
+struct PipeRecord {
+    uint32_t id;
+    uint32_t object;
+    uint32_t argsSize;
+    uint32_t unused;
+    std::tuple<Order> args;
+};
+
+static void RunRingWorker(SharedCallRing& ring) {
+    Worker w;
+    const DelegateRegistry registry = MakeRegistry(w);
+    while (!w.stopped) {
+        if (!ring.drain(registry))
+            sched_yield();
+    }
+    _exit(w.stopped == Calls ? 0 : 1);
+}
+
+static void RunPipeWorker(int fd) {
+    Worker w;
+    const DelegateRegistry registry = MakeRegistry(w);
+    alignas(8) char buffer[4096];
+    size_t filled = 0;
+    while (!w.stopped) {
+        const ssize_t n = read(fd, buffer + filled, sizeof(buffer) - filled);
+        if (n <= 0)
+            _exit(1);
+        filled += size_t(n);
+        size_t used = 0;
+        for (; filled - used >= sizeof(PipeRecord); used += sizeof(PipeRecord)) {
+            PipeRecord* r = reinterpret_cast<PipeRecord*>(buffer + used);
+            registry.invoke(r->id, r->object, &r->args, r->argsSize);
+        }
+        memmove(buffer, buffer + used, filled - used);
+        filled -= used;
+    }
+    _exit(w.stopped == Calls ? 0 : 1);
+}
+
+static bool Wait(pid_t child) {
+    int status = 0;
+    return waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static double RingToWorker() {
+    SharedCallRing ring = SharedCallRing::Create(1 << 16);
+    const uint64_t start = ReadCycles();
+    const pid_t child = fork();
+    if (child == 0)
+        RunRingWorker(ring);
+    for (uint64_t i = 0; i < Calls; ++i)
+        ring.push<&Worker::OnOrder>(ObjectHandle{ WorkerHandle }, MakeOrder(i));
+    ring.push<&Worker::OnStop>(ObjectHandle{ WorkerHandle }, Calls);
+    if (!Wait(child))
+        Note("ring worker failed");
+    return double(ReadCycles() - start) / double(Calls);
+}
+
+static double PipeToWorker() {
+    int fds[2];
+    if (pipe(fds) != 0)
+        return 0;
+    const uint64_t start = ReadCycles();
+    const pid_t child = fork();
+    if (child == 0) {
+        close(fds[1]);
+        RunPipeWorker(fds[0]);
+    }
+    close(fds[0]);
+
+    PipeRecord batch[4096 / sizeof(PipeRecord)];
+    size_t count = 0;
+    auto flush = [&] {
+        const char* p = reinterpret_cast<const char*>(batch);
+        size_t left = count * sizeof(PipeRecord);
+        while (left) {
+            const ssize_t n = write(fds[1], p, left);
+            if (n <= 0)
+                return;
+            p += n;
+            left -= size_t(n);
+        }
+        count = 0;
+    };
+    for (uint64_t i = 0; i < Calls; ++i) {
+        batch[count++] = PipeRecord{ DelegateRegistry::IdOf<&Worker::OnOrder>(), WorkerHandle,
+                                     DelegateRegistry::ArgsSizeOf<&Worker::OnOrder>(), 0, { MakeOrder(i) } };
+        if (count == sizeof(batch) / sizeof(batch[0]))
+            flush();
+    }
+    flush();
+    PipeRecord& stop = batch[count++];
+    stop = PipeRecord{ DelegateRegistry::IdOf<&Worker::OnStop>(), WorkerHandle,
+                       DelegateRegistry::ArgsSizeOf<&Worker::OnStop>(), 0, {} };
+    DelegateRegistry::PackArgs<&Worker::OnStop>(&stop.args, Calls);
+    flush();
+    close(fds[1]);
+    if (!Wait(child))
+        Note("pipe worker failed");
+    return double(ReadCycles() - start) / double(Calls);
+}
+
+int main(int argc, char** argv) {
+    BeginReport(argc, argv);
+
+    Worker w;
+    const DelegateRegistry registry = MakeRegistry(w);
+    SharedCallRing ring = SharedCallRing::Create(1 << 16);
+    Report("in process/push and drain", MeasureCycles(Calls, [&](size_t i) {
+        ring.tryPush<&Worker::OnOrder>(ObjectHandle{ WorkerHandle }, MakeOrder(i));
+        if ((i & 255) == 255)
+            ring.drain(registry);
+    }));
+    ring.drain(registry);
+    DoNotOptimize(w.total);
+
+    Report("to a worker/pipe of 4 KiB batches", PipeToWorker());
+    Report("to a worker/SharedCallRing", RingToWorker());
+
+    EndReport();
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include "ThreadPool.h"
+#include "Bench.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace delly;
+
+// Throughput of fine grained tasks, well under a microsecond each, on
+// ThreadPool against a pool of std::function sharing one mutex guarded
+// queue, the usual std::function executor.
+//
+// "submit" queues single tasks from the main thread, "parallel for" splits a
+// range in small chunks which both pools run while the caller helps.
+
+class FunctionPool {
+public:
+    explicit FunctionPool(size_t threads) {
+        for (size_t i = 0; i < threads; ++i)
+            m_threads.emplace_back([this]() { run(); });
+    }
+
+    ~FunctionPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto& t : m_threads)
+            t.join();
+    }
+
+    void submit(std::function<void()> f) {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_tasks.push_back(std::move(f));
+        }
+        m_wake.notify_one();
+    }
+
+    bool runPending() {
+        std::function<void()> f;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_tasks.empty())
+                return false;
+            f = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        f();
+        return true;
+    }
+
+private:
+    void run() {
+        for (;;) {
+            std::function<void()> f;
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_wake.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+                if (m_stop)
+                    return;
+                f = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            f();
+        }
+    }
+
+    std::mutex m_lock;
+    std::condition_variable m_wake;
+    std::deque<std::function<void()>> m_tasks;
+    std::vector<std::thread> m_threads;
+    bool m_stop = false;
+};
+
+static const size_t TaskCount = 1 << 20;
+static const size_t Grain = 16;
+
+// A few dozen nanoseconds of work per index
+static inline uint64_t Work(size_t i) {
+    uint64_t x = i * 0x9E3779B97F4A7C15ull;
+    for (int r = 0; r < 8; ++r)
+        x ^= (x << 13) ^ (x >> 7);
+    return x;
+}
+
+struct Sink
+{
+    void Task() { DoNotOptimize(Work(done.load(std::memory_order_relaxed))); done.fetch_add(1); }
+    void Range(size_t begin, size_t end) {
+        uint64_t x = 0;
+        for (size_t i = begin; i < end; ++i)
+            x += Work(i);
+        DoNotOptimize(x);
+    }
+
+    std::atomic<size_t> done{0};
+};
+
+template <class Body>
+static double TasksPerSecond(size_t tasks, Body&& body) {
+    auto begin = std::chrono::steady_clock::now();
+    body();
+    auto end = std::chrono::steady_clock::now();
+    return double(tasks) / std::chrono::duration<double>(end - begin).count();
+}
+
+template <class Pool>
+static void WaitFor(Pool& pool, const std::atomic<size_t>& done, size_t expected) {
+    while (done.load() != expected) {
+        if (!pool.runPending())
+            std::this_thread::yield();
+    }
+}
+
+int main() {
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Powers of two up to the number of cores
+    std::vector<unsigned> counts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+        counts.push_back(threads);
+    counts.push_back(maxThreads);
+
+    const size_t chunks = TaskCount / Grain;
+    printf("%-8s %20s %20s %20s %20s\n", "threads", "function submit/s", "pool submit/s",
+           "function chunks/s", "pool chunks/s");
+    for (unsigned threads : counts) {
+        double functionSubmit, poolSubmit, functionChunks, poolChunks;
+        {
+            FunctionPool pool(threads);
+            Sink sink;
+            functionSubmit = TasksPerSecond(TaskCount, [&]() {
+                for (size_t i = 0; i < TaskCount; ++i)
+                    pool.submit([&sink]() { sink.Task(); });
+                WaitFor(pool, sink.done, TaskCount);
+            });
+
+            std::atomic<size_t> remaining{0};
+            functionChunks = TasksPerSecond(chunks, [&]() {
+                for (size_t c = 0; c < chunks; ++c) {
+                    pool.submit([&sink, &remaining, c]() {
+                        sink.Range(c * Grain, (c + 1) * Grain);
+                        remaining.fetch_add(1);
+                    });
+                }
+                WaitFor(pool, remaining, chunks);
+            });
+        }
+        {
+            ThreadPool pool(threads);
+            Sink sink;
+            poolSubmit = TasksPerSecond(TaskCount, [&]() {
+                for (size_t i = 0; i < TaskCount; ++i)
+                    pool.submit(MakeDelegate<&Sink::Task>(sink));
+                WaitFor(pool, sink.done, TaskCount);
+            });
+
+            poolChunks = TasksPerSecond(chunks, [&]() {
+                ParallelFor(pool, 0, TaskCount, Grain, MakeDelegate<&Sink::Range>(sink));
+            });
+        }
+        printf("%-8u %20.0f %20.0f %20.0f %20.0f\n", threads, functionSubmit, poolSubmit,
+               functionChunks, poolChunks);
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include "TimingWheel.h"
+#include "Bench.h"
+
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+
+using namespace delly;
+
+// Network timeouts: 1M active timers, each tick starts new ones and cancels
+// most of the others before they expire, as when requests complete in time.
+// Compares TimingWheel with a std::priority_queue of std::function, which
+// cannot remove a cancelled timer and flags it until it reaches the top.
+// Reports cycles per timer started, its cancel or expiry included.
+//
+// Usage: TimingWheelBench [--csv | --json]
+
+#define NOINLINE __attribute__((noinline))
+
+static const size_t Active = 1000000;
+static const uint64_t MinTimeout = 1000;
+static const uint64_t MaxTimeout = 5000;
+static const size_t Ticks = 4000;
+
+struct Connection
+{
+    NOINLINE void OnTimeout() { ++timeouts; }
+
+    long timeouts = 0;
+};
+
+// Timer queue of the current timer subsystem
+class HeapTimers {
+public:
+    using Id = uint64_t;
+
+    Id schedule(uint64_t delay, std::function<void()> callback) {
+        const Id id = m_cancelled.size();
+        m_cancelled.push_back(false);
+        m_heap.push({ m_now + delay, id, std::move(callback) });
+        return id;
+    }
+
+    void cancel(Id id) { m_cancelled[id] = true; }
+
+    void advance() {
+        ++m_now;
+        while (!m_heap.empty() && m_heap.top().expiry <= m_now) {
+            Entry e = std::move(const_cast<Entry&>(m_heap.top()));
+            m_heap.pop();
+            if (!m_cancelled[e.id])
+                e.callback();
+        }
+    }
+
+    size_t queued() const { return m_heap.size(); }
+
+private:
+    struct Entry {
+        uint64_t expiry;
+        Id id;
+        std::function<void()> callback;
+
+        bool operator<(const Entry& o) const { return expiry > o.expiry; }
+    };
+
+    std::priority_queue<Entry> m_heap;
+    std::vector<bool> m_cancelled;
+    uint64_t m_now = 0;
+};
+
+// Keep 'Active' timers running: each timer started is cancelled with a
+// probability, at a random tick before it expires.  Returns the cycles per
+// timer started.
+template <class Handle, typename Start, typename Cancel, typename Advance>
+static double Run(double cancelRate, Start&& start, Cancel&& cancel, Advance&& advance) {
+    std::mt19937_64 random(42);
+    std::uniform_int_distribution<uint64_t> timeout(MinTimeout, MaxTimeout);
+    std::bernoulli_distribution cancelled(cancelRate);
+
+    // Timers to cancel, by tick modulo the longest timeout
+    std::vector<std::vector<Handle>> cancels(MaxTimeout);
+    auto startTimer = [&](size_t tick) {
+        const uint64_t delay = timeout(random);
+        const Handle h = start(delay);
+        if (cancelled(random))
+            cancels[(tick + 1 + random() % (delay - 1)) % MaxTimeout].push_back(h);
+    };
+
+    // Cancelled timers live half their timeout on average
+    const double lifetime = (1 - cancelRate / 2) * double(MinTimeout + MaxTimeout) / 2;
+    const size_t perTick = size_t(double(Active) / lifetime) + 1;
+    for (size_t i = 0; i < Active; ++i)
+        startTimer(0);
+
+    const uint64_t begin = ReadCycles();
+    for (size_t tick = 0; tick < Ticks; ++tick) {
+        std::vector<Handle>& due = cancels[tick % MaxTimeout];
+        for (const Handle& h : due)
+            cancel(h);
+        due.clear();
+        for (size_t i = 0; i < perTick; ++i)
+            startTimer(tick);
+        advance();
+    }
+    return double(ReadCycles() - begin) / double(perTick * Ticks);
+}
+
+int main(int argc, char** argv) {
+    BeginReport(argc, argv);
+
+    std::vector<Connection> connections(Active);
+    for (double cancelRate : { 0.5, 0.9, 0.99 }) {
+        char name[96];
+
+        {
+            HeapTimers timers;
+            size_t n = 0;
+            const double cycles = Run<HeapTimers::Id>(cancelRate,
+                [&](uint64_t delay) {
+                    Connection* c = &connections[n++ % Active];
+                    return timers.schedule(delay, [c] { c->OnTimeout(); });
+                },
+                [&](HeapTimers::Id id) { timers.cancel(id); },
+                [&] { timers.advance(); });
+            snprintf(name, sizeof(name), "cancel %.0f%%/priority_queue<std::function>", cancelRate * 100);
+            Report(name, cycles);
+            snprintf(name, sizeof(name), "priority_queue: %zu entries queued for 1M active timers",
+                     timers.queued());
+            Note(name);
+        }
+
+        {
+            TimingWheel wheel;
+            wheel.reserve(2 * Active);
+            size_t n = 0;
+            const double cycles = Run<TimerHandle>(cancelRate,
+                [&](uint64_t delay) {
+                    return wheel.schedule(delay, MakeDelegate<&Connection::OnTimeout>(connections[n++ % Active]));
+                },
+                [&](TimerHandle h) { wheel.cancel(h); },
+                [&] { wheel.advance(); });
+            snprintf(name, sizeof(name), "cancel %.0f%%/TimingWheel", cancelRate * 100);
+            Report(name, cycles);
+            snprintf(name, sizeof(name), "TimingWheel: %zu timers active", wheel.size());
+            Note(name);
+        }
+    }
+
+    long timeouts = 0;
+    for (auto& c : connections)
+        timeouts += c.timeouts;
+    DoNotOptimize(timeouts);
+
+    EndReport();
+    return 0;
+}
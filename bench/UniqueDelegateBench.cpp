@@ -0,0 +1,133 @@
+#include "UniqueDelegate.h"
+#include "Bench.h"
+
+#include <array>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+
+using namespace delly;
+
+// 10M completion handlers created, invoked and destroyed, with 64 in flight
+// at any time.  Each handler owns a buffer, a unique_ptr handed back when it
+// completes, and a small or large context.  std::function needs handlers
+// it can copy, so it holds them through a shared_ptr.  Handlers converted
+// from a Delegate own nothing.  Allocations are counted by replacing
+// operator new.
+//
+// Usage: UniqueDelegateBench [--csv | --json]
+
+static size_t g_allocations = 0;
+
+void* operator new(size_t size) {
+    ++g_allocations;
+    if (void* p = malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+// The pool takes its slabs from aligned operator new
+void* operator new(size_t size, std::align_val_t align) {
+    ++g_allocations;
+    if (void* p = aligned_alloc(size_t(align), (size + size_t(align) - 1) & ~(size_t(align) - 1)))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { free(p); }
+
+static const size_t Cycles = 10000000;
+static const size_t InFlight = 64;
+
+struct Buffer
+{
+    char data[256];
+};
+
+struct Connection
+{
+    void OnComplete() { ++completed; }
+
+    size_t completed = 0;
+};
+
+template <size_t ContextSize>
+struct Completion
+{
+    void operator()() {
+        *slot = std::move(buffer);
+        *done += context[0] + 1;
+    }
+
+    std::unique_ptr<Buffer>* slot;
+    std::unique_ptr<Buffer> buffer;
+    size_t* done;
+    std::array<char, ContextSize> context;
+};
+
+// Runs Cycles operations, returns cycles per operation
+template <class Handler, class Make>
+static double Run(const char* name, Make&& make) {
+    std::array<Handler, InFlight> pending;
+    size_t allocations = 0;
+    const double cycles = MeasureCycles(Cycles, [&](size_t i) {
+        if (i == 0)
+            allocations = g_allocations;
+        Handler& h = pending[i % InFlight];
+        if (h)
+            h();
+        h = make(i % InFlight);
+    }, 3);
+    allocations = g_allocations - allocations;
+
+    char line[256];
+    snprintf(line, sizeof(line), "%s: %.2f allocations per handler in the last run", name,
+             double(allocations) / double(Cycles));
+    Note(line);
+    Report(name, cycles);
+    return cycles;
+}
+
+template <size_t ContextSize>
+static void BenchOwners(const char* size) {
+    std::array<std::unique_ptr<Buffer>, InFlight> buffers;
+    for (auto& b : buffers)
+        b = std::make_unique<Buffer>();
+    size_t done = 0;
+    using Owner = Completion<ContextSize>;
+
+    char name[96];
+    snprintf(name, sizeof(name), "%s owner/std::function", size);
+    Run<std::function<void()>>(name, [&](size_t k) {
+        auto owner = std::make_shared<Owner>(Owner{ &buffers[k], std::move(buffers[k]), &done, {} });
+        return std::function<void()>([owner] { (*owner)(); });
+    });
+
+    using Handler = UniqueDelegate<void()>;
+    snprintf(name, sizeof(name), "%s owner/UniqueDelegate %s", size,
+             Handler::StoresInline<Owner>() ? "inline" : "pooled");
+    Run<Handler>(name, [&](size_t k) {
+        return Handler(Owner{ &buffers[k], std::move(buffers[k]), &done, {} });
+    });
+    DoNotOptimize(done);
+}
+
+int main(int argc, char** argv) {
+    BeginReport(argc, argv);
+
+    BenchOwners<8>("small");
+    BenchOwners<200>("large");
+
+    Connection c;
+    const Delegate<void()> d = MakeDelegate<&Connection::OnComplete>(c);
+    Run<std::function<void()>>("Delegate/std::function", [&](size_t) { return std::function<void()>(d); });
+    Run<UniqueDelegate<void()>>("Delegate/UniqueDelegate", [&](size_t) { return UniqueDelegate<void()>(d); });
+    DoNotOptimize(c.completed);
+
+    EndReport();
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "WeakDelegate.h"
+#include "Bench.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace delly;
+
+// Deferred callbacks to objects which may have been destroyed: a Delegate
+// paired with a std::weak_ptr, locked before each call, against a
+// WeakDelegate into a SlotMap.  Callbacks run in random order over 10K
+// objects, a quarter of which were destroyed.
+
+struct Connection
+{
+    void OnData(int value) { total += value; }
+
+    long total = 0;
+    char padding[56];
+};
+
+struct WeakCallback
+{
+    std::weak_ptr<Connection> owner;
+    Delegate<void(int)> callback;
+
+    void operator() (int value) const {
+        if (auto locked = owner.lock())
+            callback(value);
+    }
+};
+
+static const size_t Objects = 10000;
+
+int main(int argc, char** argv) {
+    BeginReport(argc, argv);
+
+    std::vector<std::shared_ptr<Connection>> shared;
+    SlotMap<Connection> slots;
+    std::vector<SlotHandle> handles;
+    for (size_t i = 0; i < Objects; ++i) {
+        shared.push_back(std::make_shared<Connection>());
+        handles.push_back(slots.emplace());
+    }
+
+    std::vector<WeakCallback> weakPtrCallbacks;
+    std::vector<WeakDelegate<void(int)>> weakDelegates;
+    for (size_t i = 0; i < Objects; ++i) {
+        weakPtrCallbacks.push_back({ shared[i], MakeDelegate(shared[i].get(), &Connection::OnData) });
+        weakDelegates.push_back(MakeWeakDelegate<&Connection::OnData>(slots, handles[i]));
+    }
+
+    std::mt19937 rng(42);
+    std::vector<uint32_t> order(Objects);
+    for (size_t i = 0; i < Objects; ++i)
+        order[i] = uint32_t(i);
+    std::shuffle(order.begin(), order.end(), rng);
+    for (size_t i = 0; i < Objects / 4; ++i) {
+        shared[order[i]].reset();
+        slots.erase(handles[order[i]]);
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+
+    const size_t iterations = 1000;
+    Report("weak_ptr + Delegate", MeasureCycles(iterations, [&](size_t n) {
+        for (uint32_t i : order)
+            weakPtrCallbacks[i](int(n));
+    }) / double(Objects));
+    Report("WeakDelegate", MeasureCycles(iterations, [&](size_t n) {
+        for (uint32_t i : order)
+            weakDelegates[i](int(n));
+    }) / double(Objects));
+
+    EndReport();
+    return 0;
+}
@@ -31,6 +31,14 @@ int main() {
   d2 = MakeDelegate(b1, &A::GetMyNumber);
   d3 = MakeDelegate(b2, &A::GetMyNumber2);
 
+  // Methods known at compile time are bound through a generated thunk
+  // which calls the method directly, with no member pointer decode.
+  // A::GetMyNumber is inlined into the thunk; B::GetMyNumber2 is virtual, so
+  // its thunk still loads it from the vtable of b2.
+  D d4, d5;
+  d4 = MakeDelegate<&A::GetMyNumber>(b1);
+  d5 = MakeDelegate<&B::GetMyNumber2>(b2);
+
   int x = 1000;
-  return d1(x) + d2(x) + d3(x);
+  return d1(x) + d2(x) + d3(x) + d4(x) + d5(x);
 }
@@ -0,0 +1,139 @@
+#include "gtest/gtest.h"
+
+#include "BoundDelegate.h"
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace delly;
+
+namespace {
+
+struct Server
+{
+    void OnData(uint32_t connection, int value) { received.push_back(int(connection) * 100 + value); }
+    void OnText(uint32_t connection, const uint32_t& channel, std::string text) {
+        texts.push_back(std::to_string(connection) + "/" + std::to_string(channel) + ":" + text);
+    }
+    int Scaled(int factor, int value) const { return factor * value; }
+
+    std::vector<int> received;
+    std::vector<std::string> texts;
+};
+
+// Declared only, when the bound delegate type is
+struct LatePacket;
+struct LateConnection { BoundDelegate<void(LatePacket), uint32_t> onPacket; };
+struct LatePacket { std::vector<int> values; };
+
+struct PacketSink
+{
+    void OnPacket(uint32_t connection, LatePacket p) { total += connection * p.values.size(); }
+    void OnValues(uint32_t connection, std::vector<int> values) { total += connection * values.size(); }
+
+    size_t total = 0;
+};
+
+int g_static_total = 0;
+void StaticOnData(uint32_t connection, int value) { g_static_total += int(connection) * value; }
+
+} // end anonymous namespace
+
+TEST(BoundDelegate, testInvoke)
+{
+    Server server;
+    BoundDelegate<void(int), uint32_t> d = BindFront(MakeDelegate<&Server::OnData>(server), 7u);
+    EXPECT_FALSE(d.empty());
+    EXPECT_EQ(7u, std::get<0>(d.bound()));
+    d(1);
+    d(2);
+    ASSERT_EQ(2u, server.received.size());
+    EXPECT_EQ(701, server.received[0]);
+    EXPECT_EQ(702, server.received[1]);
+
+    // Runtime bound method, const method with a return value, static function
+    auto runtime = BindFront(MakeDelegate(server, &Server::OnData), 3u);
+    runtime(4);
+    EXPECT_EQ(304, server.received[2]);
+
+    auto scaled = BindFront(MakeDelegate(server, &Server::Scaled), 5);
+    EXPECT_EQ(15, scaled(3));
+
+    g_static_total = 0;
+    auto freeFunction = BindFront(Delegate<void(uint32_t, int)>(&StaticOnData), 2u);
+    freeFunction(10);
+    EXPECT_EQ(20, g_static_total);
+
+    // Every parameter bound
+    auto all = BindFront(MakeDelegate(server, &Server::Scaled), 6, 7);
+    static_assert(std::is_same<decltype(all), BoundDelegate<int(), int, int>>::value);
+    EXPECT_EQ(42, all());
+
+    BoundDelegate<void(int), uint32_t> empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_FALSE(empty);
+    d.reset();
+    EXPECT_TRUE(d.empty());
+}
+
+TEST(BoundDelegate, testReferenceAndMovedArguments)
+{
+    Server server;
+    uint32_t channel = 9;
+    auto d = BindFront(MakeDelegate(server, &Server::OnText), 1u, channel);
+    static_assert(std::is_same<decltype(d), BoundDelegate<void(std::string), uint32_t, const uint32_t&>>::value);
+
+    // The bound reference parameter refers to a copy
+    channel = 10;
+    std::string text(100, 'x');
+    d(std::move(text));
+    d(std::string("b"));
+    ASSERT_EQ(2u, server.texts.size());
+    EXPECT_EQ("1/9:" + std::string(100, 'x'), server.texts[0]);
+    EXPECT_EQ("1/9:b", server.texts[1]);
+}
+
+TEST(BoundDelegate, testArguments)
+{
+    PacketSink sink;
+    LateConnection connection;
+    connection.onPacket = BindFront(MakeDelegate(sink, &PacketSink::OnPacket), 10u);
+    connection.onPacket(LatePacket{ { 1, 2 } });
+    EXPECT_EQ(20u, sink.total);
+
+    // Braced initializer lists convert to the parameter type
+    auto values = BindFront(MakeDelegate(sink, &PacketSink::OnValues), 100u);
+    values({ 1, 2, 3 });
+    values({});
+    EXPECT_EQ(320u, sink.total);
+}
+
+TEST(BoundDelegate, testComparisons)
+{
+    Server a, b;
+    auto target = MakeDelegate<&Server::OnData>(a);
+    auto d1 = BindFront(target, 1u);
+    auto d1Again = BindFront(MakeDelegate<&Server::OnData>(a), 1u);
+    auto d2 = BindFront(target, 2u);
+    auto other = BindFront(MakeDelegate<&Server::OnData>(b), 1u);
+
+    EXPECT_TRUE(d1 == d1Again);
+    EXPECT_FALSE(d1 != d1Again);
+    EXPECT_TRUE(d1 != d2);
+    EXPECT_TRUE(d1 != other);
+    EXPECT_EQ(std::hash<decltype(d1)>()(d1), std::hash<decltype(d1)>()(d1Again));
+
+    std::unordered_set<decltype(d1)> set{ d1, d2, other };
+    EXPECT_EQ(3u, set.size());
+    EXPECT_EQ(1u, set.count(d1Again));
+
+    // Unsubscribe by value
+    std::vector<decltype(d1)> subscribers{ d1, d2, other };
+    subscribers.erase(std::find(subscribers.begin(), subscribers.end(), d1Again));
+    ASSERT_EQ(2u, subscribers.size());
+    for (auto& s : subscribers)
+        s(5);
+    EXPECT_EQ(std::vector<int>{ 205 }, a.received);
+    EXPECT_EQ(std::vector<int>{ 105 }, b.received);
+}
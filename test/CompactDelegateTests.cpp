@@ -0,0 +1,170 @@
+#include "gtest/gtest.h"
+
+#include "CompactDelegate.h"
+#include <thread>
+#include <vector>
+
+using namespace delly;
+
+namespace {
+
+struct Order
+{
+    virtual ~Order() = default;
+    void OnFill(int quantity) { filled += quantity; }
+    virtual void OnCancel(int quantity) { cancelled += quantity; }
+
+    int filled = 0;
+    int cancelled = 0;
+};
+
+struct Padding { long pad[3] = {}; };
+
+// The Order base is not at the start of the object
+struct StopOrder : public Padding, public Order
+{
+    void OnCancel(int quantity) override { cancelled += 2 * quantity; }
+};
+
+// Every object bound in these tests lives in the arena
+struct Arena
+{
+    Order orders[64];
+    StopOrder stops[8];
+};
+
+Arena g_arena;
+
+int g_static_total = 0;
+void StaticFill(int quantity) { g_static_total += quantity; }
+
+// Declared only, when the compact delegate type is
+struct LateFill;
+struct LateOrder { CompactDelegate<void(LateFill)> onFill; };
+struct LateFill { std::vector<int> quantities; };
+
+void StaticLateFill(LateFill fill) { g_static_total += int(fill.quantities.size()); }
+void StaticFills(std::vector<int> quantities) { g_static_total += 10 * int(quantities.size()); }
+
+using FillDelegate = Delegate<void(int)>;
+using CompactFill = CompactDelegate<void(int)>;
+
+} // end anonymous namespace
+
+TEST(CompactDelegate, testEncodeDecode)
+{
+    static_assert(sizeof(CompactFill) == 8);
+    CompactDelegateArena::Register(&g_arena);
+
+    Order& order = g_arena.orders[3];
+    StopOrder& stop = g_arena.stops[1];
+    const FillDelegate delegates[] = {
+        MakeDelegate(order, &Order::OnFill),
+        MakeDelegate(order, &Order::OnCancel),
+        MakeDelegate<&Order::OnFill>(order),
+        MakeDelegate(static_cast<Order*>(&stop), &Order::OnCancel),
+        MakeResolvedDelegate(static_cast<Order*>(&stop), &Order::OnCancel),
+        FillDelegate(&StaticFill),
+        FillDelegate(),
+    };
+
+    for (const auto& d : delegates) {
+        ASSERT_TRUE(CompactFill::CanEncode(d));
+        CompactFill c(d);
+        EXPECT_TRUE(c.delegate() == d);
+        EXPECT_EQ(d.empty(), c.empty());
+        FillDelegate back = c;
+        EXPECT_TRUE(back == d);
+    }
+
+    g_static_total = 0;
+    for (const auto& d : delegates) {
+        CompactFill c(d);
+        if (c)
+            c(10);
+    }
+    EXPECT_EQ(20, order.filled);
+    EXPECT_EQ(10, order.cancelled);
+    EXPECT_EQ(40, stop.cancelled);
+    EXPECT_EQ(10, g_static_total);
+
+    CompactFill empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_FALSE(empty);
+    EXPECT_TRUE(empty.delegate().empty());
+    EXPECT_TRUE(empty == CompactFill(FillDelegate()));
+}
+
+TEST(CompactDelegate, testArguments)
+{
+    g_static_total = 0;
+    LateOrder order;
+    order.onFill = CompactDelegate<void(LateFill)>(Delegate<void(LateFill)>(&StaticLateFill));
+    order.onFill(LateFill{ { 1, 2 } });
+    EXPECT_EQ(2, g_static_total);
+
+    // Braced initializer lists convert to the parameter type
+    CompactDelegate<void(std::vector<int>)> fills{ Delegate<void(std::vector<int>)>(&StaticFills) };
+    fills({ 1, 2, 3 });
+    fills({});
+    EXPECT_EQ(32, g_static_total);
+}
+
+TEST(CompactDelegate, testInterning)
+{
+    CompactDelegateArena::Register(&g_arena);
+
+    // Same method of different objects: same index, different offsets
+    CompactFill a(MakeDelegate(g_arena.orders[0], &Order::OnFill));
+    CompactFill b(MakeDelegate(g_arena.orders[1], &Order::OnFill));
+    CompactFill a2(MakeDelegate(g_arena.orders[0], &Order::OnFill));
+    EXPECT_EQ(a.method(), b.method());
+    EXPECT_EQ(sizeof(Order), size_t(b.offset() - a.offset()));
+    EXPECT_TRUE(a == a2);
+    EXPECT_TRUE(a != b);
+
+    CompactFill c(MakeDelegate(g_arena.orders[0], &Order::OnCancel));
+    EXPECT_NE(a.method(), c.method());
+    EXPECT_EQ(a.offset(), c.offset());
+
+    // Objects outside the arena cannot be encoded
+    Order outside;
+    EXPECT_FALSE(CompactFill::CanEncode(MakeDelegate(outside, &Order::OnFill)));
+    EXPECT_THROW(CompactFill(MakeDelegate(outside, &Order::OnFill)), std::invalid_argument);
+    EXPECT_TRUE(CompactFill::CanEncode(FillDelegate(&StaticFill)));
+
+    // Nor can the arena move
+    EXPECT_THROW(CompactDelegateArena::Register(&outside), std::logic_error);
+    EXPECT_EQ(&g_arena, CompactDelegateArena::Base());
+}
+
+TEST(CompactDelegate, testConcurrentEncode)
+{
+    CompactDelegateArena::Register(&g_arena);
+
+    // Threads encoding the same methods get the same indices
+    std::vector<int> cancelled;
+    for (auto& stop : g_arena.stops)
+        cancelled.push_back(stop.cancelled);
+    std::vector<std::vector<CompactFill>> encoded(4);
+    std::vector<std::thread> threads;
+    for (auto& out : encoded) {
+        threads.emplace_back([&out]() {
+            for (auto& stop : g_arena.stops) {
+                out.emplace_back(MakeDelegate<&Order::OnFill>(stop));
+                out.emplace_back(MakeDelegate<&Order::OnCancel>(stop));
+            }
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    for (auto& out : encoded)
+        EXPECT_TRUE(out == encoded[0]);
+
+    for (auto& c : encoded[0])
+        c(1);
+    for (size_t i = 0; i < cancelled.size(); ++i) {
+        EXPECT_EQ(1, g_arena.stops[i].filled);
+        EXPECT_EQ(cancelled[i] + 2, g_arena.stops[i].cancelled);
+    }
+}
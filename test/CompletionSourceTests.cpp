@@ -0,0 +1,157 @@
+#include "gtest/gtest.h"
+
+#include "CompletionSource.h"
+#include <atomic>
+#include <coroutine>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace delly;
+
+namespace {
+
+// Coroutine which starts at once and frees its frame when done
+struct Detached
+{
+    struct promise_type {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// Callback based producer, completes when told to
+struct Producer
+{
+    void start(Delegate<void(int)> done) { pending.push_back(done); }
+    void completeAll(int value) {
+        auto calls = std::move(pending);
+        pending.clear();
+        for (auto& d : calls)
+            d(value++);
+    }
+
+    std::vector<Delegate<void(int)>> pending;
+};
+
+Detached AwaitSource(CompletionSource<int>& source, std::vector<int>& results) {
+    results.push_back(co_await source);
+}
+
+Detached AwaitTwice(Producer& producer, std::vector<int>& results) {
+    for (int i = 0; i < 2; ++i) {
+        int v = co_await AwaitDelegate<int>([&](Delegate<void(int)> done) { producer.start(done); });
+        results.push_back(v);
+    }
+}
+
+Detached AwaitSynchronous(std::vector<std::string>& results) {
+    std::string s = co_await AwaitDelegate<std::string>([](Delegate<void(std::string)> done) {
+        done(std::string("now"));
+    });
+    results.push_back(s);
+}
+
+Detached AwaitVoid(CompletionSource<void>& source, int& resumed) {
+    co_await source;
+    ++resumed;
+    source.reset();
+    co_await source;
+    ++resumed;
+}
+
+Detached AwaitThread(std::atomic<int>& result) {
+    int v = co_await AwaitDelegate<int>([](Delegate<void(int)> done) {
+        std::thread([done]() { done(42); }).detach();
+    });
+    result = v;
+}
+
+} // end anonymous namespace
+
+TEST(CompletionSource, testCompleteAfterAwait)
+{
+    CompletionSource<int> source;
+    std::vector<int> results;
+    AwaitSource(source, results);
+    EXPECT_TRUE(results.empty());
+    EXPECT_FALSE(source.ready());
+
+    auto d = source.delegate();
+    EXPECT_TRUE(d == source.delegate());
+    d(7);
+    ASSERT_EQ(1u, results.size());
+    EXPECT_EQ(7, results[0]);
+}
+
+TEST(CompletionSource, testCompleteBeforeAwait)
+{
+    CompletionSource<int> source;
+    source.delegate()(3);
+    EXPECT_TRUE(source.ready());
+
+    std::vector<int> results;
+    AwaitSource(source, results);
+    ASSERT_EQ(1u, results.size());
+    EXPECT_EQ(3, results[0]);
+
+    // Reused
+    source.reset();
+    EXPECT_FALSE(source.ready());
+    AwaitSource(source, results);
+    source.complete(4);
+    ASSERT_EQ(2u, results.size());
+    EXPECT_EQ(4, results[1]);
+}
+
+TEST(CompletionSource, testVoid)
+{
+    CompletionSource<void> source;
+    int resumed = 0;
+    AwaitVoid(source, resumed);
+    EXPECT_EQ(0, resumed);
+    source.delegate()();
+    EXPECT_EQ(1, resumed);
+    source.complete();
+    EXPECT_EQ(2, resumed);
+}
+
+TEST(DelegateAwaiter, testAwaitDelegate)
+{
+    Producer producer;
+    std::vector<int> results;
+    AwaitTwice(producer, results);
+    ASSERT_EQ(1u, producer.pending.size());
+    EXPECT_TRUE(results.empty());
+
+    producer.completeAll(10);
+    ASSERT_EQ(1u, results.size());
+    EXPECT_EQ(10, results[0]);
+
+    // The resumed coroutine started the second operation
+    ASSERT_EQ(1u, producer.pending.size());
+    producer.completeAll(20);
+    ASSERT_EQ(2u, results.size());
+    EXPECT_EQ(20, results[1]);
+    EXPECT_TRUE(producer.pending.empty());
+}
+
+TEST(DelegateAwaiter, testSynchronousCompletion)
+{
+    std::vector<std::string> results;
+    AwaitSynchronous(results);
+    ASSERT_EQ(1u, results.size());
+    EXPECT_EQ("now", results[0]);
+}
+
+TEST(DelegateAwaiter, testCompleteFromThread)
+{
+    std::atomic<int> result{0};
+    AwaitThread(result);
+    while (result.load() == 0)
+        std::this_thread::yield();
+    EXPECT_EQ(42, result.load());
+}
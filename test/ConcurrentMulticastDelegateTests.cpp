@@ -0,0 +1,127 @@
+#include "gtest/gtest.h"
+
+#include "ConcurrentMulticastDelegate.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace delly;
+
+namespace {
+
+struct Counter
+{
+    void OnEvent(int v) { total.fetch_add(v, std::memory_order_relaxed); }
+    std::atomic<long> total{0};
+};
+
+} // end anonymous namespace
+
+TEST(ConcurrentMulticastDelegate, testDispatch)
+{
+    Counter c1, c2;
+    ConcurrentMulticastDelegate<void(int)> m;
+    EXPECT_TRUE(m.empty());
+    m(1);
+
+    auto h1 = m.add(MakeDelegate(c1, &Counter::OnEvent));
+    auto h2 = m.add(MakeDelegate(c2, &Counter::OnEvent));
+    EXPECT_EQ(2u, m.size());
+
+    m(2);
+    EXPECT_EQ(2, c1.total);
+    EXPECT_EQ(2, c2.total);
+
+    EXPECT_TRUE(m.remove(h1));
+    EXPECT_FALSE(m.remove(h1));
+    m(3);
+    EXPECT_EQ(2, c1.total);
+    EXPECT_EQ(5, c2.total);
+
+    EXPECT_TRUE(m.remove(MakeDelegate(c2, &Counter::OnEvent)));
+    EXPECT_FALSE(m.remove(h2));
+    EXPECT_TRUE(m.empty());
+    m(4);
+    EXPECT_EQ(5, c2.total);
+
+    m.add(MakeDelegate(c1, &Counter::OnEvent));
+    m.clear();
+    m.synchronize();
+    m(5);
+    EXPECT_EQ(2, c1.total);
+}
+
+TEST(ConcurrentMulticastDelegate, testNestedDispatch)
+{
+    // A subscriber may add and invoke while being invoked
+    ConcurrentMulticastDelegate<void(int)> m;
+    Counter c;
+    struct Nested {
+        void OnEvent(int v) {
+            if (v > 0) {
+                m->add(MakeDelegate(*c, &Counter::OnEvent));
+                (*m)(v - 1);
+            }
+        }
+        ConcurrentMulticastDelegate<void(int)>* m;
+        Counter* c;
+    } nested{ &m, &c };
+
+    m.add(MakeDelegate(nested, &Nested::OnEvent));
+    m(2);
+    EXPECT_EQ(3u, m.size());
+    EXPECT_EQ(1, c.total);
+}
+
+TEST(ConcurrentMulticastDelegate, testStress)
+{
+    const int readers = 4;
+    const int writers = 2;
+    const int subscribersPerWriter = 16;
+
+    // Always subscribed, each invocation adds exactly 1
+    Counter always;
+    std::vector<Counter> churn(writers * subscribersPerWriter);
+
+    ConcurrentMulticastDelegate<void(int)> m;
+    m.add(MakeDelegate(always, &Counter::OnEvent));
+
+    std::atomic<bool> stop{false};
+    std::atomic<long> invocations{0};
+
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; ++r) {
+        threads.emplace_back([&]() {
+            long n = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                m(1);
+                ++n;
+            }
+            invocations.fetch_add(n);
+        });
+    }
+
+    for (int w = 0; w < writers; ++w) {
+        threads.emplace_back([&, w]() {
+            std::vector<uint64_t> handles;
+            for (int round = 0; round < 200; ++round) {
+                for (int i = 0; i < subscribersPerWriter; ++i)
+                    handles.push_back(m.add(MakeDelegate(churn[w * subscribersPerWriter + i], &Counter::OnEvent)));
+                for (auto h : handles)
+                    EXPECT_TRUE(m.remove(h));
+                handles.clear();
+            }
+        });
+    }
+
+    for (int i = readers; i < readers + writers; ++i)
+        threads[i].join();
+    stop = true;
+    for (int i = 0; i < readers; ++i)
+        threads[i].join();
+
+    m.synchronize();
+    EXPECT_EQ(1u, m.size());
+    EXPECT_EQ(invocations.load(), always.total.load());
+}
@@ -0,0 +1,124 @@
+#include "gtest/gtest.h"
+
+#include "DeferredCallQueue.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace delly;
+
+namespace {
+
+struct Recorder
+{
+    struct Point { int x, y; };
+
+    void OnValue(int v) { values.push_back(v); }
+    void OnPair(int a, double b) { values.push_back(a); sum += b; }
+    void OnPoint(const Point& p) { values.push_back(p.x + p.y); }
+
+    std::vector<int> values;
+    double sum = 0;
+};
+
+std::vector<int> g_static_values;
+void StaticRecorder(int v) { g_static_values.push_back(v); }
+
+} // end anonymous namespace
+
+TEST(DeferredCallQueue, testOrder)
+{
+    g_static_values.clear();
+    Recorder r;
+    DeferredCallQueue queue(1024);
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(0u, queue.drain());
+
+    auto onValue = MakeDelegate(r, &Recorder::OnValue);
+    EXPECT_TRUE(queue.tryPush(onValue, 1));
+    EXPECT_TRUE(queue.tryPush(MakeDelegate(r, &Recorder::OnPair), 2, 0.5));
+    EXPECT_TRUE(queue.tryPush(Delegate<void(int)>(&StaticRecorder), 3));
+    EXPECT_TRUE(queue.tryPush(MakeDelegate(r, &Recorder::OnPoint), Recorder::Point{ 2, 2 }));
+    EXPECT_FALSE(queue.empty());
+
+    // Nothing runs before draining
+    EXPECT_TRUE(r.values.empty());
+
+    EXPECT_EQ(1u, queue.drain(1));
+    EXPECT_EQ(std::vector<int>({ 1 }), r.values);
+    EXPECT_EQ(3u, queue.drain());
+    EXPECT_EQ(std::vector<int>({ 1, 2, 4 }), r.values);
+    EXPECT_DOUBLE_EQ(0.5, r.sum);
+    EXPECT_EQ(std::vector<int>({ 3 }), g_static_values);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(DeferredCallQueue, testFullAndWrap)
+{
+    Recorder r;
+    DeferredCallQueue queue(256);
+    auto onValue = MakeDelegate(r, &Recorder::OnValue);
+
+    // Fill the ring, then wrap around it many times
+    int pushed = 0;
+    while (queue.tryPush(onValue, pushed))
+        ++pushed;
+    EXPECT_GT(pushed, 0);
+    EXPECT_EQ(size_t(pushed), queue.drain());
+
+    for (int round = 0; round < 100; ++round) {
+        const int n = 1 + round % 5;
+        for (int i = 0; i < n; ++i)
+            EXPECT_TRUE(queue.tryPush(onValue, pushed++));
+        EXPECT_TRUE(queue.tryPush(MakeDelegate(r, &Recorder::OnPair), pushed++, 1.0));
+        EXPECT_EQ(size_t(n + 1), queue.drain());
+    }
+
+    ASSERT_EQ(size_t(pushed), r.values.size());
+    for (int i = 0; i < pushed; ++i)
+        EXPECT_EQ(i, r.values[i]);
+}
+
+TEST(DeferredCallQueue, testProducers)
+{
+    // Each producer pushes increasing values, which must arrive in order
+    struct Checker
+    {
+        void OnValue(int producer, int value) {
+            EXPECT_EQ(last[producer] + 1, value);
+            last[producer] = value;
+            ++received;
+        }
+
+        std::vector<int> last;
+        long received = 0;
+    };
+
+    const int producers = 4;
+    const int perProducer = 50000;
+    Checker checker;
+    checker.last.assign(producers, -1);
+    auto onValue = MakeDelegate(checker, &Checker::OnValue);
+
+    DeferredCallQueue queue(4096);
+    std::atomic<int> done{0};
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (int i = 0; i < perProducer; ++i)
+                queue.push(onValue, p, i);
+            done.fetch_add(1);
+        });
+    }
+
+    while (done.load() < producers || !queue.empty()) {
+        if (!queue.drain())
+            std::this_thread::yield();
+    }
+    for (auto& t : threads)
+        t.join();
+
+    EXPECT_EQ(long(producers) * perProducer, checker.received);
+    for (int p = 0; p < producers; ++p)
+        EXPECT_EQ(perProducer - 1, checker.last[p]);
+}
@@ -0,0 +1,131 @@
+#include "gtest/gtest.h"
+
+#include "DelegateFlatSet.h"
+#include <random>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+using namespace delly;
+
+namespace {
+
+struct Handler
+{
+    void OnEvent(int) {}
+    void OnOther(int) {}
+    char padding[8];
+};
+
+void FreeHandler(int) {}
+
+using EventDelegate = Delegate<void(int)>;
+
+} // end anonymous namespace
+
+TEST(DelegateFlatSet, testHash)
+{
+    Handler h1, h2;
+    std::hash<EventDelegate> hasher;
+
+    EXPECT_EQ(hasher(MakeDelegate(h1, &Handler::OnEvent)), hasher(MakeDelegate(&h1, &Handler::OnEvent)));
+    EXPECT_NE(hasher(MakeDelegate(h1, &Handler::OnEvent)), hasher(MakeDelegate(h2, &Handler::OnEvent)));
+    EXPECT_NE(hasher(MakeDelegate(h1, &Handler::OnEvent)), hasher(MakeDelegate(h1, &Handler::OnOther)));
+    EXPECT_EQ(hasher(EventDelegate(&FreeHandler)), hasher(MakeDelegate(&FreeHandler)));
+
+    std::unordered_set<EventDelegate> set;
+    set.insert(MakeDelegate(h1, &Handler::OnEvent));
+    set.insert(MakeDelegate(&h1, &Handler::OnEvent));
+    set.insert(&FreeHandler);
+    EXPECT_EQ(2u, set.size());
+}
+
+TEST(DelegateFlatSet, testSet)
+{
+    Handler h1, h2;
+    DelegateFlatSet set;
+    EXPECT_TRUE(set.empty());
+    EXPECT_FALSE(set.contains(MakeDelegate(h1, &Handler::OnEvent)));
+
+    EXPECT_TRUE(set.insert(MakeDelegate(h1, &Handler::OnEvent)));
+    EXPECT_FALSE(set.insert(MakeDelegate(&h1, &Handler::OnEvent)));
+    EXPECT_TRUE(set.insert(MakeDelegate(h2, &Handler::OnEvent)));
+    EXPECT_TRUE(set.insert(EventDelegate(&FreeHandler)));
+    EXPECT_EQ(3u, set.size());
+
+    EXPECT_TRUE(set.contains(MakeDelegate(h2, &Handler::OnEvent)));
+    EXPECT_FALSE(set.contains(MakeDelegate(h2, &Handler::OnOther)));
+    EXPECT_FALSE(set.contains(EventDelegate()));
+
+    EXPECT_TRUE(set.erase(MakeDelegate(h1, &Handler::OnEvent)));
+    EXPECT_FALSE(set.erase(MakeDelegate(h1, &Handler::OnEvent)));
+    EXPECT_FALSE(set.contains(MakeDelegate(h1, &Handler::OnEvent)));
+    EXPECT_TRUE(set.contains(MakeDelegate(h2, &Handler::OnEvent)));
+    EXPECT_EQ(2u, set.size());
+
+    set.clear();
+    EXPECT_TRUE(set.empty());
+    EXPECT_FALSE(set.contains(EventDelegate(&FreeHandler)));
+}
+
+TEST(DelegateFlatSet, testMatchesStdSet)
+{
+    // Random inserts and erases over a pool of delegates, checked against std::set
+    std::vector<Handler> handlers(2000);
+    std::vector<EventDelegate> pool;
+    for (auto& h : handlers) {
+        pool.push_back(MakeDelegate(h, &Handler::OnEvent));
+        pool.push_back(MakeDelegate(h, &Handler::OnOther));
+    }
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<size_t> pick(0, pool.size() - 1);
+
+    DelegateFlatSet set;
+    DelegateFlatMap<size_t> map;
+    std::set<EventDelegate> reference;
+    for (int step = 0; step < 100000; ++step) {
+        size_t i = pick(rng);
+        const auto& d = pool[i];
+        if (rng() % 3 == 0) {
+            bool erased = reference.erase(d) != 0;
+            EXPECT_EQ(erased, set.erase(d));
+            EXPECT_EQ(erased, map.erase(d));
+        } else {
+            bool inserted = reference.insert(d).second;
+            EXPECT_EQ(inserted, set.insert(d));
+            EXPECT_EQ(inserted, map.insert(d, i));
+        }
+    }
+
+    EXPECT_EQ(reference.size(), set.size());
+    EXPECT_EQ(reference.size(), map.size());
+    for (size_t i = 0; i < pool.size(); ++i) {
+        bool present = reference.count(pool[i]) != 0;
+        EXPECT_EQ(present, set.contains(pool[i]));
+        const size_t* value = map.find(pool[i]);
+        EXPECT_EQ(present, value != nullptr);
+        if (value) {
+            EXPECT_EQ(i, *value);
+        }
+    }
+}
+
+TEST(DelegateFlatSet, testMap)
+{
+    Handler h1, h2;
+    DelegateFlatMap<std::string> map;
+    map.reserve(100);
+
+    EXPECT_TRUE(map.insert(MakeDelegate(h1, &Handler::OnEvent), "h1"));
+    EXPECT_FALSE(map.insert(MakeDelegate(h1, &Handler::OnEvent), "again"));
+    EXPECT_EQ("h1", *map.find(MakeDelegate(h1, &Handler::OnEvent)));
+
+    map[MakeDelegate(h2, &Handler::OnEvent)] += "h2";
+    EXPECT_EQ("h2", map[MakeDelegate(h2, &Handler::OnEvent)]);
+    EXPECT_EQ(2u, map.size());
+
+    EXPECT_TRUE(map.erase(MakeDelegate(h1, &Handler::OnEvent)));
+    EXPECT_EQ(nullptr, map.find(MakeDelegate(h1, &Handler::OnEvent)));
+    EXPECT_TRUE(map.contains(MakeDelegate(h2, &Handler::OnEvent)));
+}
@@ -0,0 +1,151 @@
+#include "gtest/gtest.h"
+
+// Built in its own executable, with DELEGATE_PROFILING set to 1
+#include "Delegate.h"
+#include <cstdio>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace delly;
+
+static_assert(DELEGATE_PROFILING, "DelegateProfilerTests must be built with DELEGATE_PROFILING=1");
+
+namespace {
+
+int g_calls = 0;
+__attribute__((noinline)) void ProfiledFunction(int n) { g_calls += n; }
+
+struct Handler
+{
+    virtual ~Handler() = default;
+    virtual void OnEvent(int n) { total += n; }
+    __attribute__((noinline)) void OnTick(int n) { total -= n; }
+
+    int total = 0;
+};
+
+struct SlowHandler : public Handler
+{
+    __attribute__((noinline)) void OnEvent(int n) override { total += 2 * n; }
+};
+
+const DelegateProfileEntry* Find(const std::vector<DelegateProfileEntry>& entries, uintptr_t code) {
+    for (const auto& e : entries)
+        if (e.code == code)
+            return &e;
+    return nullptr;
+}
+
+const DelegateProfileEntry* FindSymbol(const std::vector<DelegateProfileEntry>& entries, const char* name) {
+    for (const auto& e : entries)
+        if (DelegateProfiler::Symbolize(e.code).find(name) != std::string::npos)
+            return &e;
+    return nullptr;
+}
+
+} // end anonymous namespace
+
+TEST(DelegateProfiler, testCountsByTarget)
+{
+    DelegateProfiler::Reset();
+    SlowHandler slow;
+    Handler* base = &slow;
+    Delegate<void(int)> function(&ProfiledFunction);
+    Delegate<void(int)> virtualMethod(base, &Handler::OnEvent);
+    auto compileTime = MakeDelegate<&Handler::OnTick>(slow);
+
+    for (int i = 0; i < 100; ++i)
+        function(1);
+    for (int i = 0; i < 30; ++i)
+        virtualMethod(1);
+    for (int i = 0; i < 7; ++i)
+        compileTime(1);
+
+    const auto entries = DelegateProfiler::Snapshot();
+    const DelegateProfileEntry* f = Find(entries, reinterpret_cast<uintptr_t>(&ProfiledFunction));
+    ASSERT_NE(f, nullptr);
+    EXPECT_EQ(f->calls, 100u);
+
+    // Counted for the final overrider
+    const DelegateProfileEntry* v = FindSymbol(entries, "SlowHandler::OnEvent");
+    ASSERT_NE(v, nullptr);
+    EXPECT_EQ(v->calls, 30u);
+
+    // Methods bound at compile time are counted for their thunk
+    const DelegateProfileEntry* t = FindSymbol(entries, "Handler::OnTick");
+    ASSERT_NE(t, nullptr);
+    EXPECT_EQ(t->calls, 7u);
+
+    uint64_t histogramCalls = 0;
+    for (uint64_t count : f->histogram)
+        histogramCalls += count;
+    EXPECT_EQ(histogramCalls, 100u);
+    EXPECT_LE(f->percentileCycles(50), f->percentileCycles(99));
+    EXPECT_LE(f->percentileCycles(99), f->maxCycles);
+    EXPECT_GE(f->meanCycles(), 0);
+}
+
+TEST(DelegateProfiler, testBatchCalls)
+{
+    DelegateProfiler::Reset();
+    SlowHandler slow;
+    Handler* base = &slow;
+    Delegate<void(int)> function(&ProfiledFunction);
+    Delegate<void(int)> virtualMethod(base, &Handler::OnEvent);
+
+    const std::vector<int> values(20, 1);
+    function.invokeEach(values);
+    const std::vector<std::tuple<int>> tuples(5, std::tuple<int>(1));
+    virtualMethod.invokeBatch(tuples);
+    virtualMethod.invokeBatch(tuples.data(), 3);
+
+    // Each element is counted as a call of the decoded target
+    const auto entries = DelegateProfiler::Snapshot();
+    const DelegateProfileEntry* f = Find(entries, reinterpret_cast<uintptr_t>(&ProfiledFunction));
+    ASSERT_NE(f, nullptr);
+    EXPECT_EQ(f->calls, 20u);
+    const DelegateProfileEntry* v = FindSymbol(entries, "SlowHandler::OnEvent");
+    ASSERT_NE(v, nullptr);
+    EXPECT_EQ(v->calls, 8u);
+}
+
+TEST(DelegateProfiler, testMergesThreads)
+{
+    DelegateProfiler::Reset();
+    Delegate<void(int)> d(&ProfiledFunction);
+    std::thread other([&] {
+        for (int i = 0; i < 500; ++i)
+            d(1);
+    });
+    for (int i = 0; i < 250; ++i)
+        d(1);
+    other.join();
+
+    const auto entries = DelegateProfiler::Snapshot();
+    const DelegateProfileEntry* f = Find(entries, reinterpret_cast<uintptr_t>(&ProfiledFunction));
+    ASSERT_NE(f, nullptr);
+    EXPECT_EQ(f->calls, 750u);
+}
+
+TEST(DelegateProfiler, testReport)
+{
+    DelegateProfiler::Reset();
+    Delegate<void(int)> d(&ProfiledFunction);
+    d(1);
+    EXPECT_NE(DelegateProfiler::Symbolize(reinterpret_cast<uintptr_t>(&ProfiledFunction)).find("ProfiledFunction"),
+              std::string::npos);
+
+    FILE* out = tmpfile();
+    ASSERT_NE(out, nullptr);
+    DelegateProfiler::Report(out, 5);
+    rewind(out);
+    std::string text;
+    char buffer[512];
+    while (fgets(buffer, sizeof(buffer), out))
+        text += buffer;
+    fclose(out);
+    EXPECT_NE(text.find("by calls"), std::string::npos);
+    EXPECT_NE(text.find("by mean cycles"), std::string::npos);
+    EXPECT_NE(text.find("ProfiledFunction"), std::string::npos);
+}
@@ -0,0 +1,104 @@
+#include "gtest/gtest.h"
+
+#include "DelegateRegistry.h"
+
+using namespace delly;
+
+namespace {
+
+struct Point { int x, y; };
+
+struct Worker
+{
+    void OnJob(int job) { total += job; }
+    void OnMove(const Point& p, double scale) { total += int((p.x + p.y) * scale); }
+    int Total() const { return total; }
+    void OnReply(int& reply) { reply = total; }
+
+    int total = 0;
+};
+
+struct Other
+{
+    void OnJob(int job) { seen = job; }
+
+    int seen = 0;
+};
+
+int g_flushed = 0;
+void Flush(int n) { g_flushed += n; }
+
+} // end anonymous namespace
+
+TEST(DelegateRegistry, testIds)
+{
+    constexpr uint32_t job = DelegateRegistry::IdOf<&Worker::OnJob>();
+    static_assert(job != 0);
+    static_assert(job != DelegateRegistry::IdOf<&Other::OnJob>());
+    static_assert(job != DelegateRegistry::IdOf<&Worker::OnMove>());
+    static_assert(DelegateRegistry::IdOf<&Flush>() != 0);
+    static_assert(DelegateRegistry::ArgsSizeOf<&Worker::OnMove>() == sizeof(std::tuple<Point, double>));
+
+    DelegateRegistry registry;
+    EXPECT_EQ(registry.add<&Worker::OnJob>(), job);
+    EXPECT_EQ(registry.add<&Worker::OnJob>(), job);
+    EXPECT_EQ(registry.size(), 1u);
+    EXPECT_TRUE(registry.contains(job));
+    EXPECT_FALSE(registry.contains(DelegateRegistry::IdOf<&Flush>()));
+    EXPECT_FALSE(registry.contains(0));
+}
+
+TEST(DelegateRegistry, testFind)
+{
+    DelegateRegistry registry;
+    const uint32_t job = registry.add<&Worker::OnJob>();
+    const uint32_t total = registry.add<&Worker::Total>();
+    const uint32_t flush = registry.add<&Flush>();
+
+    Worker w;
+    Other o;
+    registry.setObject(1, w);
+    registry.setObject(2, o);
+
+    Delegate<void(int)> d = registry.find<void(int)>(job, 1);
+    EXPECT_EQ(d, MakeDelegate<&Worker::OnJob>(w));
+    d(5);
+    EXPECT_EQ(w.total, 5);
+    EXPECT_EQ(registry.find<int()>(total, 1)(), 5);
+
+    // Functions ignore the handle
+    g_flushed = 0;
+    registry.find<void(int)>(flush, 9)(3);
+    EXPECT_EQ(g_flushed, 3);
+
+    // Unknown handles, objects of another class, another signature
+    EXPECT_TRUE(registry.find<void(int)>(job, 3).empty());
+    EXPECT_TRUE(registry.find<void(int)>(job, 2).empty());
+    EXPECT_TRUE(registry.find<void(long)>(job, 1).empty());
+    registry.removeObject(1);
+    EXPECT_TRUE(registry.find<void(int)>(job, 1).empty());
+}
+
+TEST(DelegateRegistry, testInvokePacked)
+{
+    DelegateRegistry registry;
+    registry.add<&Worker::OnMove>();
+    registry.add<&Worker::OnReply>();
+    Worker w;
+    registry.setObject(0, w);
+
+    alignas(8) char args[64];
+    DelegateRegistry::PackArgs<&Worker::OnMove>(args, Point{ 2, 3 }, 2.0);
+    constexpr uint32_t move = DelegateRegistry::IdOf<&Worker::OnMove>();
+    EXPECT_TRUE(registry.invoke(move, 0, args, DelegateRegistry::ArgsSizeOf<&Worker::OnMove>()));
+    EXPECT_EQ(w.total, 10);
+    EXPECT_FALSE(registry.invoke(move, 0, args, 4));
+    EXPECT_FALSE(registry.invoke(move, 1, args, DelegateRegistry::ArgsSizeOf<&Worker::OnMove>()));
+    EXPECT_FALSE(registry.invoke(DelegateRegistry::IdOf<&Flush>(), 0, args, sizeof(int)));
+    EXPECT_EQ(w.total, 10);
+
+    // Reference parameters refer to the packed values
+    DelegateRegistry::PackArgs<&Worker::OnReply>(args, 0);
+    EXPECT_TRUE(registry.invoke(DelegateRegistry::IdOf<&Worker::OnReply>(), 0, args, sizeof(int)));
+    EXPECT_EQ(std::get<0>(*reinterpret_cast<std::tuple<int>*>(args)), 10);
+}
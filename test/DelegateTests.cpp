@@ -7,6 +7,7 @@
 #include <sstream>
 #include <tuple>
 #include <exception>
+#include <memory>
 
 #define PRINT_HEX 0
 
@@ -260,11 +261,24 @@ TEST_F(DelegateTestFramework, testStaticComparisons)
     EXPECT_NE(d1, d2);
     EXPECT_NE(d2, d1);
 
+    // Compare to function pointers
+    EXPECT_TRUE(d1 == &InlinedSimpleFunction2);
+    EXPECT_TRUE(d2 == &StaticSimpleFunction3);
+    EXPECT_TRUE(d1 != &SimpleFunction1);
+    EXPECT_FALSE(d1 == nullptr);
+
+    NonVirtualClass1 c1;
+    DelegateType m1(c1, &NonVirtualClass1::Method1);
+    EXPECT_NE(m1, d1);
+    EXPECT_TRUE(m1 != &SimpleFunction1);
+
     // Empty compare equal to each other
     DelegateType e1, e2;
     Dump(e1, e2);
     EXPECT_EQ(e1, e2);
     EXPECT_NE(d1, e1);
+    EXPECT_TRUE(e1 == nullptr);
+    EXPECT_TRUE(e1 != &SimpleFunction1);
 
     EXPECT_TRUE(e1.empty());
     EXPECT_FALSE(d1.empty());
@@ -453,6 +467,57 @@ TEST_F(DelegateTestFramework, testLambda)
     Dump(d1, d2, d3);
 }
 
+TEST_F(DelegateTestFramework, testCompileTimeMethods)
+{
+    NonVirtualClass1 c1, c2;
+    const NonVirtualClass1& cc1 = c1;
+    DerivedNonVirtualClass1 d1;
+
+    static_assert(sizeof(DelegateType) == sizeof(MakeDelegate<&NonVirtualClass1::Method1>(c1)),
+                  "Compile time delegates use the same storage");
+
+    std::vector<DelegateType> ds;
+    ds.push_back(MakeDelegate<&NonVirtualClass1::Method1>(c1));
+    ds.push_back(MakeDelegate<&NonVirtualClass1::InlineMethod2>(&c1));
+    ds.push_back(MakeDelegate<&NonVirtualClass1::ConstMethod3>(cc1));
+    ds.push_back(MakeDelegate<&NonVirtualClass1::ConstMethod3>(&cc1));
+    ds.push_back(MakeDelegate<&NonVirtualClass1::Method1>(c2));
+    ds.push_back(MakeDelegate<&NonVirtualClass1::Method1>(d1));
+    ds.push_back(MakeDelegate<&DerivedNonVirtualClass1::Method4>(d1));
+    DelegateType d;
+    d.bind<&DerivedNonVirtualClass1::InlineMethod2>(d1);
+    ds.push_back(d);
+    Dump(ds);
+
+    // Identical bindings
+    EXPECT_EQ(ds[0], MakeDelegate<&NonVirtualClass1::Method1>(&c1));
+    EXPECT_EQ(ds[2], ds[3]);
+
+    // Different methods, same object
+    EXPECT_NE(ds[0], ds[1]);
+
+    // Same method, different object
+    EXPECT_NE(ds[0], ds[4]);
+
+    Expect("NVC.Method1", -1.1, 1000, "a", "A");
+    Expect("NVC.InlineMethod2", -2.2, 100, "b", "B");
+    Expect("NVC.ConstMethod3", -3.3, 10, "c", "C");
+    Expect("NVC.ConstMethod3", -4.4, 2000, "d", "D");
+    Expect("NVC.Method1", -5.5, 200, "e", "E");
+    Expect("NVC.Method1", -6.6, 20, "f", "F");
+    Expect("DNVC.Method4", -7.7, 30, "g", "G");
+    Expect("DNVC.InlineMethod2", -8.8, 40, "h", "H");
+
+    EXPECT_DOUBLE_EQ(-1.1, ds[0](1000, "a", "A"));
+    EXPECT_DOUBLE_EQ(-2.2, ds[1](100, "b", "B"));
+    EXPECT_DOUBLE_EQ(-3.3, ds[2](10, "c", "C"));
+    EXPECT_DOUBLE_EQ(-4.4, ds[3](2000, "d", "D"));
+    EXPECT_DOUBLE_EQ(-5.5, ds[4](200, "e", "E"));
+    EXPECT_DOUBLE_EQ(-6.6, ds[5](20, "f", "F"));
+    EXPECT_DOUBLE_EQ(-7.7, ds[6](30, "g", "G"));
+    EXPECT_DOUBLE_EQ(-8.8, ds[7](40, "h", "H"));
+}
+
 struct MoveMethodTester
 {
     void Method1(std::string&& s)
@@ -483,7 +548,7 @@ TEST_F(DelegateTestFramework, testMoveInvoke)
     d = +[](std::string&& s) -> void { g_received_move.emplace_back(std::move(s)); };
     Dump(d);
 
-    A = "A";
+    A = std::string("A");
 
     d(std::move(A));
     d(std::move(A));
@@ -492,6 +557,157 @@ TEST_F(DelegateTestFramework, testMoveInvoke)
     EXPECT_EQ(g_received_move[1], "");
 }
 
+// Counts the copies and moves made of an argument
+struct CopyCounter
+{
+    static int copies;
+    static int moves;
+    static void Reset() { copies = 0; moves = 0; }
+
+    CopyCounter() = default;
+    CopyCounter(const CopyCounter&) { ++copies; }
+    CopyCounter(CopyCounter&&) noexcept { ++moves; }
+};
+
+int CopyCounter::copies = 0;
+int CopyCounter::moves = 0;
+
+struct CopyCounterTester
+{
+    void ByValue(CopyCounter) { ++calls; }
+    void ByReference(const CopyCounter&) { ++calls; }
+    static void StaticByValue(CopyCounter) {}
+
+    int calls = 0;
+};
+
+struct ConvertsToCounter
+{
+    operator CopyCounter() const { return CopyCounter(); }
+};
+
+TEST_F(DelegateTestFramework, testMoveInvokeCopies)
+{
+    CopyCounterTester t;
+    CopyCounter c;
+
+    // Direct calls, for reference: lvalues are copied once, rvalues moved once
+    CopyCounter::Reset();
+    t.ByValue(c);
+    EXPECT_EQ(1, CopyCounter::copies);
+    EXPECT_EQ(0, CopyCounter::moves);
+
+    // The same through delegates
+    Delegate<void(CopyCounter)> d = MakeDelegate(t, &CopyCounterTester::ByValue);
+    CopyCounter::Reset();
+    d(c);
+    EXPECT_EQ(1, CopyCounter::copies);
+    EXPECT_EQ(0, CopyCounter::moves);
+
+    CopyCounter::Reset();
+    d(std::move(c));
+    EXPECT_EQ(0, CopyCounter::copies);
+    EXPECT_EQ(1, CopyCounter::moves);
+
+    const CopyCounter& cc = c;
+    CopyCounter::Reset();
+    d(cc);
+    EXPECT_EQ(1, CopyCounter::copies);
+    EXPECT_EQ(0, CopyCounter::moves);
+
+    CopyCounter::Reset();
+    d(CopyCounter());
+    EXPECT_EQ(0, CopyCounter::copies);
+    EXPECT_EQ(1, CopyCounter::moves);
+
+    // Conversions happen once, then the result is moved
+    CopyCounter::Reset();
+    d(ConvertsToCounter());
+    EXPECT_EQ(0, CopyCounter::copies);
+    EXPECT_EQ(1, CopyCounter::moves);
+
+    d = &CopyCounterTester::StaticByValue;
+    CopyCounter::Reset();
+    d(c);
+    EXPECT_EQ(1, CopyCounter::copies);
+    EXPECT_EQ(0, CopyCounter::moves);
+
+    CopyCounter::Reset();
+    d(std::move(c));
+    EXPECT_EQ(0, CopyCounter::copies);
+    EXPECT_EQ(1, CopyCounter::moves);
+
+    // References are passed through
+    Delegate<void(const CopyCounter&)> r = MakeDelegate(t, &CopyCounterTester::ByReference);
+    CopyCounter::Reset();
+    r(c);
+    EXPECT_EQ(0, CopyCounter::copies);
+    EXPECT_EQ(0, CopyCounter::moves);
+
+    // Batches copy each element once
+    std::vector<CopyCounter> batch(3);
+    CopyCounter::Reset();
+    MakeDelegate(t, &CopyCounterTester::ByValue).invokeEach(batch);
+    EXPECT_EQ(3, CopyCounter::copies);
+    EXPECT_EQ(0, CopyCounter::moves);
+    EXPECT_EQ(10, t.calls);
+}
+
+TEST_F(DelegateTestFramework, testMoveOnlyInvoke)
+{
+    int received = 0;
+    auto receiver = [&received](std::unique_ptr<int> p) { received = *p; };
+    Delegate<void(std::unique_ptr<int>)> d;
+    d.bind<&decltype(receiver)::operator()>(receiver);
+
+    d(std::unique_ptr<int>(new int(42)));
+    EXPECT_EQ(42, received);
+
+    std::unique_ptr<int> p(new int(7));
+    d(std::move(p));
+    EXPECT_EQ(7, received);
+    EXPECT_FALSE(p);
+}
+
+// Parameter types may still be incomplete where a delegate is declared
+struct LateMessage;
+
+struct LateMessageHolder
+{
+    Delegate<void(LateMessage)> byValue;
+    Delegate<void(const LateMessage&)> byReference;
+};
+
+struct LateMessage { std::string text; };
+
+TEST_F(DelegateTestFramework, testIncompleteParameters)
+{
+    std::string received;
+    auto receiver = [&received](LateMessage m) { received = m.text; };
+    LateMessageHolder h;
+    h.byValue.bind<&decltype(receiver)::operator()>(receiver);
+
+    h.byValue(LateMessage{ "late" });
+    EXPECT_EQ("late", received);
+
+    const LateMessage m{ "const" };
+    h.byValue(m);
+    EXPECT_EQ("const", received);
+}
+
+TEST_F(DelegateTestFramework, testBracedArguments)
+{
+    size_t received = 0;
+    auto receiver = [&received](int first, std::vector<int> v) { received = size_t(first) + v.size(); };
+    Delegate<void(int, std::vector<int>)> d;
+    d.bind<&decltype(receiver)::operator()>(receiver);
+
+    d(10, { 1, 2, 3 });
+    EXPECT_EQ(13u, received);
+    d(20, {});
+    EXPECT_EQ(20u, received);
+}
+
 struct BaseVirtualClass1
 {
     static constexpr size_t MAGIC = 0xBEEF0002;
@@ -615,6 +831,159 @@ TEST_F(DelegateTestFramework, testVirtualMethods)
     EXPECT_DOUBLE_EQ(16, ds[15](26, "p", "P"));
 }
 
+TEST_F(DelegateTestFramework, testResolvedVirtualMethods)
+{
+    DerivedVirtualClass1 c1, c2;
+    BaseVirtualClass1* b1 = &c1;
+    BaseVirtualClass1* b2 = &c2;
+
+    std::vector<DelegateType> ds;
+    ds.push_back(MakeResolvedDelegate(&c1, &DerivedVirtualClass1::NonVirtualMethod1));
+    ds.push_back(MakeResolvedDelegate(&c1, &DerivedVirtualClass1::PureVirtualBase1));
+    ds.push_back(MakeResolvedDelegate(&c1, &DerivedVirtualClass1::VirtualMethod3));
+    ds.push_back(MakeResolvedDelegate(c2, &DerivedVirtualClass1::PureVirtualBase2));
+    ds.push_back(MakeResolvedDelegate(b1, &BaseVirtualClass1::NonVirtualMethod1));
+    ds.push_back(MakeResolvedDelegate(b1, &BaseVirtualClass1::PureVirtualBase1));
+    ds.push_back(MakeResolvedDelegate(b2, &BaseVirtualClass1::PureVirtualBase2));
+    ds.push_back(MakeResolvedDelegate(*b2, &BaseVirtualClass1::VirtualMethod3));
+    Dump(ds);
+
+    // Resolving is deterministic
+    EXPECT_EQ(ds[1], MakeResolvedDelegate(&c1, &DerivedVirtualClass1::PureVirtualBase1));
+    EXPECT_EQ(ds[5], MakeResolvedDelegate(b1, &BaseVirtualClass1::PureVirtualBase1));
+
+    // Non-virtual methods resolve to the same binding
+    EXPECT_EQ(ds[0], MakeDelegate(&c1, &DerivedVirtualClass1::NonVirtualMethod1));
+
+    // Virtual methods no longer refer to a vtable slot
+    EXPECT_NE(ds[1], MakeDelegate(&c1, &DerivedVirtualClass1::PureVirtualBase1));
+
+    // Instances are different
+    EXPECT_NE(ds[1], MakeResolvedDelegate(&c2, &DerivedVirtualClass1::PureVirtualBase1));
+
+    DelegateType d;
+    d.bindResolved(b2, &BaseVirtualClass1::VirtualMethod3);
+    EXPECT_EQ(d, ds[7]);
+
+    Expect("DVC.NonVirtualMethod1", 1, 11, "a", "A");
+    Expect("DVC.PureVirtualBase1",  2, 12, "b", "B");
+    Expect("DVC.VirtualMethod3",    3, 13, "c", "C");
+    Expect("DVC.PureVirtualBase2",  4, 14, "d", "D");
+    Expect("BVC.NonVirtualMethod1", 5, 15, "e", "E");
+    Expect("DVC.PureVirtualBase1",  6, 16, "f", "F");
+    Expect("DVC.PureVirtualBase2",  7, 17, "g", "G");
+    Expect("DVC.VirtualMethod3",    8, 18, "h", "H");
+
+    EXPECT_DOUBLE_EQ(1, ds[0](11, "a", "A"));
+    EXPECT_DOUBLE_EQ(2, ds[1](12, "b", "B"));
+    EXPECT_DOUBLE_EQ(3, ds[2](13, "c", "C"));
+    EXPECT_DOUBLE_EQ(4, ds[3](14, "d", "D"));
+    EXPECT_DOUBLE_EQ(5, ds[4](15, "e", "E"));
+    EXPECT_DOUBLE_EQ(6, ds[5](16, "f", "F"));
+    EXPECT_DOUBLE_EQ(7, ds[6](17, "g", "G"));
+    EXPECT_DOUBLE_EQ(8, ds[7](18, "h", "H"));
+}
+
+TEST_F(DelegateTestFramework, testCompileTimeVirtualMethods)
+{
+    DerivedVirtualClass1 c1;
+    BaseVirtualClass1* b1 = &c1;
+
+    std::vector<DelegateType> ds;
+    ds.push_back(MakeDelegate<&DerivedVirtualClass1::NonVirtualMethod1>(c1));
+    ds.push_back(MakeDelegate<&DerivedVirtualClass1::PureVirtualBase1>(c1));
+    ds.push_back(MakeDelegate<&BaseVirtualClass1::NonVirtualMethod1>(b1));
+    ds.push_back(MakeDelegate<&BaseVirtualClass1::PureVirtualBase2>(b1));
+    ds.push_back(MakeDelegate<&BaseVirtualClass1::VirtualMethod3>(c1));
+    Dump(ds);
+
+    Expect("DVC.NonVirtualMethod1", 1, 11, "a", "A");
+    Expect("DVC.PureVirtualBase1",  2, 12, "b", "B");
+    Expect("BVC.NonVirtualMethod1", 3, 13, "c", "C");
+    Expect("DVC.PureVirtualBase2",  4, 14, "d", "D");
+    Expect("DVC.VirtualMethod3",    5, 15, "e", "E");
+
+    EXPECT_DOUBLE_EQ(1, ds[0](11, "a", "A"));
+    EXPECT_DOUBLE_EQ(2, ds[1](12, "b", "B"));
+    EXPECT_DOUBLE_EQ(3, ds[2](13, "c", "C"));
+    EXPECT_DOUBLE_EQ(4, ds[3](14, "d", "D"));
+    EXPECT_DOUBLE_EQ(5, ds[4](15, "e", "E"));
+}
+
+TEST_F(DelegateTestFramework, testInvokeBatch)
+{
+    DerivedVirtualClass1 c1;
+    BaseVirtualClass1* b1 = &c1;
+
+    using Args = std::tuple<int, const char*, std::string>;
+    std::vector<Args> batch = { Args{11, "a", "A"}, Args{12, "b", "B"} };
+
+    Expect("DVC.PureVirtualBase1",  0, 11, "a", "A");
+    Expect("DVC.PureVirtualBase1",  0, 12, "b", "B");
+    MakeDelegate(b1, &BaseVirtualClass1::PureVirtualBase1).invokeBatch(batch);
+
+    Expect("BVC.NonVirtualMethod1", 0, 11, "a", "A");
+    Expect("BVC.NonVirtualMethod1", 0, 12, "b", "B");
+    MakeDelegate(b1, &BaseVirtualClass1::NonVirtualMethod1).invokeBatch(batch.data(), batch.size());
+
+    Expect("DVC.VirtualMethod3",    0, 11, "a", "A");
+    Expect("DVC.VirtualMethod3",    0, 12, "b", "B");
+    MakeResolvedDelegate(b1, &BaseVirtualClass1::VirtualMethod3).invokeBatch(batch);
+
+    Expect("DVC.PureVirtualBase2",  0, 11, "a", "A");
+    Expect("DVC.PureVirtualBase2",  0, 12, "b", "B");
+    MakeDelegate<&BaseVirtualClass1::PureVirtualBase2>(b1).invokeBatch(batch);
+
+    Expect("SimpleFunction1",       0, 11, "a", "A");
+    Expect("SimpleFunction1",       0, 12, "b", "B");
+    MakeDelegate(&SimpleFunction1).invokeBatch(batch);
+
+    // Empty batch
+    MakeDelegate(&SimpleFunction1).invokeBatch(std::vector<Args>());
+}
+
+struct Accumulator
+{
+    virtual ~Accumulator() = default;
+    virtual void Add(int value) { total += value; }
+
+    int total = 0;
+};
+
+struct DoubleAccumulator : public OtherStuff<4>, public Accumulator
+{
+    void Add(int value) override { total += 2 * value; }
+};
+
+static int g_accumulated = 0;
+static void Accumulate(int value) { g_accumulated += value; }
+
+TEST(Delegate, testInvokeEach)
+{
+    std::vector<int> values = { 1, 2, 3, 4 };
+
+    DoubleAccumulator a;
+    Accumulator* base = &a;
+    MakeDelegate(base, &Accumulator::Add).invokeEach(values);
+    EXPECT_EQ(20, a.total);
+
+    Accumulator b;
+    MakeDelegate(b, &Accumulator::Add).invokeEach(values);
+    EXPECT_EQ(10, b.total);
+
+    g_accumulated = 0;
+    MakeDelegate(&Accumulate).invokeEach(values);
+    EXPECT_EQ(10, g_accumulated);
+
+    // Capturing lambda as the target
+    int count = 0;
+    auto counter = [&count](int) { ++count; };
+    Delegate<void(int)> d;
+    d.bind<&decltype(counter)::operator()>(counter);
+    d.invokeEach(values);
+    EXPECT_EQ(4, count);
+}
+
 struct VirtualDerivedVirtualClass1 : public OtherStuff<0xabcd>, public virtual BaseVirtualClass1
 {
     static constexpr size_t MAGIC = 0xBEEF0005;
@@ -719,3 +1088,130 @@ TEST_F(DelegateTestFramework, testVirtualInheritanceMethods)
     EXPECT_DOUBLE_EQ(16, ds[15](26, "p", "P"));
 }
 
+TEST_F(DelegateTestFramework, testResolvedVirtualInheritanceMethods)
+{
+    VirtualDerivedVirtualClass3 c1, c2;
+    BaseVirtualClass1* b1 = &c1;
+    BaseVirtualClass1* b2 = &c2;
+
+    std::vector<DelegateType> ds;
+    ds.push_back(MakeResolvedDelegate(&c1, &VirtualDerivedVirtualClass3::NonVirtualMethod1));
+    ds.push_back(MakeResolvedDelegate(&c1, &VirtualDerivedVirtualClass3::PureVirtualBase1));
+    ds.push_back(MakeResolvedDelegate(&c1, &VirtualDerivedVirtualClass3::VirtualMethod3));
+    ds.push_back(MakeResolvedDelegate(c2, &VirtualDerivedVirtualClass3::PureVirtualBase2));
+    ds.push_back(MakeResolvedDelegate(b1, &BaseVirtualClass1::NonVirtualMethod1));
+    ds.push_back(MakeResolvedDelegate(b1, &BaseVirtualClass1::PureVirtualBase1));
+    ds.push_back(MakeResolvedDelegate(b2, &BaseVirtualClass1::PureVirtualBase2));
+    ds.push_back(MakeResolvedDelegate(*b2, &BaseVirtualClass1::VirtualMethod3));
+    Dump(ds);
+
+    EXPECT_EQ(ds[1], MakeResolvedDelegate(&c1, &VirtualDerivedVirtualClass3::PureVirtualBase1));
+    EXPECT_EQ(ds[5], MakeResolvedDelegate(b1, &BaseVirtualClass1::PureVirtualBase1));
+    EXPECT_NE(ds[1], MakeResolvedDelegate(&c2, &VirtualDerivedVirtualClass3::PureVirtualBase1));
+    EXPECT_NE(ds[5], MakeResolvedDelegate(b2, &BaseVirtualClass1::PureVirtualBase1));
+
+    Expect("VDVC.NonVirtualMethod1", 1, 11, "a", "A");
+    Expect("VDVC.PureVirtualBase1",  2, 12, "b", "B");
+    Expect("VDVC.VirtualMethod3",    3, 13, "c", "C");
+    Expect("VDVC.PureVirtualBase2",  4, 14, "d", "D");
+    Expect("BVC.NonVirtualMethod1",  5, 15, "e", "E");
+    Expect("VDVC.PureVirtualBase1",  6, 16, "f", "F");
+    Expect("VDVC.PureVirtualBase2",  7, 17, "g", "G");
+    Expect("VDVC.VirtualMethod3",    8, 18, "h", "H");
+
+    EXPECT_DOUBLE_EQ(1, ds[0](11, "a", "A"));
+    EXPECT_DOUBLE_EQ(2, ds[1](12, "b", "B"));
+    EXPECT_DOUBLE_EQ(3, ds[2](13, "c", "C"));
+    EXPECT_DOUBLE_EQ(4, ds[3](14, "d", "D"));
+    EXPECT_DOUBLE_EQ(5, ds[4](15, "e", "E"));
+    EXPECT_DOUBLE_EQ(6, ds[5](16, "f", "F"));
+    EXPECT_DOUBLE_EQ(7, ds[6](17, "g", "G"));
+    EXPECT_DOUBLE_EQ(8, ds[7](18, "h", "H"));
+}
+
+TEST_F(DelegateTestFramework, testCompileTimeVirtualInheritanceMethods)
+{
+    VirtualDerivedVirtualClass3 c1;
+    BaseVirtualClass1* b1 = &c1;
+
+    std::vector<DelegateType> ds;
+    ds.push_back(MakeDelegate<&VirtualDerivedVirtualClass3::NonVirtualMethod1>(c1));
+    ds.push_back(MakeDelegate<&VirtualDerivedVirtualClass3::PureVirtualBase1>(c1));
+    ds.push_back(MakeDelegate<&BaseVirtualClass1::NonVirtualMethod1>(c1));
+    ds.push_back(MakeDelegate<&BaseVirtualClass1::PureVirtualBase2>(b1));
+    ds.push_back(MakeDelegate<&BaseVirtualClass1::VirtualMethod3>(b1));
+    Dump(ds);
+
+    Expect("VDVC.NonVirtualMethod1", 1, 11, "a", "A");
+    Expect("VDVC.PureVirtualBase1",  2, 12, "b", "B");
+    Expect("BVC.NonVirtualMethod1",  3, 13, "c", "C");
+    Expect("VDVC.PureVirtualBase2",  4, 14, "d", "D");
+    Expect("VDVC.VirtualMethod3",    5, 15, "e", "E");
+
+    EXPECT_DOUBLE_EQ(1, ds[0](11, "a", "A"));
+    EXPECT_DOUBLE_EQ(2, ds[1](12, "b", "B"));
+    EXPECT_DOUBLE_EQ(3, ds[2](13, "c", "C"));
+    EXPECT_DOUBLE_EQ(4, ds[3](14, "d", "D"));
+    EXPECT_DOUBLE_EQ(5, ds[4](15, "e", "E"));
+}
+
+// Delegate tables of free functions and compile time methods are constant
+// initialized: constinit fails to compile if any entry needed a dynamic
+// initializer, and the tables are emitted as read-only data.
+struct Opcodes
+{
+    int Add(int value) { return total += value; }
+    int Get(int) const { return total; }
+
+    int total = 0;
+};
+
+static Opcodes g_opcodes;
+static DoubleAccumulator g_double_accumulator;
+static int Negate(int value) { return -value; }
+
+static constinit const Delegate<int(int)> g_opcode_table[] = {
+    &Negate,
+    +[](int value) { return value * 2; },
+    MakeDelegate<&Opcodes::Add>(g_opcodes),
+    MakeDelegate<&Opcodes::Get>(&g_opcodes),
+    nullptr,
+};
+
+static constinit Delegate<void(int)> g_accumulate = MakeDelegate<&Accumulator::Add>(g_double_accumulator);
+static constinit Delegate<void(int)> g_empty;
+
+static_assert(std::is_trivially_copyable<Delegate<int(int)>>::value);
+static_assert(std::is_trivially_destructible<Delegate<int(int)>>::value);
+
+TEST(Delegate, testConstantInitialization)
+{
+    EXPECT_EQ(-3, g_opcode_table[0](3));
+    EXPECT_EQ(8, g_opcode_table[1](4));
+    EXPECT_EQ(5, g_opcode_table[2](5));
+    EXPECT_EQ(7, g_opcode_table[2](2));
+    EXPECT_EQ(7, g_opcode_table[3](0));
+    EXPECT_TRUE(g_opcode_table[4].empty());
+
+    // Same as delegates bound at run time
+    EXPECT_TRUE(g_opcode_table[0] == &Negate);
+    EXPECT_TRUE(g_opcode_table[0] == Delegate<int(int)>(&Negate));
+    EXPECT_TRUE(g_opcode_table[2] == MakeDelegate<&Opcodes::Add>(g_opcodes));
+    EXPECT_TRUE(g_opcode_table[2] != g_opcode_table[3]);
+
+    Delegate<int(int)> bound;
+    bound.bind<&Opcodes::Get>(g_opcodes);
+    EXPECT_TRUE(g_opcode_table[3] == bound);
+
+    // Virtual compile time method of a base class
+    g_double_accumulator.total = 0;
+    g_accumulate(2);
+    g_accumulate(3);
+    EXPECT_EQ(10, g_double_accumulator.total);
+    EXPECT_TRUE(g_empty.empty());
+
+    // Constant expressions
+    constexpr Delegate<int(int)> negate(&Negate);
+    constexpr Delegate<int(int)> copy = negate;
+    EXPECT_EQ(-1, copy(1));
+}
@@ -0,0 +1,237 @@
+#include "gtest/gtest.h"
+
+// Built in its own executable, with DELEGATE_TRACING set to 1
+#include "Delegate.h"
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace delly;
+
+static_assert(DELEGATE_TRACING, "DelegateTracerTests must be built with DELEGATE_TRACING=1");
+
+namespace {
+
+struct Point { int x, y; };
+
+int g_calls = 0;
+__attribute__((noinline)) void Traced(int n, Point p) { g_calls += n + p.x + p.y; }
+__attribute__((noinline)) void Untraced(int n, Point) { g_calls += n; }
+
+struct Session
+{
+    __attribute__((noinline)) void OnRequest(int id, const std::string& path) { total += id + long(path.size()); }
+    __attribute__((noinline)) void OnBatch(int count) {
+        for (int i = 0; i < count; ++i)
+            request(i, "/");
+    }
+
+    Delegate<void(int, const std::string&)> request;
+    long total = 0;
+};
+
+class TraceDirectory {
+public:
+    TraceDirectory() {
+        char path[] = "/tmp/delegate-traces-XXXXXX";
+        m_path = mkdtemp(path);
+    }
+
+    ~TraceDirectory() {
+        for (const auto& file : DelegateTracer::Files())
+            unlink(file.c_str());
+        rmdir(m_path.c_str());
+    }
+
+    const std::string& path() const { return m_path; }
+
+private:
+    std::string m_path;
+};
+
+// The file of the calling thread, after tracing stopped
+DelegateTraceReader ReadThisThread() {
+    const uint32_t tid = uint32_t(syscall(SYS_gettid));
+    for (const auto& file : DelegateTracer::Files()) {
+        DelegateTraceReader reader(file);
+        if (reader.valid() && reader.header().tid == tid)
+            return reader;
+    }
+    return DelegateTraceReader();
+}
+
+} // end anonymous namespace
+
+TEST(DelegateTracer, testSelectedTargets)
+{
+    TraceDirectory directory;
+    Delegate<void(int, Point)> traced(&Traced);
+    Delegate<void(int, Point)> untraced(&Untraced);
+    DelegateTracer::ClearSelection();
+    DelegateTracer::Select(traced);
+
+    traced(1, Point{ 2, 3 });
+    ASSERT_TRUE(DelegateTracer::Start(directory.path()));
+    for (int i = 0; i < 5; ++i) {
+        traced(i, Point{ 10, 20 });
+        untraced(i, Point{});
+    }
+    DelegateTracer::Stop();
+    traced(1, Point{ 2, 3 });
+
+    DelegateTraceReader reader = ReadThisThread();
+    ASSERT_TRUE(reader.valid());
+    EXPECT_EQ(reader.header().records, 5u);
+    EXPECT_EQ(reader.header().pid, uint32_t(getpid()));
+    EXPECT_GT(reader.nanosecondsPerCycle(), 0);
+    ASSERT_EQ(reader.size(), 5u);
+
+    int i = 0;
+    uint64_t previous = 0;
+    for (const DelegateTraceRecord& r : reader) {
+        EXPECT_EQ(r.code, reinterpret_cast<uintptr_t>(&Traced));
+        EXPECT_EQ(r.object, 0u);
+        EXPECT_EQ(r.depth, 0u);
+        EXPECT_GT(r.start, previous);
+        previous = r.start;
+
+        ASSERT_EQ(r.argCount, 2u);
+        ASSERT_EQ(r.argBytes, sizeof(int) + sizeof(Point));
+        int n;
+        Point p;
+        memcpy(&n, r.args, sizeof(n));
+        memcpy(&p, r.args + sizeof(n), sizeof(p));
+        EXPECT_EQ(n, i++);
+        EXPECT_EQ(p.x, 10);
+        EXPECT_EQ(p.y, 20);
+    }
+    DelegateTracer::ClearSelection();
+}
+
+TEST(DelegateTracer, testNestedCalls)
+{
+    TraceDirectory directory;
+    Session s;
+    s.request = MakeDelegate<&Session::OnRequest>(s);
+    auto batch = MakeDelegate<&Session::OnBatch>(s);
+    DelegateTracer::ClearSelection();
+    DelegateTracer::SelectAll();
+
+    ASSERT_TRUE(DelegateTracer::Start(directory.path()));
+    batch(3);
+    DelegateTracer::Stop();
+    DelegateTracer::ClearSelection();
+
+    DelegateTraceReader reader = ReadThisThread();
+    ASSERT_EQ(reader.size(), 4u);
+    const DelegateTraceRecord* r = reader.begin();
+    EXPECT_EQ(r[0].depth, 0u);
+    EXPECT_EQ(r[0].object, reinterpret_cast<uintptr_t>(&s));
+    EXPECT_EQ(r[0].argCount, 1u);
+    for (int i = 1; i < 4; ++i) {
+        EXPECT_EQ(r[i].depth, 1u);
+        EXPECT_NE(r[i].code, r[0].code);
+        // The string is not trivially copyable, only the id is kept
+        EXPECT_EQ(r[i].argCount, 1u);
+        EXPECT_GE(r[i].start, r[i - 1].start);
+        EXPECT_LE(r[i].start + r[i].cycles, r[0].start + r[0].cycles);
+    }
+}
+
+TEST(DelegateTracer, testBatchCalls)
+{
+    TraceDirectory directory;
+    Delegate<void(int, Point)> traced(&Traced);
+    DelegateTracer::ClearSelection();
+    DelegateTracer::Select(traced);
+
+    const std::vector<std::tuple<int, Point>> calls = { { 1, Point{ 2, 3 } }, { 4, Point{ 5, 6 } } };
+    ASSERT_TRUE(DelegateTracer::Start(directory.path()));
+    traced.invokeBatch(calls);
+    traced.invokeBatch(calls.data(), 1);
+    DelegateTracer::Stop();
+    DelegateTracer::ClearSelection();
+
+    DelegateTraceReader reader = ReadThisThread();
+    ASSERT_EQ(reader.size(), 3u);
+    const int expected[] = { 1, 4, 1 };
+    for (size_t i = 0; i < 3; ++i) {
+        const DelegateTraceRecord& r = reader.begin()[i];
+        EXPECT_EQ(r.code, reinterpret_cast<uintptr_t>(&Traced));
+        ASSERT_EQ(r.argCount, 2u);
+        int n;
+        memcpy(&n, r.args, sizeof(n));
+        EXPECT_EQ(n, expected[i]);
+    }
+}
+
+TEST(DelegateTracer, testThreadFiles)
+{
+    TraceDirectory directory;
+    Delegate<void(int, Point)> traced(&Traced);
+    DelegateTracer::ClearSelection();
+    DelegateTracer::Select(traced);
+    ASSERT_TRUE(DelegateTracer::Start(directory.path()));
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t <= 3; ++t) {
+        threads.emplace_back([traced, t]() {
+            for (int i = 0; i < 100 * t; ++i)
+                traced(t, Point{});
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    DelegateTracer::Stop();
+    DelegateTracer::ClearSelection();
+
+    // Completed when their threads exited
+    const auto files = DelegateTracer::Files();
+    ASSERT_EQ(files.size(), 3u);
+    size_t total = 0;
+    for (const auto& file : files) {
+        DelegateTraceReader reader(file);
+        ASSERT_TRUE(reader.valid());
+        EXPECT_EQ(reader.header().records, reader.size());
+        EXPECT_NE(reader.header().tid, uint32_t(syscall(SYS_gettid)));
+        int t;
+        memcpy(&t, reader.begin()->args, sizeof(t));
+        EXPECT_EQ(reader.size(), size_t(100 * t));
+        total += reader.size();
+    }
+    EXPECT_EQ(total, 600u);
+}
+
+TEST(DelegateTracer, testCallsAcrossChunks)
+{
+    // The outer call outlives the chunk holding its record
+    TraceDirectory directory;
+    Session s;
+    s.request = MakeDelegate<&Session::OnRequest>(s);
+    auto batch = MakeDelegate<&Session::OnBatch>(s);
+    DelegateTracer::ClearSelection();
+    DelegateTracer::SelectAll();
+
+    const int calls = int(details::TraceWriter::ChunkRecords) + 100;
+    ASSERT_TRUE(DelegateTracer::Start(directory.path()));
+    batch(calls);
+    DelegateTracer::Stop();
+    DelegateTracer::ClearSelection();
+
+    DelegateTraceReader reader = ReadThisThread();
+    ASSERT_EQ(reader.size(), size_t(calls) + 1);
+    const DelegateTraceRecord& outer = *reader.begin();
+    const DelegateTraceRecord& last = *(reader.end() - 1);
+    EXPECT_GT(outer.cycles, 0u);
+    EXPECT_GT(last.cycles, 0u);
+    EXPECT_LE(last.start + last.cycles, outer.start + outer.cycles);
+}
+
+TEST(DelegateTracer, testMissingDirectory)
+{
+    EXPECT_FALSE(DelegateTracer::Start("/nonexistent/delegate-traces"));
+    EXPECT_FALSE(DelegateTracer::Started());
+    EXPECT_FALSE(DelegateTraceReader("/nonexistent/delegates.trace").valid());
+}
@@ -0,0 +1,149 @@
+#include "gtest/gtest.h"
+
+#include "DispatchArray.h"
+#include <vector>
+
+using namespace delly;
+
+namespace {
+
+enum class State { Idle, Open, Closing, Count };
+
+struct Connection
+{
+    State onIdle(int event) { log.push_back(event); return event ? State::Open : State::Idle; }
+    State onOpen(int event) { log.push_back(10 + event); return event ? State::Closing : State::Open; }
+    State onClosing(int event) { log.push_back(20 + event); return State::Idle; }
+
+    std::vector<int> log;
+};
+
+Connection g_connection;
+
+constinit const auto g_states = MakeDispatchArray<State,
+    &Connection::onIdle, &Connection::onOpen, &Connection::onClosing>(g_connection);
+
+// A bytecode with opcodes returning the next opcode
+enum class Op : unsigned char { Inc, Double, Halt, Count };
+
+struct Machine
+{
+    Op onInc() { ++acc; return code[++pc]; }
+    Op onDouble() { acc *= 2; return code[++pc]; }
+
+    const Op* code = nullptr;
+    size_t pc = 0;
+    int acc = 0;
+};
+
+int Decrement(int value) { return value - 1; }
+
+// Declared only, when the dispatch array type is
+struct LateEvent;
+struct LateConnection { DispatchArray<State, void(LateEvent)> handlers; };
+struct LateEvent { std::vector<int> values; };
+
+size_t g_received = 0;
+void OnEvent(LateEvent e) { g_received += e.values.size(); }
+void OnValues(std::vector<int> values) { g_received += 10 * values.size(); }
+
+} // end anonymous namespace
+
+TEST(DispatchArray, testConstantInitialization)
+{
+    static_assert(std::is_same<decltype(g_states), const DispatchArray<State, State(int)>>::value);
+    static_assert(g_states.size() == 3);
+    g_connection.log.clear();
+
+    State s = State::Idle;
+    for (int event : { 0, 1, 0, 1, 5 })
+        s = g_states(s, event);
+    EXPECT_EQ(s, State::Idle);
+    EXPECT_EQ(g_connection.log, (std::vector<int>{ 0, 1, 10, 11, 25 }));
+
+    EXPECT_TRUE(g_states[State::Open] == MakeDelegate<&Connection::onOpen>(g_connection));
+    for (State key : { State::Idle, State::Open, State::Closing })
+        EXPECT_TRUE(g_states.contains(key));
+}
+
+TEST(DispatchArray, testEntries)
+{
+    enum class Key { A, B, C, D };
+    constexpr DispatchArray<Key, int(int), 4> a = {
+        { Key::C, +[](int v) { return v * 3; } },
+        { Key::A, &Decrement },
+    };
+    EXPECT_EQ(a(Key::A, 5), 4);
+    EXPECT_EQ(a(Key::C, 5), 15);
+    EXPECT_FALSE(a.contains(Key::B));
+    EXPECT_FALSE(a.contains(Key::D));
+    EXPECT_FALSE(a.contains(Key(7)));
+
+    DispatchArray<Key, int(int), 4> b = a;
+    b.set(Key::B, &Decrement);
+    EXPECT_EQ(b(Key::B, 1), 0);
+
+    size_t handlers = 0;
+    for (const auto& d : b)
+        handlers += !d.empty();
+    EXPECT_EQ(handlers, 3u);
+}
+
+TEST(DispatchArray, testThreadedDispatch)
+{
+    const Op code[] = { Op::Inc, Op::Double, Op::Inc, Op::Double, Op::Double, Op::Halt };
+    Machine m;
+    m.code = code;
+    const auto ops = DispatchArray<Op, Op()>::FromMethods<&Machine::onInc, &Machine::onDouble>(m);
+    EXPECT_FALSE(ops.contains(Op::Halt));
+    ops.run(code[0], Op::Halt);
+    EXPECT_EQ(m.acc, 12);
+    EXPECT_EQ(m.pc, 5u);
+}
+
+TEST(DispatchArray, testUnboundMethods)
+{
+    constexpr auto ops = MakeDispatchArray<Op, &Machine::onInc, &Machine::onDouble>();
+    static_assert(std::is_same<decltype(ops), const DispatchArray<Op, Op(Machine&), 2>>::value);
+
+    const Op code[] = { Op::Double, Op::Inc, Op::Inc, Op::Double, Op::Halt };
+    Machine m;
+    m.code = code;
+    m.acc = 1;
+    ops.run(code[0], Op::Halt, m);
+    EXPECT_EQ(m.acc, 8);
+
+    Machine other;
+    other.code = code;
+    EXPECT_EQ(ops(Op::Inc, other), Op::Inc);
+    EXPECT_EQ(other.acc, 1);
+}
+
+TEST(DispatchArray, testThreadedArguments)
+{
+    // Handlers of the state machine, each receiving the same argument
+    Connection c;
+    DispatchArray<State, State(int)> states = {
+        { State::Idle, MakeDelegate<&Connection::onIdle>(c) },
+        { State::Open, MakeDelegate<&Connection::onOpen>(c) },
+    };
+    states.run(State::Idle, State::Closing, 1);
+    EXPECT_EQ(c.log, (std::vector<int>{ 1, 11 }));
+}
+
+TEST(DispatchArray, testArguments)
+{
+    g_received = 0;
+    LateConnection c;
+    c.handlers = { { State::Open, Delegate<void(LateEvent)>(&OnEvent) } };
+    c.handlers(State::Open, LateEvent{ { 1, 2 } });
+    EXPECT_EQ(g_received, 2u);
+
+    // Braced initializer lists convert to the parameter type
+    DispatchArray<State, void(std::vector<int>)> values = {
+        { State::Idle, Delegate<void(std::vector<int>)>(&OnValues) },
+    };
+    values(State::Idle, { 1, 2, 3 });
+    values(State::Idle, {});
+    EXPECT_EQ(g_received, 32u);
+}
@@ -0,0 +1,134 @@
+#include "gtest/gtest.h"
+
+#include "DispatchTable.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace delly;
+
+namespace {
+
+// Calls in invocation order, as "<method>:<object>"
+std::vector<std::string> g_calls;
+
+struct Listener
+{
+    explicit Listener(int i) : id(i) {}
+    virtual ~Listener() = default;
+
+    void OnA(int) { g_calls.push_back("A:" + std::to_string(id)); }
+    void OnB(int) { g_calls.push_back("B:" + std::to_string(id)); }
+    virtual void OnVirtual(int) { g_calls.push_back("V:" + std::to_string(id)); }
+
+    int id;
+};
+
+struct DerivedListener : public Listener
+{
+    using Listener::Listener;
+    void OnVirtual(int) override { g_calls.push_back("D:" + std::to_string(id)); }
+};
+
+void StaticListener1(int) { g_calls.push_back("S1"); }
+void StaticListener2(int) { g_calls.push_back("S2"); }
+
+// Number of times consecutive calls change method
+size_t TargetSwitches(const std::vector<std::string>& calls) {
+    size_t switches = 0;
+    for (size_t i = 1; i < calls.size(); ++i)
+        switches += calls[i].substr(0, 2) != calls[i - 1].substr(0, 2);
+    return switches;
+}
+
+} // end anonymous namespace
+
+TEST(DispatchTable, testGroupsByTarget)
+{
+    std::vector<std::unique_ptr<Listener>> listeners;
+    for (int i = 0; i < 8; ++i) {
+        if (i % 2)
+            listeners.emplace_back(new DerivedListener(i));
+        else
+            listeners.emplace_back(new Listener(i));
+    }
+
+    DispatchTable<void(int)> table;
+    EXPECT_TRUE(table.empty());
+    for (auto& l : listeners) {
+        table.add(MakeDelegate(l.get(), &Listener::OnA));
+        table.add(MakeDelegate(l.get(), &Listener::OnVirtual));
+        table.add(MakeDelegate(l.get(), &Listener::OnB));
+        table.add(&StaticListener1);
+        table.add(&StaticListener2);
+    }
+    EXPECT_EQ(40u, table.size());
+
+    g_calls.clear();
+    table(0);
+    ASSERT_EQ(40u, g_calls.size());
+
+    // A, B, V, D, S1 and S2 each run back to back
+    EXPECT_EQ(5u, TargetSwitches(g_calls));
+
+    // Every delegate was called once
+    std::vector<std::string> expected;
+    for (auto& l : listeners) {
+        const std::string id = std::to_string(l->id);
+        expected.push_back("A:" + id);
+        expected.push_back("B:" + id);
+        expected.push_back(((l->id % 2) ? "D:" : "V:") + id);
+        expected.push_back("S1");
+        expected.push_back("S2");
+    }
+    auto calls = g_calls;
+    std::sort(calls.begin(), calls.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(expected, calls);
+}
+
+TEST(DispatchTable, testOrder)
+{
+    Listener l1(1), l2(2);
+    DispatchTable<void(int)> table;
+    table.add(MakeDelegate(l1, &Listener::OnA), 2);
+    table.add(MakeDelegate(l2, &Listener::OnB), 1);
+    table.add(MakeDelegate(l2, &Listener::OnA), 2);
+    table.add(MakeDelegate(l1, &Listener::OnB), 1);
+    table.add(&StaticListener1, -1);
+
+    g_calls.clear();
+    table(0);
+    ASSERT_EQ(5u, g_calls.size());
+    EXPECT_EQ("S1", g_calls[0]);
+    EXPECT_EQ("B:", g_calls[1].substr(0, 2));
+    EXPECT_EQ("B:", g_calls[2].substr(0, 2));
+    EXPECT_EQ("A:", g_calls[3].substr(0, 2));
+    EXPECT_EQ("A:", g_calls[4].substr(0, 2));
+}
+
+TEST(DispatchTable, testRemove)
+{
+    Listener l1(1), l2(2);
+    DispatchTable<void(int)> table;
+    table.add(MakeDelegate(l1, &Listener::OnA));
+    table.add(MakeDelegate(l2, &Listener::OnA));
+    table.add(&StaticListener1);
+
+    EXPECT_TRUE(table.contains(MakeDelegate(l2, &Listener::OnA)));
+    EXPECT_TRUE(table.remove(MakeDelegate(l2, &Listener::OnA)));
+    EXPECT_FALSE(table.remove(MakeDelegate(l2, &Listener::OnA)));
+    EXPECT_FALSE(table.contains(MakeDelegate(l2, &Listener::OnA)));
+
+    g_calls.clear();
+    table(0);
+    std::sort(g_calls.begin(), g_calls.end());
+    EXPECT_EQ(std::vector<std::string>({ "A:1", "S1" }), g_calls);
+
+    table.clear();
+    g_calls.clear();
+    table(0);
+    EXPECT_TRUE(g_calls.empty());
+}
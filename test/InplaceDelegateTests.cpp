@@ -0,0 +1,114 @@
+#include "gtest/gtest.h"
+
+#include "InplaceDelegate.h"
+#include <memory>
+#include <string>
+
+using namespace delly;
+
+namespace {
+
+struct Accumulator
+{
+    int Add(int v) { total += v; return total; }
+    int total = 0;
+};
+
+int Twice(int v) { return 2 * v; }
+
+} // end anonymous namespace
+
+TEST(InplaceDelegate, testSize)
+{
+    static_assert(sizeof(InplaceDelegate<void()>) == details::CacheLineSize,
+                  "Default InplaceDelegate is one cache line");
+    static_assert(sizeof(InplaceDelegate<void(), 16>) == 16 + 2 * sizeof(void*),
+                  "Capacity sets the buffer size");
+}
+
+TEST(InplaceDelegate, testCapturingLambda)
+{
+    int a = 3;
+    double b = 0.5;
+    InplaceDelegate<double(int)> d = [a, b](int x) { return a * x + b; };
+
+    EXPECT_FALSE(d.empty());
+    EXPECT_DOUBLE_EQ(6.5, d(2));
+
+    InplaceDelegate<double(int)> copy = d;
+    EXPECT_DOUBLE_EQ(9.5, copy(3));
+    EXPECT_DOUBLE_EQ(6.5, d(2));
+
+    // Mutable state lives in the delegate
+    InplaceDelegate<int()> counter = [n = 0]() mutable { return ++n; };
+    EXPECT_EQ(1, counter());
+    EXPECT_EQ(2, counter());
+    InplaceDelegate<int()> counter2 = counter;
+    EXPECT_EQ(3, counter2());
+    EXPECT_EQ(3, counter());
+}
+
+TEST(InplaceDelegate, testLifetime)
+{
+    auto shared = std::make_shared<std::string>("captured");
+    {
+        InplaceDelegate<size_t()> d1 = [shared]() { return shared->size(); };
+        EXPECT_EQ(2, shared.use_count());
+
+        InplaceDelegate<size_t()> d2 = d1;
+        EXPECT_EQ(3, shared.use_count());
+
+        InplaceDelegate<size_t()> d3 = std::move(d1);
+        EXPECT_EQ(3, shared.use_count());
+        EXPECT_TRUE(d1.empty());
+        EXPECT_EQ(8u, d3());
+
+        d2 = nullptr;
+        EXPECT_EQ(2, shared.use_count());
+        EXPECT_TRUE(d2.empty());
+
+        d3 = []() { return size_t(7); };
+        EXPECT_EQ(1, shared.use_count());
+        EXPECT_EQ(7u, d3());
+
+        d2 = [shared]() { return shared->size(); };
+        EXPECT_EQ(2, shared.use_count());
+    }
+    EXPECT_EQ(1, shared.use_count());
+}
+
+TEST(InplaceDelegate, testDelegates)
+{
+    Accumulator acc;
+    Delegate<int(int)> d = MakeDelegate(acc, &Accumulator::Add);
+
+    InplaceDelegate<int(int)> i1 = d;
+    EXPECT_EQ(5, i1(5));
+    EXPECT_EQ(7, i1(2));
+    EXPECT_EQ(7, acc.total);
+
+    InplaceDelegate<int(int)> i2 = MakeDelegate(&Twice);
+    EXPECT_EQ(8, i2(4));
+
+    InplaceDelegate<int(int)> i3 = &Twice;
+    EXPECT_EQ(10, i3(5));
+
+    // Empty delegates and null functions are empty
+    InplaceDelegate<int(int)> e1 = Delegate<int(int)>();
+    InplaceDelegate<int(int)> e2 = static_cast<int(*)(int)>(nullptr);
+    InplaceDelegate<int(int)> e3;
+    EXPECT_TRUE(e1.empty());
+    EXPECT_TRUE(e2.empty());
+    EXPECT_TRUE(e3 == nullptr);
+    EXPECT_TRUE(!e3);
+    EXPECT_TRUE(bool(i1));
+}
+
+TEST(InplaceDelegate, testDiscardedResult)
+{
+    int calls = 0;
+    InplaceDelegate<void()> d = [&calls]() { return ++calls; };
+    d();
+    d();
+    EXPECT_EQ(2, calls);
+}
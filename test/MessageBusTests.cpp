@@ -0,0 +1,118 @@
+#include "gtest/gtest.h"
+
+#include "MessageBus.h"
+#include <string>
+#include <vector>
+
+using namespace delly;
+
+namespace {
+
+struct Quote { int price; };
+struct Trade { int quantity; };
+struct Heartbeat {};
+
+struct Book
+{
+    void OnQuote(const Quote& q) { quotes.push_back(q.price); }
+    void OnTrade(const Trade& t) { traded += t.quantity; }
+
+    std::vector<int> quotes;
+    int traded = 0;
+};
+
+int g_heartbeats = 0;
+void OnHeartbeat(const Heartbeat&) { ++g_heartbeats; }
+
+using Bus = MessageBus<Quote, Trade, Heartbeat>;
+
+template <class T, class Handle>
+concept CanUnsubscribe = requires(Bus bus, Handle h) { bus.unsubscribe<T>(h); };
+
+} // end anonymous namespace
+
+TEST(MessageBus, testTypeIds)
+{
+    static_assert(Bus::TypeId<Quote>() == 0);
+    static_assert(Bus::TypeId<Trade>() == 1);
+    static_assert(Bus::TypeId<Heartbeat>() == 2);
+    static_assert(Bus::TypeCount() == 3);
+}
+
+TEST(MessageBus, testPublish)
+{
+    Bus bus;
+    Book a, b;
+    bus.subscribe<Quote>(MakeDelegate<&Book::OnQuote>(a));
+    bus.subscribe<&Book::OnQuote>(b);
+    bus.subscribe<&Book::OnTrade>(b);
+    bus.subscribe<Heartbeat>(&OnHeartbeat);
+    EXPECT_EQ(bus.subscribers<Quote>(), 2u);
+    EXPECT_EQ(bus.subscribers<Trade>(), 1u);
+
+    g_heartbeats = 0;
+    bus.publish(Quote{ 100 });
+    bus.publish(Trade{ 5 });
+    bus.publish(Quote{ 101 });
+    bus.publish(Heartbeat{});
+
+    EXPECT_EQ(a.quotes, (std::vector<int>{ 100, 101 }));
+    EXPECT_EQ(b.quotes, (std::vector<int>{ 100, 101 }));
+    EXPECT_EQ(a.traded, 0);
+    EXPECT_EQ(b.traded, 5);
+    EXPECT_EQ(g_heartbeats, 1);
+}
+
+TEST(MessageBus, testUnsubscribe)
+{
+    Bus bus;
+    Book a, b;
+    Bus::Subscription<Quote> ha = bus.subscribe<&Book::OnQuote>(a);
+    bus.subscribe<&Book::OnQuote>(b);
+    bus.subscribe<&Book::OnTrade>(a);
+
+    EXPECT_TRUE(bus.unsubscribe<Quote>(ha));
+    EXPECT_FALSE(bus.unsubscribe<Quote>(ha));
+    EXPECT_TRUE(bus.unsubscribe<Trade>(MakeDelegate<&Book::OnTrade>(a)));
+    EXPECT_FALSE(bus.unsubscribe<Trade>(MakeDelegate<&Book::OnTrade>(a)));
+
+    bus.publish(Quote{ 7 });
+    bus.publish(Trade{ 3 });
+    EXPECT_TRUE(a.quotes.empty());
+    EXPECT_EQ(b.quotes, (std::vector<int>{ 7 }));
+    EXPECT_EQ(a.traded, 0);
+
+    bus.clear();
+    EXPECT_EQ(bus.subscribers<Quote>(), 0u);
+    bus.publish(Quote{ 8 });
+    EXPECT_EQ(b.quotes.size(), 1u);
+}
+
+TEST(MessageBus, testTypedSubscriptions)
+{
+    Bus bus;
+    Book a, b;
+    auto quote = bus.subscribe<&Book::OnQuote>(a);
+    auto trade = bus.subscribe<&Book::OnTrade>(b);
+    static_assert(std::is_same<decltype(quote), Bus::Subscription<Quote>>::value);
+    static_assert(std::is_same<decltype(trade), Bus::Subscription<Trade>>::value);
+
+    // Both subscribers are the first of their channel, with equal handles,
+    // but a handle only unsubscribes from the channel of its type
+    EXPECT_TRUE(quote.handle == trade.handle);
+    static_assert(CanUnsubscribe<Quote, Bus::Subscription<Quote>>);
+    static_assert(!CanUnsubscribe<Trade, Bus::Subscription<Quote>>);
+
+    EXPECT_TRUE(bus.unsubscribe(quote));
+    EXPECT_EQ(bus.subscribers<Quote>(), 0u);
+    EXPECT_EQ(bus.subscribers<Trade>(), 1u);
+    bus.publish(Trade{ 4 });
+    EXPECT_EQ(b.traded, 4);
+}
+
+TEST(MessageBus, testNoSubscribers)
+{
+    const Bus bus;
+    bus.publish(Heartbeat{});
+    EXPECT_TRUE(bus.channel<Heartbeat>().empty());
+}
@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+
+#include "MulticastDelegate.h"
+#include <algorithm>
+#include <vector>
+
+using namespace delly;
+
+namespace {
+
+struct Listener
+{
+    void OnValue(int v) { received.push_back(v); }
+    std::vector<int> received;
+};
+
+std::vector<int> g_static_received;
+void StaticListener(int v) { g_static_received.push_back(v); }
+
+} // end anonymous namespace
+
+TEST(MulticastDelegate, testDispatch)
+{
+    g_static_received.clear();
+    Listener l1, l2;
+    MulticastDelegate<void(int)> m;
+    EXPECT_TRUE(m.empty());
+
+    // Nothing to invoke
+    m(0);
+
+    auto h1 = m.add(MakeDelegate(l1, &Listener::OnValue));
+    auto h2 = m.add(MakeDelegate(l2, &Listener::OnValue));
+    auto h3 = m.add(&StaticListener);
+    EXPECT_EQ(3u, m.size());
+    EXPECT_TRUE(m.contains(h1));
+    EXPECT_TRUE(m.contains(h2));
+    EXPECT_TRUE(m.contains(h3));
+
+    m(1);
+    m(2);
+    EXPECT_EQ(std::vector<int>({1, 2}), l1.received);
+    EXPECT_EQ(std::vector<int>({1, 2}), l2.received);
+    EXPECT_EQ(std::vector<int>({1, 2}), g_static_received);
+
+    EXPECT_TRUE(m.remove(h1));
+    EXPECT_FALSE(m.remove(h1));
+    EXPECT_FALSE(m.contains(h1));
+    m(3);
+    EXPECT_EQ(std::vector<int>({1, 2}), l1.received);
+    EXPECT_EQ(std::vector<int>({1, 2, 3}), l2.received);
+    EXPECT_EQ(std::vector<int>({1, 2, 3}), g_static_received);
+
+    // Slots are reused, stale handles stay invalid
+    auto h4 = m.add(MakeDelegate(l1, &Listener::OnValue));
+    EXPECT_EQ(h1.index, h4.index);
+    EXPECT_NE(h1, h4);
+    EXPECT_FALSE(m.remove(h1));
+    EXPECT_TRUE(m.contains(h4));
+
+    // Remove by value
+    EXPECT_TRUE(m.remove(Delegate<void(int)>(&StaticListener)));
+    EXPECT_FALSE(m.remove(Delegate<void(int)>(&StaticListener)));
+    EXPECT_FALSE(m.contains(h3));
+    m(4);
+    EXPECT_EQ(std::vector<int>({1, 2, 4}), l1.received);
+    EXPECT_EQ(std::vector<int>({1, 2, 3, 4}), l2.received);
+    EXPECT_EQ(std::vector<int>({1, 2, 3}), g_static_received);
+
+    m.clear();
+    EXPECT_TRUE(m.empty());
+    EXPECT_FALSE(m.contains(h2));
+    EXPECT_FALSE(m.contains(h4));
+    m(5);
+    EXPECT_EQ(4u, l2.received.size());
+}
+
+TEST(MulticastDelegate, testManySubscribers)
+{
+    const size_t count = 1000;
+    std::vector<Listener> listeners(count);
+    std::vector<MulticastDelegate<void(int)>::Handle> handles;
+
+    MulticastDelegate<void(int)> m;
+    for (auto& l : listeners)
+        handles.push_back(m.add(MakeDelegate(l, &Listener::OnValue)));
+
+    // Remove every third subscriber
+    for (size_t i = 0; i < count; i += 3)
+        EXPECT_TRUE(m.remove(handles[i]));
+
+    m(7);
+    for (size_t i = 0; i < count; ++i) {
+        if (i % 3 == 0)
+            EXPECT_TRUE(listeners[i].received.empty());
+        else
+            EXPECT_EQ(std::vector<int>({7}), listeners[i].received);
+    }
+
+    // Remaining handles still refer to their subscriber
+    for (size_t i = 1; i < count; i += 3)
+        EXPECT_TRUE(m.remove(handles[i]));
+    m(8);
+    for (size_t i = 2; i < count; i += 3)
+        EXPECT_EQ(std::vector<int>({7, 8}), listeners[i].received);
+    for (size_t i = 1; i < count; i += 3)
+        EXPECT_EQ(std::vector<int>({7}), listeners[i].received);
+}
@@ -0,0 +1,160 @@
+#include "gtest/gtest.h"
+
+#include "SharedCallRing.h"
+
+#include <cstring>
+#include <vector>
+
+#include <sys/wait.h>
+
+using namespace delly;
+
+namespace {
+
+struct Sample { int sequence; float value; };
+
+struct Collector
+{
+    void OnSample(const Sample& s) { sequences.push_back(s.sequence); sum += s.value; }
+    void OnCount(uint64_t n) { count += n; }
+
+    std::vector<int> sequences;
+    double sum = 0;
+    uint64_t count = 0;
+};
+
+int g_ticks = 0;
+void Tick() { ++g_ticks; }
+
+DelegateRegistry MakeRegistry(Collector& c) {
+    DelegateRegistry registry;
+    registry.add<&Collector::OnSample>();
+    registry.add<&Collector::OnCount>();
+    registry.add<&Tick>();
+    registry.setObject(3, c);
+    return registry;
+}
+
+} // end anonymous namespace
+
+TEST(SharedCallRing, testTwoMappings)
+{
+    // Two mappings of the same memfd, at different addresses, as in two
+    // processes
+    SharedCallRing producer = SharedCallRing::Create(4096);
+    SharedCallRing consumer = SharedCallRing::Open(producer.fd());
+    EXPECT_EQ(consumer.capacity(), 4096u);
+    EXPECT_NE(producer.fd(), consumer.fd());
+
+    Collector c;
+    const DelegateRegistry registry = MakeRegistry(c);
+    g_ticks = 0;
+
+    EXPECT_TRUE(consumer.empty());
+    EXPECT_TRUE(producer.tryPush<&Collector::OnSample>(ObjectHandle{ 3 }, Sample{ 1, 0.5 }));
+    EXPECT_TRUE(producer.tryPush<&Tick>());
+    EXPECT_TRUE(producer.tryPush<&Collector::OnCount>(ObjectHandle{ 3 }, 7));
+    EXPECT_FALSE(consumer.empty());
+
+    EXPECT_EQ(consumer.drain(registry, 2), 2u);
+    EXPECT_EQ(c.sequences, (std::vector<int>{ 1 }));
+    EXPECT_EQ(g_ticks, 1);
+    EXPECT_EQ(consumer.drain(registry), 1u);
+    EXPECT_EQ(c.count, 7u);
+    EXPECT_TRUE(producer.empty());
+}
+
+TEST(SharedCallRing, testWrapAndFull)
+{
+    SharedCallRing ring = SharedCallRing::Create(256);
+    Collector c;
+    const DelegateRegistry registry = MakeRegistry(c);
+
+    // Records of 24 bytes, pushed until full and drained, across the end of
+    // the ring many times with padding
+    int pushed = 0;
+    for (int round = 0; round < 50; ++round) {
+        while (ring.tryPush<&Collector::OnSample>(ObjectHandle{ 3 }, Sample{ pushed, 1.0 }))
+            ++pushed;
+        ring.drain(registry, 3);
+    }
+    ring.drain(registry);
+    ASSERT_EQ(c.sequences.size(), size_t(pushed));
+    for (int i = 0; i < pushed; ++i)
+        EXPECT_EQ(c.sequences[i], i);
+    EXPECT_EQ(ring.dropped(), 0u);
+}
+
+TEST(SharedCallRing, testSmallPadding)
+{
+    SharedCallRing ring = SharedCallRing::Create(128);
+    Collector c;
+    const DelegateRegistry registry = MakeRegistry(c);
+
+    // Guard bytes after the ring, in the slack of its last page
+    struct stat st;
+    ASSERT_EQ(fstat(ring.fd(), &st), 0);
+    const size_t end = size_t(st.st_size);
+    void* p = mmap(nullptr, end + 8, PROT_READ | PROT_WRITE, MAP_SHARED, ring.fd(), 0);
+    ASSERT_NE(p, MAP_FAILED);
+    unsigned char* guard = static_cast<unsigned char*>(p) + end;
+    memset(guard, 0xff, 8);
+
+    // Five records of 24 bytes leave 8 bytes before the end of the ring
+    for (uint64_t i = 0; i < 5; ++i)
+        ASSERT_TRUE(ring.tryPush<&Collector::OnCount>(ObjectHandle{ 3 }, i));
+    EXPECT_EQ(ring.drain(registry), 5u);
+    ASSERT_TRUE(ring.tryPush<&Collector::OnCount>(ObjectHandle{ 3 }, uint64_t(10)));
+    EXPECT_EQ(ring.drain(registry), 1u);
+    EXPECT_EQ(c.count, 20u);
+
+    for (int i = 0; i < 8; ++i)
+        EXPECT_EQ(guard[i], 0xff);
+    munmap(p, end + 8);
+}
+
+TEST(SharedCallRing, testDropped)
+{
+    SharedCallRing ring = SharedCallRing::Create();
+    Collector c;
+    DelegateRegistry registry;
+    registry.add<&Collector::OnCount>();
+    registry.setObject(3, c);
+
+    // Unregistered target, unknown handle
+    ring.push<&Tick>();
+    ring.push<&Collector::OnCount>(ObjectHandle{ 4 }, uint64_t(1));
+    ring.push<&Collector::OnCount>(ObjectHandle{ 3 }, uint64_t(2));
+    EXPECT_EQ(ring.drain(registry), 1u);
+    EXPECT_EQ(ring.dropped(), 2u);
+    EXPECT_EQ(c.count, 2u);
+}
+
+TEST(SharedCallRing, testOtherProcess)
+{
+    SharedCallRing ring = SharedCallRing::Create(1024);
+    const uint64_t calls = 20000;
+
+    const pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        // The child produces, the ring is smaller than what it sends
+        for (uint64_t i = 1; i <= calls; ++i)
+            ring.push<&Collector::OnCount>(ObjectHandle{ 3 }, i);
+        ring.push<&Tick>();
+        _exit(0);
+    }
+
+    Collector c;
+    const DelegateRegistry registry = MakeRegistry(c);
+    g_ticks = 0;
+    while (g_ticks == 0) {
+        if (!ring.drain(registry))
+            std::this_thread::yield();
+    }
+    EXPECT_EQ(c.count, calls * (calls + 1) / 2);
+
+    int status = 0;
+    EXPECT_EQ(waitpid(child, &status, 0), child);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
@@ -0,0 +1,93 @@
+#include "gtest/gtest.h"
+
+#include "SlotMap.h"
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace delly;
+
+TEST(SlotMap, testInsertErase)
+{
+    SlotMap<std::string> map;
+    EXPECT_TRUE(map.empty());
+
+    auto a = map.insert("a");
+    auto b = map.emplace(2, 'b');
+    auto c = map.insert(std::string("c"));
+    EXPECT_EQ(3u, map.size());
+    EXPECT_EQ("a", *map.get(a));
+    EXPECT_EQ("bb", *map.get(b));
+    EXPECT_EQ("c", *map.get(c));
+
+    // Erasing moves the last object, handles still find their object
+    EXPECT_TRUE(map.erase(a));
+    EXPECT_FALSE(map.erase(a));
+    EXPECT_FALSE(map.contains(a));
+    EXPECT_EQ(nullptr, map.get(a));
+    EXPECT_EQ("bb", *map.get(b));
+    EXPECT_EQ("c", *map.get(c));
+    EXPECT_EQ(2u, map.size());
+
+    // Slots are reused, stale handles stay invalid
+    auto d = map.insert("d");
+    EXPECT_EQ(a.index, d.index);
+    EXPECT_NE(a, d);
+    EXPECT_EQ(nullptr, map.get(a));
+    EXPECT_EQ("d", *map.get(d));
+
+    // Default handles are invalid
+    EXPECT_FALSE(SlotHandle().valid());
+    EXPECT_FALSE(map.contains(SlotHandle()));
+
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    EXPECT_FALSE(map.contains(b));
+    EXPECT_FALSE(map.contains(d));
+}
+
+TEST(SlotMap, testMoveOnly)
+{
+    SlotMap<std::unique_ptr<int>> map;
+    auto a = map.emplace(new int(1));
+    auto b = map.emplace(new int(2));
+    map.erase(a);
+    EXPECT_EQ(2, **map.get(b));
+}
+
+TEST(SlotMap, testRandomized)
+{
+    // Random inserts and erases, checked against the value of each handle
+    SlotMap<int> map;
+    std::vector<std::pair<SlotHandle, int>> live;
+    std::vector<SlotHandle> dead;
+    std::mt19937 rng(1234);
+
+    for (int step = 0; step < 20000; ++step) {
+        if (live.empty() || rng() % 3 != 0) {
+            live.emplace_back(map.insert(step), step);
+        } else {
+            size_t i = rng() % live.size();
+            EXPECT_TRUE(map.erase(live[i].first));
+            dead.push_back(live[i].first);
+            live[i] = live.back();
+            live.pop_back();
+        }
+    }
+
+    EXPECT_EQ(live.size(), map.size());
+    for (const auto& l : live) {
+        ASSERT_NE(nullptr, map.get(l.first));
+        EXPECT_EQ(l.second, *map.get(l.first));
+    }
+    for (const auto& h : dead)
+        EXPECT_FALSE(map.contains(h));
+
+    long sum = 0, expected = 0;
+    for (int v : map)
+        sum += v;
+    for (const auto& l : live)
+        expected += l.second;
+    EXPECT_EQ(expected, sum);
+}
@@ -0,0 +1,217 @@
+#include "gtest/gtest.h"
+
+#include "ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace delly;
+
+namespace {
+
+struct Counter
+{
+    void Increment() { count.fetch_add(1); }
+
+    std::atomic<int> count{0};
+};
+
+// Each task records that it ran, exactly once
+struct Marker
+{
+    void Run() { runs.fetch_add(1); }
+
+    std::atomic<int> runs{0};
+};
+
+// Submits children from inside the pool
+struct Spawner
+{
+    void Run() {
+        for (auto& c : children)
+            pool->submit(MakeDelegate<&Counter::Increment>(c));
+        done.fetch_add(1);
+    }
+
+    ThreadPool* pool = nullptr;
+    std::vector<Counter> children = std::vector<Counter>(16);
+    std::atomic<int> done{0};
+};
+
+// Counts the calls for each index of a range
+struct Hits
+{
+    explicit Hits(size_t n) : counts(n) {}
+    void Run(size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            counts[i].fetch_add(1);
+    }
+
+    std::vector<std::atomic<int>> counts;
+};
+
+void WaitFor(ThreadPool& pool, const std::atomic<int>& value, int expected) {
+    while (value.load() != expected) {
+        if (!pool.runPending())
+            std::this_thread::yield();
+    }
+}
+
+} // end anonymous namespace
+
+TEST(TaskDeque, testTakeAndSteal)
+{
+    details::TaskDeque deque(4);
+    std::vector<Marker> markers(10);
+    Task task;
+    EXPECT_FALSE(deque.take(task));
+    EXPECT_FALSE(deque.steal(task));
+    EXPECT_TRUE(deque.empty());
+
+    // Grows past the initial capacity
+    for (auto& m : markers)
+        deque.push(MakeDelegate<&Marker::Run>(m));
+    EXPECT_FALSE(deque.empty());
+
+    // The owner takes the newest, thieves steal the oldest
+    ASSERT_TRUE(deque.take(task));
+    EXPECT_TRUE(task == MakeDelegate<&Marker::Run>(markers[9]));
+    ASSERT_TRUE(deque.steal(task));
+    EXPECT_TRUE(task == MakeDelegate<&Marker::Run>(markers[0]));
+
+    int taken = 0;
+    while (deque.take(task)) {
+        task();
+        ++taken;
+    }
+    EXPECT_EQ(8, taken);
+    EXPECT_TRUE(deque.empty());
+    EXPECT_FALSE(deque.steal(task));
+    for (size_t i = 1; i < 9; ++i)
+        EXPECT_EQ(1, markers[i].runs.load());
+}
+
+TEST(TaskDeque, testConcurrentSteal)
+{
+    const int TaskCount = 20000;
+    details::TaskDeque deque(64);
+    std::vector<Marker> markers(TaskCount);
+    std::atomic<bool> done{false};
+    std::atomic<int> ran{0};
+
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < 3; ++t) {
+        thieves.emplace_back([&]() {
+            Task task;
+            while (!done.load() || !deque.empty()) {
+                if (deque.steal(task)) {
+                    task();
+                    ran.fetch_add(1);
+                }
+            }
+        });
+    }
+
+    // The owner pushes and takes while thieves steal
+    Task task;
+    for (int i = 0; i < TaskCount; ++i) {
+        deque.push(MakeDelegate<&Marker::Run>(markers[i]));
+        if (i % 3 == 0 && deque.take(task)) {
+            task();
+            ran.fetch_add(1);
+        }
+    }
+    while (deque.take(task)) {
+        task();
+        ran.fetch_add(1);
+    }
+    done = true;
+    for (auto& t : thieves)
+        t.join();
+
+    EXPECT_EQ(TaskCount, ran.load());
+    for (auto& m : markers)
+        ASSERT_EQ(1, m.runs.load());
+}
+
+TEST(ThreadPool, testSubmit)
+{
+    ThreadPool pool(3);
+    EXPECT_EQ(3u, pool.size());
+
+    Counter counter;
+    for (int i = 0; i < 1000; ++i)
+        pool.submit(MakeDelegate<&Counter::Increment>(counter));
+    WaitFor(pool, counter.count, 1000);
+
+    // Batches, after workers parked
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::vector<Task> tasks(500, MakeDelegate<&Counter::Increment>(counter));
+    pool.submit(tasks.data(), tasks.size());
+    WaitFor(pool, counter.count, 1500);
+}
+
+TEST(ThreadPool, testSubmitFromTask)
+{
+    ThreadPool pool(2);
+    std::vector<Spawner> spawners(32);
+    for (auto& s : spawners) {
+        s.pool = &pool;
+        pool.submit(MakeDelegate<&Spawner::Run>(s));
+    }
+    for (auto& s : spawners) {
+        WaitFor(pool, s.done, 1);
+        for (auto& c : s.children)
+            WaitFor(pool, c.count, 1);
+    }
+}
+
+TEST(ThreadPool, testParallelFor)
+{
+    ThreadPool pool(4);
+    Hits hits(10007);
+    auto body = MakeDelegate<&Hits::Run>(hits);
+
+    ParallelFor(pool, 0, hits.counts.size(), 64, body);
+    for (auto& h : hits.counts)
+        ASSERT_EQ(1, h.load());
+
+    // Partial range, grain larger than the range, empty range
+    ParallelFor(pool, 10, 20, 1000, body);
+    ParallelFor(pool, 5, 5, 1, body);
+    for (size_t i = 0; i < hits.counts.size(); ++i)
+        ASSERT_EQ((i >= 10 && i < 20) ? 2 : 1, hits.counts[i].load());
+}
+
+namespace {
+
+// Runs a ParallelFor from a task, the worker helps with its own chunks
+struct Nested
+{
+    void Chunk(size_t begin, size_t end) { sum.fetch_add(long(end - begin)); }
+    void Run() {
+        ParallelFor(*pool, 0, 1000, 10, MakeDelegate<&Nested::Chunk>(*this));
+        done.fetch_add(1);
+    }
+
+    ThreadPool* pool = nullptr;
+    std::atomic<long> sum{0};
+    std::atomic<int> done{0};
+};
+
+} // end anonymous namespace
+
+TEST(ThreadPool, testNestedParallelFor)
+{
+    ThreadPool pool(2);
+    std::vector<Nested> nested(8);
+    for (auto& n : nested) {
+        n.pool = &pool;
+        pool.submit(MakeDelegate<&Nested::Run>(n));
+    }
+    for (auto& n : nested) {
+        WaitFor(pool, n.done, 1);
+        EXPECT_EQ(1000, n.sum.load());
+    }
+}
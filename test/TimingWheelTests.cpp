@@ -0,0 +1,166 @@
+#include "gtest/gtest.h"
+
+#include "TimingWheel.h"
+#include <vector>
+
+using namespace delly;
+
+namespace {
+
+struct Recorder
+{
+    void Fire() { fired.push_back(wheel->now()); }
+
+    TimingWheel* wheel = nullptr;
+    std::vector<uint64_t> fired;
+};
+
+} // end anonymous namespace
+
+TEST(TimingWheel, testExpiresOnTime)
+{
+    // Delays on every level and across the level boundaries
+    const uint64_t delays[] = { 1, 2, 255, 256, 257, 300, 65535, 65536, 70000, (1 << 24) + 5 };
+    for (uint64_t start : { uint64_t(0), uint64_t(1000), uint64_t(65530) }) {
+        for (uint64_t delay : delays) {
+            TimingWheel wheel(start);
+            wheel.advance(3);
+            Recorder r;
+            r.wheel = &wheel;
+            TimerHandle h = wheel.schedule(delay, MakeDelegate<&Recorder::Fire>(r));
+            EXPECT_TRUE(wheel.pending(h));
+            EXPECT_EQ(wheel.expiry(h), start + 3 + delay);
+            EXPECT_EQ(wheel.size(), 1u);
+
+            EXPECT_EQ(wheel.advance(delay - 1), 0u);
+            EXPECT_TRUE(r.fired.empty());
+            EXPECT_EQ(wheel.advance(), 1u);
+            ASSERT_EQ(r.fired.size(), 1u);
+            EXPECT_EQ(r.fired[0], start + 3 + delay);
+            EXPECT_FALSE(wheel.pending(h));
+            EXPECT_TRUE(wheel.empty());
+        }
+    }
+}
+
+TEST(TimingWheel, testOrderOfTicks)
+{
+    TimingWheel wheel;
+    Recorder r;
+    r.wheel = &wheel;
+    for (uint64_t delay = 1; delay < 3000; delay += 7)
+        wheel.schedule(3000 - delay, MakeDelegate<&Recorder::Fire>(r));
+    // Past ticks fire at the next one
+    wheel.scheduleAt(0, MakeDelegate<&Recorder::Fire>(r));
+    wheel.schedule(0, MakeDelegate<&Recorder::Fire>(r));
+
+    const size_t count = wheel.size();
+    EXPECT_EQ(wheel.advanceTo(5000), count);
+    ASSERT_EQ(r.fired.size(), count);
+    EXPECT_EQ(r.fired[0], 1u);
+    EXPECT_EQ(r.fired[1], 1u);
+    for (size_t i = 1; i < r.fired.size(); ++i)
+        EXPECT_LE(r.fired[i - 1], r.fired[i]);
+    EXPECT_EQ(wheel.now(), 5000u);
+}
+
+TEST(TimingWheel, testCancel)
+{
+    TimingWheel wheel;
+    Recorder r;
+    r.wheel = &wheel;
+    std::vector<TimerHandle> handles;
+    for (uint64_t i = 0; i < 1000; ++i)
+        handles.push_back(wheel.schedule(1 + i * 97, MakeDelegate<&Recorder::Fire>(r)));
+
+    for (size_t i = 0; i < handles.size(); i += 2)
+        EXPECT_TRUE(wheel.cancel(handles[i]));
+    EXPECT_FALSE(wheel.cancel(handles[0]));
+    EXPECT_FALSE(wheel.cancel(TimerHandle()));
+    EXPECT_EQ(wheel.size(), 500u);
+
+    wheel.advance(100000);
+    EXPECT_EQ(r.fired.size(), 500u);
+    for (size_t i = 0; i < r.fired.size(); ++i)
+        EXPECT_EQ(r.fired[i], 1 + (2 * i + 1) * 97);
+    EXPECT_FALSE(wheel.cancel(handles[1]));
+}
+
+TEST(TimingWheel, testStaleHandles)
+{
+    TimingWheel wheel;
+    Recorder r;
+    r.wheel = &wheel;
+    TimerHandle first = wheel.schedule(10, MakeDelegate<&Recorder::Fire>(r));
+    wheel.cancel(first);
+
+    // The node is reused, the old handle does not find the new timer
+    TimerHandle second = wheel.schedule(10, MakeDelegate<&Recorder::Fire>(r));
+    EXPECT_EQ(first.index, second.index);
+    EXPECT_NE(first, second);
+    EXPECT_FALSE(wheel.pending(first));
+    EXPECT_FALSE(wheel.cancel(first));
+    EXPECT_TRUE(wheel.pending(second));
+
+    wheel.advance(10);
+    EXPECT_EQ(r.fired.size(), 1u);
+}
+
+namespace {
+
+// Reschedules itself, and cancels a timer due in the same tick
+struct Periodic
+{
+    void Fire() {
+        ++count;
+        if (victim)
+            cancelled = wheel->cancel(victim);
+        if (count < 5)
+            wheel->schedule(period, MakeDelegate<&Periodic::Fire>(this));
+    }
+
+    TimingWheel* wheel = nullptr;
+    uint64_t period = 0;
+    TimerHandle victim;
+    bool cancelled = false;
+    int count = 0;
+};
+
+} // end anonymous namespace
+
+TEST(TimingWheel, testCallbacksChangeWheel)
+{
+    TimingWheel wheel;
+    Periodic periodic;
+    periodic.wheel = &wheel;
+    periodic.period = 300;
+    wheel.schedule(300, MakeDelegate<&Periodic::Fire>(periodic));
+
+    Recorder r;
+    r.wheel = &wheel;
+    periodic.victim = wheel.schedule(300, MakeDelegate<&Recorder::Fire>(r));
+
+    EXPECT_EQ(wheel.advance(300), 1u);
+    EXPECT_TRUE(periodic.cancelled);
+    EXPECT_TRUE(r.fired.empty());
+    periodic.victim = TimerHandle();
+
+    wheel.advance(10000);
+    EXPECT_EQ(periodic.count, 5);
+    EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimingWheel, testSkipsWhenEmpty)
+{
+    TimingWheel wheel;
+    EXPECT_EQ(wheel.advance(uint64_t(1) << 40), 0u);
+    EXPECT_EQ(wheel.now(), uint64_t(1) << 40);
+
+    Recorder r;
+    r.wheel = &wheel;
+    wheel.schedule(1000, MakeDelegate<&Recorder::Fire>(r));
+    wheel.advance(1 << 20);
+    ASSERT_EQ(r.fired.size(), 1u);
+    EXPECT_EQ(r.fired[0], (uint64_t(1) << 40) + 1000);
+    EXPECT_EQ(wheel.now(), (uint64_t(1) << 40) + (1 << 20));
+}
@@ -0,0 +1,161 @@
+#include "gtest/gtest.h"
+
+#include "UniqueDelegate.h"
+#include <array>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace delly;
+
+namespace {
+
+// Counts live instances, to check every callable is destroyed once
+struct Tracked
+{
+    Tracked() { ++live; }
+    Tracked(const Tracked&) { ++live; }
+    Tracked(Tracked&&) noexcept { ++live; }
+    ~Tracked() { --live; }
+
+    static int live;
+};
+int Tracked::live = 0;
+
+struct Reader
+{
+    int OnRead(int n) { return total += n; }
+    int total = 0;
+};
+
+int Twice(int n) { return 2 * n; }
+
+using Handler = UniqueDelegate<int(int)>;
+
+} // end anonymous namespace
+
+TEST(UniqueDelegate, testInlineOwner)
+{
+    auto buffer = std::make_unique<int>(40);
+    Handler h([b = std::move(buffer)](int n) { return *b + n; });
+    static_assert(Handler::StoresInline<decltype([b = std::unique_ptr<int>()](int n) { return *b + n; })>());
+    EXPECT_FALSE(h.empty());
+    EXPECT_EQ(h(2), 42);
+
+    Handler moved(std::move(h));
+    EXPECT_TRUE(h.empty());
+    EXPECT_EQ(moved(3), 43);
+
+    moved = nullptr;
+    EXPECT_TRUE(moved.empty());
+}
+
+TEST(UniqueDelegate, testPooledOwner)
+{
+    {
+        auto payload = std::make_unique<int>(7);
+        std::array<char, 200> padding{};
+        Handler h([p = std::move(payload), padding, t = Tracked()](int n) { return *p * n + padding[0]; });
+        EXPECT_EQ(Tracked::live, 1);
+        EXPECT_EQ(h(3), 21);
+
+        // Moving moves the block, the callable stays in place
+        Handler moved(std::move(h));
+        EXPECT_EQ(Tracked::live, 1);
+        EXPECT_EQ(moved(2), 14);
+
+        Handler assigned;
+        assigned = std::move(moved);
+        EXPECT_EQ(assigned(1), 7);
+        EXPECT_EQ(Tracked::live, 1);
+    }
+    EXPECT_EQ(Tracked::live, 0);
+}
+
+TEST(UniqueDelegate, testPoolReusesBlocks)
+{
+    using Pool = details::DelegatePool;
+    static_assert(Pool::ClassOf(1) == 0 && Pool::ClassOf(64) == 0 && Pool::ClassOf(65) == 1);
+    static_assert(Pool::ClassOf(4096) == Pool::Classes - 1);
+
+    // The last block freed by a thread is the first reused
+    void* a = Pool::Allocate(100, 8);
+    void* b = Pool::Allocate(128, 8);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % Pool::BlockAlignment, 0u);
+    Pool::Free(a, 100, 8);
+    EXPECT_EQ(Pool::Allocate(120, 8), a);
+    Pool::Free(a, 120, 8);
+    Pool::Free(b, 128, 8);
+
+    // Larger callables are not pooled
+    void* large = Pool::Allocate(10000, 8);
+    Pool::Free(large, 10000, 8);
+
+    // A handler takes the block just freed
+    std::array<char, 100> padding{};
+    using Large = decltype([padding, v = 0](int n) { return v + n + padding[0]; });
+    static_assert(!Handler::StoresInline<Large>());
+    void* next = Pool::Allocate(sizeof(Large), alignof(Large));
+    Pool::Free(next, sizeof(Large), alignof(Large));
+    Handler h([padding, v = 1](int n) { return v + n + padding[0]; });
+    EXPECT_EQ(h(1), 2);
+    void* after = Pool::Allocate(sizeof(Large), alignof(Large));
+    EXPECT_NE(after, next);
+    Pool::Free(after, sizeof(Large), alignof(Large));
+}
+
+TEST(UniqueDelegate, testInlineDestroysOnce)
+{
+    {
+        Handler h([t = Tracked(), u = std::make_unique<int>(1)](int n) { return n + *u; });
+        EXPECT_EQ(Tracked::live, 1);
+        Handler moved(std::move(h));
+        EXPECT_EQ(Tracked::live, 1);
+        Handler assigned;
+        assigned = std::move(moved);
+        EXPECT_EQ(Tracked::live, 1);
+        EXPECT_EQ(assigned(1), 2);
+        assigned = [](int n) { return n; };
+        EXPECT_EQ(Tracked::live, 0);
+        EXPECT_EQ(assigned(5), 5);
+    }
+    EXPECT_EQ(Tracked::live, 0);
+}
+
+TEST(UniqueDelegate, testFromDelegate)
+{
+    Reader r;
+    Delegate<int(int)> d = MakeDelegate<&Reader::OnRead>(r);
+    Handler h(d);
+    EXPECT_EQ(h(4), 4);
+    EXPECT_EQ(h(5), 9);
+
+    Handler f(&Twice);
+    EXPECT_EQ(f(21), 42);
+
+    EXPECT_TRUE(Handler(Delegate<int(int)>()).empty());
+    EXPECT_TRUE(Handler(static_cast<int (*)(int)>(nullptr)).empty());
+    EXPECT_TRUE(Handler(nullptr) == nullptr);
+}
+
+TEST(UniqueDelegate, testCrossThreadFree)
+{
+    // Handlers created here and destroyed on another thread, as completions
+    // run on an I/O thread
+    std::array<char, 300> padding{};
+    std::vector<Handler> handlers;
+    for (int round = 0; round < 4; ++round) {
+        for (int i = 0; i < 200; ++i)
+            handlers.push_back(Handler([padding, t = Tracked(), i](int n) { return i + n + padding[0]; }));
+        std::thread consumer([&] {
+            int sum = 0;
+            for (auto& h : handlers)
+                sum += h(0);
+            handlers.clear();
+            EXPECT_EQ(sum, 199 * 200 / 2);
+        });
+        consumer.join();
+        EXPECT_EQ(Tracked::live, 0);
+    }
+}
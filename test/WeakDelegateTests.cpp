@@ -0,0 +1,131 @@
+#include "gtest/gtest.h"
+
+#include "WeakDelegate.h"
+#include <string>
+#include <vector>
+
+using namespace delly;
+
+namespace {
+
+struct Timer
+{
+    explicit Timer(int i) : id(i) {}
+
+    void OnExpired(int now) { expired += now; }
+    int Id() const { return id; }
+    int& Expired() { return expired; }
+    std::string Describe(std::string prefix) const { return prefix + std::to_string(id); }
+
+    int id;
+    int expired = 0;
+};
+
+} // end anonymous namespace
+
+TEST(WeakDelegate, testInvoke)
+{
+    SlotMap<Timer> timers;
+    auto h1 = timers.emplace(1);
+    auto h2 = timers.emplace(2);
+
+    auto d1 = MakeWeakDelegate<&Timer::OnExpired>(timers, h1);
+    auto d2 = MakeWeakDelegate<&Timer::OnExpired>(timers, h2);
+    EXPECT_FALSE(d1.expired());
+
+    EXPECT_TRUE(d1(10));
+    EXPECT_TRUE(d2(20));
+    EXPECT_EQ(10, timers.get(h1)->expired);
+    EXPECT_EQ(20, timers.get(h2)->expired);
+
+    // Erasing h1 moves timer 2, d2 still reaches it
+    timers.erase(h1);
+    EXPECT_TRUE(d1.expired());
+    EXPECT_FALSE(d1(10));
+    EXPECT_TRUE(d2(1));
+    EXPECT_EQ(21, timers.get(h2)->expired);
+
+    // A new timer in the reused slot is not reached by d1
+    auto h3 = timers.emplace(3);
+    EXPECT_EQ(h1.index, h3.index);
+    EXPECT_FALSE(d1(10));
+    EXPECT_EQ(0, timers.get(h3)->expired);
+}
+
+TEST(WeakDelegate, testReturnValues)
+{
+    SlotMap<Timer> timers;
+    auto h = timers.emplace(7);
+
+    WeakDelegate<int()> id;
+    id.bind<&Timer::Id>(timers, h);
+    auto describe = MakeWeakDelegate<&Timer::Describe>(timers, h);
+
+    ASSERT_TRUE(id().has_value());
+    EXPECT_EQ(7, *id());
+    EXPECT_EQ("timer 7", describe("timer ").value());
+
+    // References are returned as pointers
+    auto expired = MakeWeakDelegate<&Timer::Expired>(timers, h);
+    ASSERT_NE(nullptr, expired());
+    *expired() = 5;
+    EXPECT_EQ(5, timers.get(h)->expired);
+
+    timers.erase(h);
+    EXPECT_FALSE(id().has_value());
+    EXPECT_FALSE(describe("timer ").has_value());
+    EXPECT_EQ(nullptr, expired());
+}
+
+// Parameter types may still be incomplete where a weak delegate is declared
+struct LateEvent;
+
+struct LateEventHolder
+{
+    WeakDelegate<void(LateEvent)> onEvent;
+};
+
+struct LateEvent { std::vector<int> values; };
+
+struct EventSink
+{
+    void OnEvent(LateEvent e) { received += e.values.size(); }
+    void OnValues(std::vector<int> v) { received += v.size(); }
+
+    size_t received = 0;
+};
+
+TEST(WeakDelegate, testArguments)
+{
+    SlotMap<EventSink> sinks;
+    auto h = sinks.emplace();
+    LateEventHolder holder;
+    holder.onEvent.bind<&EventSink::OnEvent>(sinks, h);
+    EXPECT_TRUE(holder.onEvent(LateEvent{ { 1, 2 } }));
+
+    // Braced initializer lists
+    auto values = MakeWeakDelegate<&EventSink::OnValues>(sinks, h);
+    EXPECT_TRUE(values({ 1, 2, 3 }));
+    EXPECT_TRUE(values({}));
+    EXPECT_EQ(5u, sinks.get(h)->received);
+}
+
+TEST(WeakDelegate, testEmpty)
+{
+    WeakDelegate<void(int)> d;
+    EXPECT_TRUE(d.empty());
+    EXPECT_TRUE(d.expired());
+    EXPECT_FALSE(d(1));
+
+    SlotMap<Timer> timers;
+    auto h = timers.emplace(1);
+    d.bind<&Timer::OnExpired>(timers, h);
+    EXPECT_FALSE(d.empty());
+    EXPECT_EQ(d, MakeWeakDelegate<&Timer::OnExpired>(timers, h));
+    EXPECT_NE(d, WeakDelegate<void(int)>());
+    EXPECT_EQ(h, d.handle());
+
+    d.reset();
+    EXPECT_TRUE(d.empty());
+    EXPECT_EQ(d, nullptr);
+}
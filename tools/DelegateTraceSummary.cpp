@@ -0,0 +1,234 @@
+#include "DelegateTracer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace delly;
+
+// Summarizes trace files written by DelegateTracer: calls per target, the
+// intervals between calls of each target and their durations, over the
+// calls of every thread merged in order.  With --calls, replays the first
+// calls in order, nested calls indented, with their arguments.  Times are
+// in nanoseconds when every file was closed, in cycles otherwise.
+//
+// Usage: DelegateTraceSummary [--top N] [--calls N] file.trace...
+
+namespace {
+
+struct Call {
+    uint64_t start;
+    uint64_t cycles;
+    uint64_t code;
+    uint64_t object;
+    uint32_t tid;
+    uint32_t depth;
+    uint16_t argBytes;
+    uint8_t args[DelegateTraceRecord::ArgBytes];
+    size_t file;
+};
+
+struct Target {
+    uint64_t code = 0;      // address in the first file calling it, for display
+    size_t file = 0;
+    size_t calls = 0;
+    std::vector<uint64_t> intervals;
+    std::vector<uint64_t> durations;
+    uint64_t lastStart = 0;
+};
+
+struct Program {
+    std::string path;
+    uint64_t base = 0;
+};
+
+// A target of every process running the same program, whatever the address
+// it was loaded at: the program path and the offset of the code in it
+using TargetKey = std::pair<std::string, uint64_t>;
+
+TargetKey KeyOf(const Program& program, uint64_t code) {
+    return { program.path, code >= program.base ? code - program.base : code };
+}
+
+// Percentile of sorted values
+uint64_t Percentile(const std::vector<uint64_t>& sorted, double percentile) {
+    if (sorted.empty())
+        return 0;
+    return sorted[std::min(sorted.size() - 1, size_t(percentile / 100 * double(sorted.size())))];
+}
+
+double Mean(const std::vector<uint64_t>& values) {
+    if (values.empty())
+        return 0;
+    double sum = 0;
+    for (uint64_t v : values)
+        sum += double(v);
+    return sum / double(values.size());
+}
+
+// Function name of an address in the program which wrote the trace,
+// through addr2line, which needs a symbol table
+std::string Symbolize(const Program& program, uint64_t code, std::map<TargetKey, std::string>& cache) {
+    const TargetKey key = KeyOf(program, code);
+    auto found = cache.find(key);
+    if (found != cache.end())
+        return found->second;
+
+    char address[24];
+    snprintf(address, sizeof(address), "0x%llx", (unsigned long long)code);
+    std::string name = address;
+    if (!program.path.empty() && code >= program.base) {
+        char offset[24];
+        snprintf(offset, sizeof(offset), "0x%llx", (unsigned long long)(code - program.base));
+        const std::string command = "addr2line -f -C -e '" + program.path + "' " + offset + " 2>/dev/null";
+        if (FILE* pipe = popen(command.c_str(), "r")) {
+            char buffer[1024];
+            if (fgets(buffer, sizeof(buffer), pipe) && strncmp(buffer, "??", 2) != 0) {
+                name = buffer;
+                while (!name.empty() && name.back() == '\n')
+                    name.pop_back();
+            }
+            pclose(pipe);
+        }
+    }
+    cache.emplace(key, name);
+    return name;
+}
+
+int Usage() {
+    fprintf(stderr, "Usage: DelegateTraceSummary [--top N] [--calls N] file.trace...\n");
+    return 2;
+}
+
+} // end anonymous namespace
+
+int main(int argc, char** argv) {
+    size_t top = 20;
+    size_t replay = 0;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--top") && i + 1 < argc)
+            top = size_t(atol(argv[++i]));
+        else if (!strcmp(argv[i], "--calls") && i + 1 < argc)
+            replay = size_t(atol(argv[++i]));
+        else if (argv[i][0] == '-')
+            return Usage();
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.empty())
+        return Usage();
+
+    // Merge the calls of every file in order of their start
+    std::vector<Call> calls;
+    std::vector<Program> programs;
+    double nanosecondsPerCycle = 0;
+    bool calibrated = true;
+    for (const std::string& path : paths) {
+        DelegateTraceReader reader(path);
+        if (!reader.valid()) {
+            fprintf(stderr, "%s: not a delegate trace\n", path.c_str());
+            return 1;
+        }
+        const DelegateTraceHeader& h = reader.header();
+        programs.push_back(Program{ h.program, h.programBase });
+        // Every thread reads the same clock
+        if (reader.nanosecondsPerCycle() == 0)
+            calibrated = false;
+        else if (nanosecondsPerCycle == 0)
+            nanosecondsPerCycle = reader.nanosecondsPerCycle();
+        for (const DelegateTraceRecord& r : reader) {
+            Call c;
+            c.start = r.start;
+            c.cycles = r.cycles;
+            c.code = r.code;
+            c.object = r.object;
+            c.tid = h.tid;
+            c.depth = r.depth;
+            c.argBytes = std::min<uint16_t>(r.argBytes, DelegateTraceRecord::ArgBytes);
+            memcpy(c.args, r.args, sizeof(c.args));
+            c.file = programs.size() - 1;
+            calls.push_back(c);
+        }
+    }
+    std::stable_sort(calls.begin(), calls.end(), [](const Call& a, const Call& b) { return a.start < b.start; });
+    if (calls.empty()) {
+        printf("No delegate calls recorded\n");
+        return 0;
+    }
+
+    const double scale = calibrated ? nanosecondsPerCycle : 1;
+    const char* unit = calibrated ? "ns" : "cycles";
+    auto time = [&](double cycles) { return cycles * scale; };
+
+    std::map<TargetKey, Target> targets;
+    size_t unfinished = 0;
+    for (const Call& c : calls) {
+        Target& t = targets[KeyOf(programs[c.file], c.code)];
+        if (!t.calls) {
+            t.code = c.code;
+            t.file = c.file;
+        }
+        ++t.calls;
+        if (t.lastStart)
+            t.intervals.push_back(c.start - t.lastStart);
+        t.lastStart = c.start;
+        if (c.cycles)
+            t.durations.push_back(c.cycles);
+        else
+            ++unfinished;
+    }
+
+    std::vector<Target*> byCalls;
+    for (auto& entry : targets) {
+        std::sort(entry.second.intervals.begin(), entry.second.intervals.end());
+        std::sort(entry.second.durations.begin(), entry.second.durations.end());
+        byCalls.push_back(&entry.second);
+    }
+    std::sort(byCalls.begin(), byCalls.end(), [](const Target* a, const Target* b) {
+        return a->calls > b->calls;
+    });
+
+    const double span = time(double(calls.back().start - calls.front().start));
+    printf("%zu calls of %zu targets in %zu files over %.0f %s", calls.size(), targets.size(), paths.size(), span, unit);
+    if (unfinished)
+        printf(", %zu calls still running", unfinished);
+    printf("\n\n%10s %7s  %10s %10s %10s  %10s %10s %10s %10s  %s\n", "calls", "share",
+           "interval", "p50", "p99", "duration", "p50", "p99", "max", "target");
+
+    std::map<TargetKey, std::string> names;
+    for (size_t i = 0; i < byCalls.size() && i < top; ++i) {
+        const Target& t = *byCalls[i];
+        printf("%10zu %6.2f%%  %10.0f %10.0f %10.0f  %10.0f %10.0f %10.0f %10.0f  %s\n",
+               t.calls, 100.0 * double(t.calls) / double(calls.size()),
+               time(Mean(t.intervals)), time(double(Percentile(t.intervals, 50))),
+               time(double(Percentile(t.intervals, 99))),
+               time(Mean(t.durations)), time(double(Percentile(t.durations, 50))),
+               time(double(Percentile(t.durations, 99))),
+               time(double(t.durations.empty() ? 0 : t.durations.back())),
+               Symbolize(programs[t.file], t.code, names).c_str());
+    }
+
+    if (replay) {
+        printf("\n%12s %8s  %10s  call\n", "start", "thread", "duration");
+        for (size_t i = 0; i < calls.size() && i < replay; ++i) {
+            const Call& c = calls[i];
+            std::string args;
+            for (uint16_t b = 0; b < c.argBytes; ++b) {
+                char hex[4];
+                snprintf(hex, sizeof(hex), "%02x", c.args[b]);
+                args += hex;
+            }
+            printf("%12.0f %8u  %10.0f  %*s%s object 0x%llx args %s\n",
+                   time(double(c.start - calls.front().start)), c.tid, time(double(c.cycles)),
+                   int(2 * c.depth), "", Symbolize(programs[c.file], c.code, names).c_str(),
+                   (unsigned long long)c.object, args.empty() ? "-" : args.c_str());
+        }
+    }
+    return 0;
+}